@@ -0,0 +1,328 @@
+#include "acl.h"
+#include "tftp.h"
+
+#include <ctype.h>
+
+
+// Arbre compilé et règles triées par nœud puis par chemin
+static AclNode* nodes = NULL;
+static int num_nodes = 0;
+static AclRule* rules = NULL;
+static int num_rules = 0;
+static int acl_enabled = 0;
+static AclStats stats;
+
+
+
+/**
+ * \brief Retourne le bit d'une adresse (du poids fort au poids faible).
+ *
+ * \param addr L'adresse sur 128 bits.
+ * \param bit L'indice du bit (0 à 127).
+ * \return La valeur du bit.
+ */
+static int address_bit(const struct in6_addr* addr, int bit) {
+    return (addr->s6_addr[bit / 8] >> (7 - bit % 8)) & 1;
+}
+
+
+
+/**
+ * \brief Compare deux chemins de longueurs données (ordre des octets, le plus court d'abord).
+ *
+ * \param a Premier chemin.
+ * \param a_len Sa longueur.
+ * \param b Second chemin.
+ * \param b_len Sa longueur.
+ * \return Le résultat de la comparaison.
+ */
+static int compare_paths(const char* a, size_t a_len, const char* b, size_t b_len) {
+    int result = memcmp(a, b, a_len < b_len ? a_len : b_len);
+    if (result != 0) {
+        return result;
+    }
+    return a_len < b_len ? -1 : (a_len > b_len ? 1 : 0);
+}
+
+
+
+/**
+ * \brief Compare deux règles : par nœud, puis par chemin.
+ *
+ * \param a Première règle.
+ * \param b Seconde règle.
+ * \return Le résultat de la comparaison.
+ */
+static int compare_rules(const void* a, const void* b) {
+    const AclRule* ra = (const AclRule*) a;
+    const AclRule* rb = (const AclRule*) b;
+    if (ra->node != rb->node) {
+        return ra->node < rb->node ? -1 : 1;
+    }
+    return compare_paths(ra->path, ra->path_len, rb->path, rb->path_len);
+}
+
+
+
+/**
+ * \brief Cherche par dichotomie la règle d'un nœud dont le chemin est exactement le préfixe donné.
+ *
+ * \param node Le nœud du sous-réseau.
+ * \param path Le chemin demandé.
+ * \param len La longueur du préfixe (fin d'un segment).
+ * \return La règle, ou NULL si aucune.
+ */
+static const AclRule* find_rule(const AclNode* node, const char* path, size_t len) {
+    int low = node->first_rule;
+    int high = node->first_rule + node->num_rules - 1;
+    while (low <= high) {
+        int middle = low + (high - low) / 2;
+        int result = compare_paths(rules[middle].path, rules[middle].path_len, path, len);
+        if (result == 0) {
+            return &rules[middle];
+        }
+        if (result < 0) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return NULL;
+}
+
+
+
+/**
+ * \brief Ajoute un nœud vide à l'arbre en construction.
+ *
+ * \param tree L'arbre (réalloué si nécessaire).
+ * \param count Le nombre de nœuds.
+ * \param capacity La capacité du tableau.
+ * \return L'indice du nœud, ou -1 en cas d'erreur d'allocation.
+ */
+static int new_node(AclNode** tree, int* count, int* capacity) {
+    if (*count == *capacity) {
+        int new_capacity = *capacity > 0 ? *capacity * 2 : 64;
+        AclNode* grown = realloc(*tree, new_capacity * sizeof(AclNode));
+        if (grown == NULL) {
+            return -1;
+        }
+        *tree = grown;
+        *capacity = new_capacity;
+    }
+    AclNode* node = &(*tree)[*count];
+    node->child[0] = -1;
+    node->child[1] = -1;
+    node->first_rule = 0;
+    node->num_rules = 0;
+    return (*count)++;
+}
+
+
+
+/**
+ * \brief Charge et compile les règles d'accès depuis un fichier de configuration.
+ *
+ * \param config Le chemin du fichier de configuration.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int acl_load(const char* config) {
+    char line[512];
+    char subnet[INET6_ADDRSTRLEN + 8];
+    char path[ACL_MAX_PATH];
+    char access[16];
+    int line_number = 0;
+
+    FILE* file = fopen(config, "r");
+    if (file == NULL) {
+        perror("Erreur lors de l'ouverture de la configuration des accès");
+        return -1;
+    }
+
+    // Compilation dans de nouveaux tableaux, échangés avec les anciens à la fin
+    AclNode* tree = NULL;
+    int tree_count = 0;
+    int tree_capacity = 0;
+    AclRule* list = NULL;
+    int list_count = 0;
+    int list_capacity = 0;
+    int failed = new_node(&tree, &tree_count, &tree_capacity) < 0;
+
+    while (!failed && fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char* start = line;
+        while (isspace((unsigned char)*start)) {
+            start++;
+        }
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+
+        struct in6_addr network;
+        int prefix_len;
+        if (sscanf(start, "%53s %255s %15s", subnet, path, access) != 3
+            || sockaddr_parse_prefix(subnet, &network, &prefix_len) != 0) {
+            printf("Accès : ligne %d invalide\n", line_number);
+            continue;
+        }
+        int rights;
+        if (strcmp(access, "read") == 0) {
+            rights = ACL_READ;
+        } else if (strcmp(access, "write") == 0) {
+            rights = ACL_WRITE;
+        } else if (strcmp(access, "rw") == 0) {
+            rights = ACL_READ | ACL_WRITE;
+        } else if (strcmp(access, "deny") == 0) {
+            rights = 0;
+        } else {
+            printf("Accès : droits %s inconnus (ligne %d)\n", access, line_number);
+            continue;
+        }
+
+        // Descente (et création) du chemin du sous-réseau dans l'arbre
+        int node = 0;
+        for (int bit = 0; bit < prefix_len && !failed; ++bit) {
+            int b = address_bit(&network, bit);
+            if (tree[node].child[b] < 0) {
+                int child = new_node(&tree, &tree_count, &tree_capacity);
+                if (child < 0) {
+                    failed = 1;
+                    break;
+                }
+                tree[node].child[b] = child;
+            }
+            node = tree[node].child[b];
+        }
+        if (failed) {
+            break;
+        }
+
+        if (list_count == list_capacity) {
+            int new_capacity = list_capacity > 0 ? list_capacity * 2 : 16;
+            AclRule* grown = realloc(list, new_capacity * sizeof(AclRule));
+            if (grown == NULL) {
+                failed = 1;
+                break;
+            }
+            list = grown;
+            list_capacity = new_capacity;
+        }
+        AclRule* rule = &list[list_count++];
+        const char* relative = path;
+        while (*relative == '/') {
+            relative++;
+        }
+        strcpy(rule->path, relative);
+        rule->path_len = strlen(rule->path);
+        while (rule->path_len > 0 && rule->path[rule->path_len - 1] == '/') {
+            rule->path[--rule->path_len] = '\0'; // "secret/" et "secret" : même segment
+        }
+        rule->access = rights;
+        rule->node = node;
+    }
+    fclose(file);
+
+    if (failed) {
+        printf("Accès : mémoire insuffisante, règles précédentes conservées\n");
+        free(tree);
+        free(list);
+        return -1;
+    }
+
+    // Règles de chaque nœud contiguës et triées par chemin (recherche par dichotomie)
+    if (list_count > 0) {
+        qsort(list, list_count, sizeof(AclRule), compare_rules);
+    }
+    for (int i = 0; i < list_count; ++i) {
+        AclNode* node = &tree[list[i].node];
+        if (node->num_rules == 0) {
+            node->first_rule = i;
+        }
+        node->num_rules++;
+    }
+
+    free(nodes);
+    free(rules);
+    nodes = tree;
+    num_nodes = tree_count;
+    rules = list;
+    num_rules = list_count;
+    acl_enabled = 1;
+    printf("Accès : %d règles, %d nœuds\n", num_rules, num_nodes);
+    return 0;
+}
+
+
+
+/**
+ * \brief Vérifie qu'un client peut accéder à un fichier.
+ *
+ * \param addr L'adresse du client.
+ * \param filename Le fichier demandé, normalisé (voir tftp_normalize_path).
+ * \param access Le droit demandé (ACL_READ ou ACL_WRITE).
+ * \return 1 si l'accès est autorisé, 0 sinon.
+ */
+int acl_check(const struct sockaddr_storage* addr, const char* filename, int access) {
+    int candidates[129];
+    int num_candidates = 0;
+    size_t prefixes[ACL_MAX_PATH + 1];
+    int num_prefixes = 0;
+    struct in6_addr ip;
+
+    if (!acl_enabled) {
+        return 1;
+    }
+
+    // Sous-réseaux contenant le client, du moins précis au plus précis
+    sockaddr_to_in6(addr, &ip);
+    int node = 0;
+    for (int bit = 0; node >= 0; ++bit) {
+        if (nodes[node].num_rules > 0) {
+            candidates[num_candidates++] = node;
+        }
+        node = bit < 128 ? nodes[node].child[address_bit(&ip, bit)] : -1;
+    }
+
+    // Préfixes du chemin à une limite de segment, du plus long au plus court ("" en dernier) ;
+    // aucune règle n'atteint ACL_MAX_PATH octets
+    size_t length = strlen(filename);
+    if (length < ACL_MAX_PATH) {
+        prefixes[num_prefixes++] = length;
+    }
+    for (size_t k = length < ACL_MAX_PATH ? length : ACL_MAX_PATH; k > 1; --k) {
+        if (filename[k - 1] == '/') {
+            prefixes[num_prefixes++] = k - 1;
+        }
+    }
+    if (length > 0) {
+        prefixes[num_prefixes++] = 0;
+    }
+
+    for (int i = num_candidates - 1; i >= 0; --i) {
+        for (int p = 0; p < num_prefixes; ++p) {
+            const AclRule* rule = find_rule(&nodes[candidates[i]], filename, prefixes[p]);
+            if (rule != NULL) {
+                int allowed = (rule->access & access) != 0;
+                if (allowed) {
+                    stats.allowed++;
+                } else {
+                    stats.denied++;
+                }
+                return allowed;
+            }
+        }
+    }
+    stats.denied++;
+    return 0;
+}
+
+
+
+/**
+ * \brief Retourne les compteurs du contrôle d'accès.
+ *
+ * \return Les compteurs.
+ */
+AclStats acl_get_stats(void) {
+    return stats;
+}
@@ -0,0 +1,95 @@
+/*
+   Contrôle d'accès par sous-réseau et préfixe de chemin - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#ifndef ACL
+#define ACL
+
+
+#define ACL_READ 1 // Lecture (RRQ)
+#define ACL_WRITE 2 // Écriture (WRQ)
+#define ACL_MAX_PATH 256 // Longueur maximale d'un préfixe de chemin
+
+
+// Nœud de l'arbre binaire des sous-réseaux (un niveau par bit d'adresse, 128 au plus)
+typedef struct {
+    int child[2]; // Indices des fils (bit 0, bit 1), -1 si absent
+    int first_rule; // Indice de la première règle du sous-réseau (règles triées par chemin)
+    int num_rules; // Nombre de règles du sous-réseau (0 si le nœud n'est qu'un passage)
+} AclNode;
+
+
+// Règle de chemin attachée à un sous-réseau
+typedef struct {
+    char path[ACL_MAX_PATH]; // Préfixe du chemin, sans '/' initial ni final ("" : tous les fichiers)
+    size_t path_len; // Longueur du préfixe
+    int access; // Droits accordés (ACL_READ | ACL_WRITE, 0 : refus)
+    int node; // Nœud du sous-réseau (utilisé pendant la compilation)
+} AclRule;
+
+
+// Compteurs du contrôle d'accès
+typedef struct {
+    unsigned long allowed; // Requêtes autorisées
+    unsigned long denied; // Requêtes refusées
+} AclStats;
+
+
+
+/**
+ * \brief Charge et compile les règles d'accès depuis un fichier de configuration.
+ *
+ * Chaque ligne contient un sous-réseau IPv4 ou IPv6, un préfixe de chemin et des droits
+ * ("read", "write", "rw" ou "deny") :
+ *
+ *     0.0.0.0/0       /           read
+ *     10.1.2.0/24     uploads/    rw
+ *     10.1.2.66       /           deny
+ *
+ * Le sous-réseau le plus précis contenant le client s'applique ; parmi ses règles, celle
+ * dont le préfixe de chemin est le plus long. Un préfixe couvre des segments entiers :
+ * "secret" (ou "secret/") s'applique à "secret" et "secret/x", pas à "secret2.txt". Si aucun préfixe ne correspond, les
+ * sous-réseaux moins précis sont examinés. Sans règle applicable, l'accès est refusé.
+ * Un nouvel appel (rechargement) remplace les règles ; en cas d'erreur de lecture, les
+ * règles précédentes restent en vigueur.
+ *
+ * \param config Le chemin du fichier de configuration.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int acl_load(const char* config);
+
+
+
+/**
+ * \brief Vérifie qu'un client peut accéder à un fichier.
+ *
+ * Le sous-réseau est trouvé en parcourant l'arbre (au plus 128 nœuds), sans allocation ;
+ * les préfixes du chemin (un par segment) sont cherchés par dichotomie dans les règles
+ * du sous-réseau, sans parcourir celles-ci. Sans configuration chargée, tout accès est
+ * autorisé. Les segments sont comparés octet par octet : le chemin doit avoir été
+ * normalisé, sans quoi "./secret/x" échapperait à une règle "secret/".
+ *
+ * \param addr L'adresse du client.
+ * \param filename Le fichier demandé, normalisé (voir tftp_normalize_path).
+ * \param access Le droit demandé (ACL_READ ou ACL_WRITE).
+ * \return 1 si l'accès est autorisé, 0 sinon.
+ */
+int acl_check(const struct sockaddr_storage* addr, const char* filename, int access);
+
+
+
+/**
+ * \brief Retourne les compteurs du contrôle d'accès.
+ *
+ * \return Les compteurs.
+ */
+AclStats acl_get_stats(void);
+
+#endif
@@ -0,0 +1,356 @@
+#include "admit.h"
+
+#include <ctype.h>
+
+
+// Limites d'admission
+typedef struct {
+    int sessions; // Sessions actives
+    long inflight; // Octets de fenêtre réservés (0 : illimité)
+    int files; // Sessions lisant ou écrivant un fichier
+    int queue; // Longueur de la file d'attente
+    int64_t wait; // Attente maximale en file (ns)
+    long small; // Taille (octets) en dessous de laquelle un fichier est prioritaire
+    struct in6_addr trusted[ADMIT_MAX_TRUSTED]; // Sous-réseaux prioritaires
+    int trusted_len[ADMIT_MAX_TRUSTED]; // Longueur de leur préfixe sur 128 bits
+    int num_trusted;
+} AdmitLimits;
+
+// Classes de priorité (additionnées)
+#define PRIORITY_SMALL 1
+#define PRIORITY_TRUSTED 2
+
+
+// Limites sans configuration (inflight illimité, aucun sous-réseau prioritaire)
+#define DEFAULT_LIMITS { \
+    .sessions = ADMIT_DEFAULT_SESSIONS, \
+    .files = ADMIT_DEFAULT_FILES, \
+    .queue = ADMIT_DEFAULT_QUEUE, \
+    .wait = (int64_t) ADMIT_DEFAULT_WAIT_MS * CLOCK_NS_PER_MS, \
+    .small = ADMIT_DEFAULT_SMALL_KB * 1024L \
+}
+
+
+static AdmitLimits limits = DEFAULT_LIMITS;
+
+// Ressources prises par les sessions en cours
+static int used_sessions = 0;
+static long used_inflight = 0;
+static int used_files = 0;
+
+// Requêtes en attente, sans ordre (la file est courte : parcours linéaire)
+static AdmitRequest queue[ADMIT_MAX_QUEUE];
+static int queue_len = 0;
+static AdmitStats stats;
+
+
+
+/**
+ * \brief Charge les limites d'admission depuis un fichier de configuration.
+ *
+ * \param config Le chemin du fichier de configuration.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int admit_load(const char* config) {
+    char line[256];
+    char keyword[32];
+    char value[64];
+    int line_number = 0;
+    AdmitLimits loaded = DEFAULT_LIMITS;
+
+    FILE* file = fopen(config, "r");
+    if (file == NULL) {
+        perror("Erreur lors de l'ouverture de la configuration d'admission");
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char* start = line;
+        while (isspace((unsigned char)*start)) {
+            start++;
+        }
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+        if (sscanf(start, "%31s %63s", keyword, value) != 2) {
+            printf("Admission : ligne %d invalide\n", line_number);
+            continue;
+        }
+
+        if (strcmp(keyword, "trusted") == 0) {
+            if (loaded.num_trusted == ADMIT_MAX_TRUSTED) {
+                printf("Admission : plus de %d sous-réseaux prioritaires, ligne %d ignorée\n", ADMIT_MAX_TRUSTED, line_number);
+            } else if (sockaddr_parse_prefix(value, &loaded.trusted[loaded.num_trusted], &loaded.trusted_len[loaded.num_trusted]) != 0) {
+                printf("Admission : sous-réseau invalide ligne %d\n", line_number);
+            } else {
+                loaded.num_trusted++;
+            }
+            continue;
+        }
+
+        char* end;
+        long number = strtol(value, &end, 10);
+        if (*end != '\0' || number < 0) {
+            printf("Admission : valeur invalide ligne %d\n", line_number);
+            continue;
+        }
+        if (strcmp(keyword, "sessions") == 0 && number >= 1) {
+            loaded.sessions = number < FD_SETSIZE ? (int) number : FD_SETSIZE;
+        } else if (strcmp(keyword, "inflight") == 0) {
+            loaded.inflight = number * 1024;
+        } else if (strcmp(keyword, "files") == 0 && number >= 1) {
+            loaded.files = number < FD_SETSIZE ? (int) number : FD_SETSIZE;
+        } else if (strcmp(keyword, "queue") == 0) {
+            loaded.queue = number < ADMIT_MAX_QUEUE ? (int) number : ADMIT_MAX_QUEUE;
+        } else if (strcmp(keyword, "wait") == 0) {
+            loaded.wait = (int64_t) number * CLOCK_NS_PER_MS;
+        } else if (strcmp(keyword, "small") == 0) {
+            loaded.small = number * 1024;
+        } else {
+            printf("Admission : mot-clé %s invalide ligne %d\n", keyword, line_number);
+        }
+    }
+
+    fclose(file);
+    limits = loaded;
+    printf("Admission : %d sessions, %ld Ko en vol%s, %d fichiers, file de %d requêtes (%ld ms), %d sous-réseaux prioritaires\n",
+           limits.sessions, limits.inflight / 1024, limits.inflight == 0 ? " (illimité)" : "", limits.files,
+           limits.queue, (long) (limits.wait / CLOCK_NS_PER_MS), limits.num_trusted);
+    return 0;
+}
+
+
+
+/**
+ * \brief Indique si une nouvelle session peut démarrer sans dépasser les limites.
+ *
+ * \return 1 si la capacité le permet, 0 sinon.
+ */
+int admit_available(void) {
+    return used_sessions < limits.sessions && used_files < limits.files
+        && (limits.inflight == 0 || used_inflight < limits.inflight);
+}
+
+
+
+/**
+ * \brief Compte les ressources prises par une session.
+ *
+ * \param sessions Le nombre de sessions.
+ * \param bytes Les octets de fenêtre réservés.
+ * \param files Le nombre de fichiers ouverts.
+ */
+void admit_acquire(int sessions, long bytes, int files) {
+    used_sessions += sessions;
+    used_inflight += bytes;
+    used_files += files;
+}
+
+
+
+/**
+ * \brief Rend les ressources d'une session (voir admit_acquire).
+ *
+ * \param sessions Le nombre de sessions.
+ * \param bytes Les octets de fenêtre réservés.
+ * \param files Le nombre de fichiers ouverts.
+ */
+void admit_release(int sessions, long bytes, int files) {
+    used_sessions -= sessions;
+    used_inflight -= bytes;
+    used_files -= files;
+}
+
+
+
+/**
+ * \brief Compte une requête servie sans attente.
+ */
+void admit_count_direct(void) {
+    stats.admitted++;
+}
+
+
+
+/**
+ * \brief Indique si la requête a est plus prioritaire que la requête b.
+ *
+ * \param a La première requête.
+ * \param b La seconde requête.
+ * \return 1 si a passe avant b, 0 sinon.
+ */
+static int higher_priority(const AdmitRequest* a, const AdmitRequest* b) {
+    return a->priority > b->priority || (a->priority == b->priority && a->arrival < b->arrival);
+}
+
+
+
+/**
+ * \brief Calcule la classe de priorité d'une requête.
+ *
+ * \param addr L'adresse du client.
+ * \param size La taille du fichier demandé, ou -1 si elle est inconnue.
+ * \return La somme des classes PRIORITY_*.
+ */
+static int request_priority(const struct sockaddr_storage* addr, long size) {
+    struct in6_addr ip;
+    int priority = 0;
+
+    if (size >= 0 && size < limits.small) {
+        priority += PRIORITY_SMALL;
+    }
+    sockaddr_to_in6(addr, &ip);
+    for (int i = 0; i < limits.num_trusted; ++i) {
+        if (sockaddr_prefix_match(&ip, &limits.trusted[i], limits.trusted_len[i])) {
+            priority += PRIORITY_TRUSTED;
+            break;
+        }
+    }
+    return priority;
+}
+
+
+
+/**
+ * \brief Met une requête en attente de capacité.
+ *
+ * \param packet Le datagramme reçu.
+ * \param length Sa taille (au plus MAX_PACKET_SIZE).
+ * \param addr L'adresse du client.
+ * \param addr_len La taille de l'adresse.
+ * \param size La taille du fichier demandé, ou -1 si elle est inconnue.
+ * \param evicted Reçoit la requête retirée de la file (si ADMIT_EVICTED).
+ * \return ADMIT_QUEUED, ADMIT_EVICTED ou ADMIT_REFUSED.
+ */
+int admit_enqueue(const char* packet, int length, const struct sockaddr_storage* addr, socklen_t addr_len, long size, AdmitRequest* evicted) {
+    AdmitRequest request;
+    int slot = -1;
+    int result = ADMIT_QUEUED;
+
+    memcpy(request.packet, packet, length);
+    request.packet[length] = '\0';
+    request.length = length;
+    memcpy(&request.addr, addr, sizeof(request.addr));
+    request.addr_len = addr_len;
+    request.priority = request_priority(addr, size);
+    request.arrival = clock_now();
+
+    // Retransmission d'une requête déjà en file : elle garde sa place
+    for (int i = 0; i < queue_len; ++i) {
+        if (sockaddr_equal(&queue[i].addr, addr)) {
+            request.arrival = queue[i].arrival;
+            queue[i] = request;
+            return ADMIT_QUEUED;
+        }
+    }
+
+    if (queue_len < limits.queue) {
+        slot = queue_len++;
+    } else if (queue_len > 0) {
+        // File pleine : la moins prioritaire cède sa place si la nouvelle passe avant elle
+        int worst = 0;
+        for (int i = 1; i < queue_len; ++i) {
+            if (higher_priority(&queue[worst], &queue[i])) {
+                worst = i;
+            }
+        }
+        if (queue[worst].priority < request.priority) {
+            *evicted = queue[worst];
+            slot = worst;
+            result = ADMIT_EVICTED;
+            stats.evicted++;
+        }
+    }
+    if (slot < 0) {
+        stats.refused++;
+        return ADMIT_REFUSED;
+    }
+
+    queue[slot] = request;
+    stats.queued++;
+    if (queue_len > stats.peak_queue) {
+        stats.peak_queue = queue_len;
+    }
+    return result;
+}
+
+
+
+/**
+ * \brief Retire de la file la prochaine requête à traiter.
+ *
+ * \param now La date courante (ns, voir clock_now).
+ * \param out Reçoit la requête.
+ * \return ADMIT_NONE, ADMIT_READY ou ADMIT_EXPIRED.
+ */
+int admit_next(int64_t now, AdmitRequest* out) {
+    int chosen = -1;
+    int result = ADMIT_NONE;
+
+    for (int i = 0; i < queue_len && chosen < 0; ++i) {
+        if (now - queue[i].arrival >= limits.wait) {
+            chosen = i;
+            result = ADMIT_EXPIRED;
+            stats.expired++;
+        }
+    }
+    if (chosen < 0 && queue_len > 0 && admit_available()) {
+        chosen = 0;
+        for (int i = 1; i < queue_len; ++i) {
+            if (higher_priority(&queue[i], &queue[chosen])) {
+                chosen = i;
+            }
+        }
+        result = ADMIT_READY;
+        stats.dequeued++;
+    }
+    if (chosen < 0) {
+        return ADMIT_NONE;
+    }
+
+    *out = queue[chosen];
+    queue[chosen] = queue[--queue_len];
+    return result;
+}
+
+
+
+/**
+ * \brief Retourne le nombre de requêtes en file.
+ *
+ * \return Le nombre de requêtes en attente.
+ */
+int admit_queued(void) {
+    return queue_len;
+}
+
+
+
+/**
+ * \brief Retourne la date à laquelle la plus ancienne requête en file expire.
+ *
+ * \return L'échéance (ns, horloge monotone), ou 0 si la file est vide.
+ */
+int64_t admit_deadline(void) {
+    int64_t deadline = 0;
+
+    for (int i = 0; i < queue_len; ++i) {
+        int64_t expires = queue[i].arrival + limits.wait;
+        if (deadline == 0 || expires < deadline) {
+            deadline = expires;
+        }
+    }
+    return deadline;
+}
+
+
+
+/**
+ * \brief Retourne les compteurs du contrôle d'admission.
+ *
+ * \return Les compteurs.
+ */
+AdmitStats admit_get_stats(void) {
+    return stats;
+}
@@ -0,0 +1,189 @@
+/*
+   Contrôle d'admission des requêtes et file d'attente prioritaire en cas de surcharge - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "tftp.h"
+#include "clock.h"
+
+#ifndef ADMIT
+#define ADMIT
+
+
+#define ADMIT_MAX_QUEUE 1024 // Capacité maximale de la file d'attente
+#define ADMIT_MAX_TRUSTED 64 // Nombre maximal de sous-réseaux prioritaires
+#define ADMIT_RESERVED_FDS 64 // Descripteurs réservés au serveur (caches, pack, multicast...)
+
+// Valeurs par défaut : chaque session occupe un socket et au plus un fichier, tous deux sous FD_SETSIZE (select)
+#define ADMIT_DEFAULT_SESSIONS ((FD_SETSIZE - ADMIT_RESERVED_FDS) / 2)
+#define ADMIT_DEFAULT_FILES ((FD_SETSIZE - ADMIT_RESERVED_FDS) / 2)
+#define ADMIT_DEFAULT_QUEUE 64
+#define ADMIT_DEFAULT_WAIT_MS 3000
+#define ADMIT_DEFAULT_SMALL_KB 64
+
+// Résultat de admit_enqueue
+#define ADMIT_QUEUED 0 // Requête mise en file
+#define ADMIT_EVICTED 1 // Requête mise en file à la place d'une requête moins prioritaire (à refuser)
+#define ADMIT_REFUSED 2 // File pleine de requêtes au moins aussi prioritaires : requête refusée
+
+// Résultat de admit_next
+#define ADMIT_NONE 0 // Rien à faire
+#define ADMIT_READY 1 // Requête à servir : la capacité le permet
+#define ADMIT_EXPIRED 2 // Requête restée trop longtemps en file : à refuser
+
+
+// Requête en attente de capacité
+typedef struct {
+    char packet[MAX_PACKET_SIZE + 1]; // Datagramme reçu (terminé par '\0')
+    int length; // Taille du datagramme
+    struct sockaddr_storage addr; // Adresse du client
+    socklen_t addr_len; // Taille de l'adresse
+    int priority; // Classe de priorité (sous-réseau prioritaire, petit fichier)
+    int64_t arrival; // Date de mise en file (ns, horloge monotone)
+} AdmitRequest;
+
+
+// Compteurs du contrôle d'admission
+typedef struct {
+    unsigned long admitted; // Requêtes servies sans attente
+    unsigned long queued; // Requêtes mises en file
+    unsigned long dequeued; // Requêtes servies après attente
+    unsigned long refused; // Requêtes refusées, file pleine
+    unsigned long evicted; // Requêtes retirées de la file au profit d'une plus prioritaire
+    unsigned long expired; // Requêtes refusées après une attente trop longue
+    int peak_queue; // Longueur maximale atteinte par la file
+} AdmitStats;
+
+
+
+/**
+ * \brief Charge les limites d'admission depuis un fichier de configuration.
+ *
+ * Chaque ligne contient un mot-clé et sa valeur :
+ *
+ *     sessions   400          # sessions actives
+ *     inflight   32768        # Ko de fenêtres réservées par les sessions
+ *     files      300          # sessions lisant ou écrivant un fichier
+ *     queue      128          # requêtes en attente (0 : refus immédiat)
+ *     wait       2000         # attente maximale en file (ms)
+ *     small      64           # taille (Ko) en dessous de laquelle un fichier est prioritaire
+ *     trusted    10.1.0.0/16  # sous-réseau prioritaire (plusieurs lignes possibles)
+ *
+ * Les mots-clés absents gardent leur valeur par défaut ; inflight vaut 0 (illimité) par
+ * défaut. Un nouvel appel (rechargement) remplace la configuration ; en cas d'erreur de
+ * lecture, la configuration précédente reste en vigueur.
+ *
+ * \param config Le chemin du fichier de configuration.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int admit_load(const char* config);
+
+
+
+/**
+ * \brief Indique si une nouvelle session peut démarrer sans dépasser les limites.
+ *
+ * \return 1 si la capacité le permet, 0 sinon.
+ */
+int admit_available(void);
+
+
+
+/**
+ * \brief Compte les ressources prises par une session.
+ *
+ * \param sessions Le nombre de sessions.
+ * \param bytes Les octets de fenêtre réservés.
+ * \param files Le nombre de fichiers ouverts.
+ */
+void admit_acquire(int sessions, long bytes, int files);
+
+
+
+/**
+ * \brief Rend les ressources d'une session (voir admit_acquire).
+ *
+ * \param sessions Le nombre de sessions.
+ * \param bytes Les octets de fenêtre réservés.
+ * \param files Le nombre de fichiers ouverts.
+ */
+void admit_release(int sessions, long bytes, int files);
+
+
+
+/**
+ * \brief Compte une requête servie sans attente.
+ */
+void admit_count_direct(void);
+
+
+
+/**
+ * \brief Met une requête en attente de capacité.
+ *
+ * Priorité décroissante : client d'un sous-réseau prioritaire, puis fichier de petite
+ * taille, puis ordre d'arrivée. Une requête répétée par le même client (retransmission)
+ * remplace la précédente sans perdre sa place. Si la file est pleine, la requête la moins
+ * prioritaire (la plus récente à priorité égale) est retirée au profit de la nouvelle, ou
+ * la nouvelle est refusée.
+ *
+ * \param packet Le datagramme reçu.
+ * \param length Sa taille (au plus MAX_PACKET_SIZE).
+ * \param addr L'adresse du client.
+ * \param addr_len La taille de l'adresse.
+ * \param size La taille du fichier demandé, ou -1 si elle est inconnue.
+ * \param evicted Reçoit la requête retirée de la file (si ADMIT_EVICTED).
+ * \return ADMIT_QUEUED, ADMIT_EVICTED ou ADMIT_REFUSED.
+ */
+int admit_enqueue(const char* packet, int length, const struct sockaddr_storage* addr, socklen_t addr_len, long size, AdmitRequest* evicted);
+
+
+
+/**
+ * \brief Retire de la file la prochaine requête à traiter.
+ *
+ * Les requêtes ayant dépassé l'attente maximale sont rendues en premier (à refuser),
+ * puis la plus prioritaire si la capacité le permet.
+ *
+ * \param now La date courante (ns, voir clock_now).
+ * \param out Reçoit la requête.
+ * \return ADMIT_NONE, ADMIT_READY ou ADMIT_EXPIRED.
+ */
+int admit_next(int64_t now, AdmitRequest* out);
+
+
+
+/**
+ * \brief Retourne le nombre de requêtes en file.
+ *
+ * \return Le nombre de requêtes en attente.
+ */
+int admit_queued(void);
+
+
+
+/**
+ * \brief Retourne la date à laquelle la plus ancienne requête en file expire.
+ *
+ * \return L'échéance (ns, horloge monotone), ou 0 si la file est vide.
+ */
+int64_t admit_deadline(void);
+
+
+
+/**
+ * \brief Retourne les compteurs du contrôle d'admission.
+ *
+ * \return Les compteurs.
+ */
+AdmitStats admit_get_stats(void);
+
+#endif
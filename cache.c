@@ -0,0 +1,344 @@
+#include "cache.h"
+
+
+// Entrées du cache et mémoire totale occupée
+static CacheEntry* entries[CACHE_MAX_ENTRIES];
+static size_t cache_bytes = 0;
+static size_t cache_max_bytes = CACHE_DEFAULT_BYTES;
+static unsigned long cache_clock = 0;
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+/**
+ * \brief Calcule l'empreinte d'une clé (djb2).
+ *
+ * \param key La clé.
+ * \return L'empreinte.
+ */
+static unsigned long hash_key(const char* key) {
+    unsigned long hash = 5381;
+    while (*key) {
+        hash = hash * 33 + (unsigned char)*key++;
+    }
+    return hash;
+}
+
+
+
+/**
+ * \brief Libère une entrée du cache et son contenu.
+ *
+ * \param index L'indice de l'entrée dans le tableau.
+ */
+static void free_entry(int index) {
+    cache_bytes -= entries[index]->len;
+    free(entries[index]->data);
+    free(entries[index]);
+    entries[index] = NULL;
+}
+
+
+
+/**
+ * \brief Évince l'entrée non référencée la moins récemment utilisée.
+ *
+ * \return 0 si une entrée a été évincée, -1 sinon.
+ */
+static int evict_one(void) {
+    int victim = -1;
+    for (int i = 0; i < CACHE_MAX_ENTRIES; ++i) {
+        if (entries[i] != NULL && entries[i]->refs == 0) {
+            if (victim < 0 || entries[i]->last_used < entries[victim]->last_used) {
+                victim = i;
+            }
+        }
+    }
+    if (victim < 0) {
+        return -1;
+    }
+    free_entry(victim);
+    return 0;
+}
+
+
+
+/**
+ * \brief Retourne l'indice d'un emplacement libre.
+ *
+ * \return L'indice, ou -1 si le tableau est plein.
+ */
+static int free_slot(void) {
+    for (int i = 0; i < CACHE_MAX_ENTRIES; ++i) {
+        if (entries[i] == NULL) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+
+/**
+ * \brief Retire une entrée du tableau ; une entrée référencée est libérée au dernier cache_release.
+ *
+ * \param index L'indice de l'entrée dans le tableau.
+ */
+static void remove_entry(int index) {
+    if (entries[index]->refs == 0) {
+        free_entry(index);
+    } else {
+        entries[index]->stale = 1;
+        entries[index] = NULL;
+    }
+}
+
+
+
+/**
+ * \brief Indique si une entrée a été construite à partir de l'état actuel du fichier source.
+ *
+ * \param entry L'entrée.
+ * \param st Les métadonnées actuelles du fichier source.
+ * \return 1 si le fichier est inchangé, 0 sinon.
+ */
+static int same_source(const CacheEntry* entry, const struct stat* st) {
+    return entry->dev == st->st_dev && entry->ino == st->st_ino && entry->size == st->st_size
+        && entry->mtim.tv_sec == st->st_mtim.tv_sec && entry->mtim.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+
+
+/**
+ * \brief Recherche une entrée valide dans le cache.
+ *
+ * \param key La clé de l'entrée.
+ * \param st Les métadonnées actuelles du fichier source (NULL pour un contenu sans fichier source).
+ * \return Un pointeur vers l'entrée, ou NULL si absente, expirée ou périmée.
+ */
+CacheEntry* cache_lookup(const char* key, const struct stat* st) {
+    unsigned long hash = hash_key(key);
+    CacheEntry* found = NULL;
+
+    pthread_mutex_lock(&cache_mutex);
+    for (int i = 0; i < CACHE_MAX_ENTRIES; ++i) {
+        CacheEntry* entry = entries[i];
+        if (entry == NULL || entry->hash != hash || strcmp(entry->key, key) != 0) {
+            continue;
+        }
+
+        // Le fichier source a changé depuis la mise en cache, ou l'entrée a expiré
+        if ((st != NULL && !same_source(entry, st))
+            || (entry->expires != 0 && clock_read() >= entry->expires)) {
+            remove_entry(i);
+            break;
+        }
+
+        entry->refs++;
+        entry->last_used = ++cache_clock;
+        found = entry;
+        break;
+    }
+    pthread_mutex_unlock(&cache_mutex);
+    return found;
+}
+
+
+
+/**
+ * \brief Insère un contenu dans le cache (verrou déjà pris).
+ *
+ * \param key La clé de l'entrée.
+ * \param st Les métadonnées du fichier source (NULL si aucun).
+ * \param data Le contenu à mettre en cache.
+ * \param len La taille du contenu.
+ * \param expires La date d'expiration (ns, horloge monotone ; 0 si aucune).
+ * \return L'entrée référencée, ou NULL si le cache est plein.
+ */
+static CacheEntry* insert_locked(const char* key, const struct stat* st, char* data, size_t len, int64_t expires) {
+    if (len > cache_max_bytes) {
+        return NULL;
+    }
+
+    // Faire de la place en mémoire
+    while (cache_bytes + len > cache_max_bytes) {
+        if (evict_one() != 0) {
+            return NULL;
+        }
+    }
+
+    int slot = free_slot();
+    if (slot < 0) {
+        if (evict_one() != 0) {
+            return NULL;
+        }
+        slot = free_slot();
+    }
+
+    CacheEntry* entry = malloc(sizeof(CacheEntry));
+    if (entry == NULL) {
+        return NULL;
+    }
+    strcpy(entry->key, key);
+    entry->hash = hash_key(key);
+    if (st != NULL) {
+        entry->dev = st->st_dev;
+        entry->ino = st->st_ino;
+        entry->mtim = st->st_mtim;
+        entry->size = st->st_size;
+    } else {
+        entry->dev = 0;
+        entry->ino = 0;
+        entry->mtim.tv_sec = 0;
+        entry->mtim.tv_nsec = 0;
+        entry->size = 0;
+    }
+    entry->expires = expires;
+    entry->data = data;
+    entry->len = len;
+    entry->refs = 1;
+    entry->stale = 0;
+    entry->last_used = ++cache_clock;
+
+    // Remplacer une éventuelle entrée de même clé (insertion concurrente)
+    for (int i = 0; i < CACHE_MAX_ENTRIES; ++i) {
+        CacheEntry* old = entries[i];
+        if (old != NULL && old->hash == entry->hash && strcmp(old->key, key) == 0) {
+            remove_entry(i);
+        }
+    }
+
+    entries[slot] = entry;
+    cache_bytes += len;
+    return entry;
+}
+
+
+
+/**
+ * \brief Insère un contenu dans le cache.
+ *
+ * \param key La clé de l'entrée.
+ * \param st Les métadonnées du fichier source.
+ * \param data Le contenu à mettre en cache.
+ * \param len La taille du contenu.
+ * \return L'entrée référencée, ou NULL si le cache est plein.
+ */
+CacheEntry* cache_insert(const char* key, const struct stat* st, char* data, size_t len) {
+    CacheEntry* entry = NULL;
+
+    if (strlen(key) >= CACHE_KEY_LENGTH) {
+        free(data);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache_mutex);
+    entry = insert_locked(key, st, data, len, 0);
+    pthread_mutex_unlock(&cache_mutex);
+    if (entry == NULL) {
+        free(data);
+    }
+    return entry;
+}
+
+
+
+/**
+ * \brief Insère un contenu sans fichier source, valide pendant une durée limitée.
+ *
+ * \param key La clé de l'entrée.
+ * \param data Le contenu à mettre en cache.
+ * \param len La taille du contenu.
+ * \param ttl La durée de validité en secondes.
+ * \return L'entrée référencée, ou NULL si le cache est plein.
+ */
+CacheEntry* cache_insert_ttl(const char* key, char* data, size_t len, int ttl) {
+    CacheEntry* entry = NULL;
+
+    if (strlen(key) >= CACHE_KEY_LENGTH) {
+        free(data);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache_mutex);
+    // Horloge lue ici : le cache est aussi utilisé par les threads de préchargement (warm)
+    entry = insert_locked(key, NULL, data, len, clock_read() + ttl * CLOCK_NS_PER_SEC);
+    pthread_mutex_unlock(&cache_mutex);
+    if (entry == NULL) {
+        free(data);
+    }
+    return entry;
+}
+
+
+
+/**
+ * \brief Invalide les entrées dérivées d'un fichier (contenu converti, trames, index).
+ *
+ * \param filename Le chemin du fichier (tel qu'employé dans les clés).
+ */
+void cache_invalidate_file(const char* filename) {
+    size_t name_len = strlen(filename);
+
+    pthread_mutex_lock(&cache_mutex);
+    for (int i = 0; i < CACHE_MAX_ENTRIES; ++i) {
+        if (entries[i] == NULL) {
+            continue;
+        }
+        size_t key_len = strlen(entries[i]->key);
+        if (key_len > name_len && entries[i]->key[key_len - name_len - 1] == ':'
+            && strcmp(entries[i]->key + key_len - name_len, filename) == 0) {
+            remove_entry(i);
+        }
+    }
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+
+
+/**
+ * \brief Définit la taille maximale du contenu en cache.
+ *
+ * \param max_bytes La taille maximale en octets.
+ */
+void cache_set_limit(size_t max_bytes) {
+    pthread_mutex_lock(&cache_mutex);
+    cache_max_bytes = max_bytes;
+    pthread_mutex_unlock(&cache_mutex);
+}
+
+
+
+/**
+ * \brief Retourne la taille maximale du contenu en cache.
+ *
+ * \return La taille maximale en octets.
+ */
+size_t cache_get_limit(void) {
+    pthread_mutex_lock(&cache_mutex);
+    size_t max_bytes = cache_max_bytes;
+    pthread_mutex_unlock(&cache_mutex);
+    return max_bytes;
+}
+
+
+
+/**
+ * \brief Libère une référence sur une entrée du cache.
+ *
+ * \param entry L'entrée à libérer (NULL accepté).
+ */
+void cache_release(CacheEntry* entry) {
+    if (entry == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&cache_mutex);
+    entry->refs--;
+    if (entry->stale && entry->refs == 0) {
+        // Entrée déjà retirée du tableau : seule sa mémoire reste à libérer
+        cache_bytes -= entry->len;
+        free(entry->data);
+        free(entry);
+    }
+    pthread_mutex_unlock(&cache_mutex);
+}
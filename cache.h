@@ -0,0 +1,128 @@
+/*
+   Cache de contenu en mémoire - Définitions et structures de données
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <pthread.h>
+
+#include "clock.h"
+
+#ifndef CACHE
+#define CACHE
+
+
+// Limites du cache
+#define CACHE_MAX_ENTRIES 1024
+#define CACHE_DEFAULT_BYTES (64L * 1024 * 1024)
+#define CACHE_KEY_LENGTH 520
+
+
+// Entrée du cache : contenu complet d'un fichier (éventuellement transformé)
+// Les fonctions du cache peuvent être appelées depuis plusieurs threads.
+typedef struct {
+    char key[CACHE_KEY_LENGTH]; // Clé (ex: "netascii:boot/pxelinux.cfg")
+    unsigned long hash; // Empreinte de la clé
+    dev_t dev; // Périphérique du fichier source
+    ino_t ino; // Inode du fichier source (un fichier reçu remplace l'inode)
+    struct timespec mtim; // Date de modification du fichier source (à la nanoseconde)
+    off_t size; // Taille du fichier source
+    char* data; // Contenu mis en cache
+    size_t len; // Taille du contenu
+    int refs; // Nombre de sessions utilisant l'entrée
+    int stale; // L'entrée est périmée et sera libérée au dernier cache_release
+    unsigned long last_used; // Horodatage logique pour l'éviction LRU
+    int64_t expires; // Date d'expiration (ns, horloge monotone ; 0 : valide tant que le fichier source est inchangé)
+} CacheEntry;
+
+
+
+/**
+ * \brief Recherche une entrée valide dans le cache.
+ *
+ * L'entrée n'est retournée que si le fichier source est le même (périphérique et
+ * inode) et que sa date de modification (à la nanoseconde) et sa taille correspondent
+ * à celles enregistrées. Une entrée retournée est référencée
+ * et doit être libérée avec cache_release().
+ *
+ * \param key La clé de l'entrée.
+ * \param st Les métadonnées actuelles du fichier source (NULL pour un contenu sans fichier source).
+ * \return Un pointeur vers l'entrée, ou NULL si absente, expirée ou périmée.
+ */
+CacheEntry* cache_lookup(const char* key, const struct stat* st);
+
+
+
+/**
+ * \brief Insère un contenu dans le cache.
+ *
+ * Le cache prend possession du tampon data (alloué avec malloc). Les entrées les moins
+ * récemment utilisées et non référencées sont évincées pour respecter la taille maximale.
+ *
+ * \param key La clé de l'entrée.
+ * \param st Les métadonnées du fichier source.
+ * \param data Le contenu à mettre en cache.
+ * \param len La taille du contenu.
+ * \return L'entrée référencée, ou NULL si le cache est plein (data est alors libéré).
+ */
+CacheEntry* cache_insert(const char* key, const struct stat* st, char* data, size_t len);
+
+
+
+/**
+ * \brief Insère un contenu sans fichier source, valide pendant une durée limitée.
+ *
+ * \param key La clé de l'entrée.
+ * \param data Le contenu à mettre en cache.
+ * \param len La taille du contenu.
+ * \param ttl La durée de validité en secondes.
+ * \return L'entrée référencée, ou NULL si le cache est plein (data est alors libéré).
+ */
+CacheEntry* cache_insert_ttl(const char* key, char* data, size_t len, int ttl);
+
+
+
+/**
+ * \brief Invalide les entrées dérivées d'un fichier (contenu converti, trames, index).
+ *
+ * Toute entrée dont la clé se termine par ":" suivi du chemin est retirée : quelques
+ * entrées d'un autre fichier peuvent l'être aussi, jamais une entrée du fichier oubliée.
+ *
+ * \param filename Le chemin du fichier (tel qu'employé dans les clés).
+ */
+void cache_invalidate_file(const char* filename);
+
+
+
+/**
+ * \brief Définit la taille maximale du contenu en cache.
+ *
+ * \param max_bytes La taille maximale en octets.
+ */
+void cache_set_limit(size_t max_bytes);
+
+
+
+/**
+ * \brief Retourne la taille maximale du contenu en cache.
+ *
+ * Un contenu plus grand ne peut pas être inséré : inutile de le lire.
+ *
+ * \return La taille maximale en octets.
+ */
+size_t cache_get_limit(void);
+
+
+
+/**
+ * \brief Libère une référence sur une entrée du cache.
+ *
+ * \param entry L'entrée à libérer (NULL accepté).
+ */
+void cache_release(CacheEntry* entry);
+
+#endif
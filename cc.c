@@ -0,0 +1,175 @@
+#include "cc.h"
+
+
+// Compteurs de toutes les sessions
+static CcStats stats;
+
+
+
+/**
+ * \brief Borne cwnd entre un bloc et la fenêtre négociée.
+ *
+ * \param cc L'état de la session.
+ */
+static void clamp_cwnd(CongestionControl* cc) {
+    if (cc->cwnd < 1) {
+        cc->cwnd = 1;
+    }
+    if (cc->cwnd > cc->max_window) {
+        cc->cwnd = cc->max_window;
+    }
+}
+
+
+
+/**
+ * \brief Initialise le contrôle de congestion d'une session.
+ *
+ * \param cc L'état de la session.
+ * \param max_window La fenêtre négociée (blocs).
+ */
+void cc_init(CongestionControl* cc, int max_window) {
+    memset(cc, 0, sizeof(CongestionControl));
+    cc->max_window = max_window;
+    cc->cwnd = CC_INITIAL_WINDOW;
+    cc->ssthresh = max_window;
+    clamp_cwnd(cc);
+    cc->srtt_us = CC_INITIAL_RTT_US;
+    cc->credits = cc->cwnd;
+    cc->last_refill = clock_now();
+}
+
+
+
+/**
+ * \brief Retourne le délai avant de pouvoir envoyer le prochain bloc.
+ *
+ * Les crédits se reconstituent au rythme de cwnd blocs par RTT lissé, dans la limite de cwnd.
+ *
+ * \param cc L'état de la session.
+ * \param now La date courante (ns, voir clock_now).
+ * \return 0 si un bloc peut partir, sinon le délai en nanosecondes.
+ */
+int64_t cc_send_delay(CongestionControl* cc, int64_t now) {
+    double srtt_ns = (double) cc->srtt_us * CLOCK_NS_PER_US;
+    int64_t elapsed = now - cc->last_refill;
+
+    if (elapsed > 0) {
+        cc->credits += elapsed * cc->cwnd / srtt_ns;
+        if (cc->credits > cc->cwnd) {
+            cc->credits = cc->cwnd;
+        }
+        cc->last_refill = now;
+    }
+    if (cc->credits >= 1) {
+        return 0;
+    }
+    return (int64_t) ((1 - cc->credits) * srtt_ns / cc->cwnd) + 1;
+}
+
+
+
+/**
+ * \brief Enregistre l'envoi d'un bloc.
+ *
+ * \param cc L'état de la session.
+ */
+void cc_on_send(CongestionControl* cc) {
+    cc->credits -= 1;
+}
+
+
+
+/**
+ * \brief Met à jour cwnd à la réception d'un ACK.
+ *
+ * \param cc L'état de la session.
+ * \param acked Le nombre de blocs nouvellement acquittés.
+ * \param rtt_us Le RTT mesuré (µs), ou 0 si aucune mesure n'est disponible.
+ */
+void cc_on_ack(CongestionControl* cc, int acked, long rtt_us) {
+    int64_t now = clock_now();
+
+    if (rtt_us > 0) {
+        int first_sample = cc->base_rtt_us == 0;
+
+        // RTT de base renouvelé périodiquement : suit un changement de route
+        if (cc->base_rtt_us == 0 || rtt_us < cc->base_rtt_us || now - cc->base_rtt_time > CC_BASE_RTT_WINDOW * CLOCK_NS_PER_SEC) {
+            cc->base_rtt_us = rtt_us;
+            cc->base_rtt_time = now;
+        }
+        cc->srtt_us = first_sample ? rtt_us : (7 * cc->srtt_us + rtt_us) / 8;
+        if (cc->srtt_us < 1) {
+            cc->srtt_us = 1;
+        }
+
+        long queuing_delay = rtt_us - cc->base_rtt_us;
+        if (cc->cwnd < cc->ssthresh && queuing_delay < CC_TARGET_DELAY_US / 2) {
+            cc->cwnd += acked; // démarrage lent
+        } else {
+            double off_target = (double) (CC_TARGET_DELAY_US - queuing_delay) / CC_TARGET_DELAY_US;
+            cc->cwnd += CC_GAIN * off_target * acked / cc->cwnd;
+            if (off_target < 0 && cc->ssthresh > cc->cwnd) {
+                cc->ssthresh = cc->cwnd;
+            }
+        }
+    } else {
+        cc->cwnd += (double) acked / cc->cwnd;
+    }
+    clamp_cwnd(cc);
+    cc->in_recovery = 0;
+
+    int bucket = 0;
+    for (int w = (int) cc->cwnd; w > 1 && bucket < CC_HISTOGRAM_BUCKETS - 1; w >>= 1) {
+        bucket++;
+    }
+    stats.cwnd_histogram[bucket]++;
+    stats.acks++;
+}
+
+
+
+/**
+ * \brief Réduit cwnd après une perte signalée par le client (ACK partiel).
+ *
+ * Une seule réduction par fenêtre : les ACK partiels suivants d'une même rafale de
+ * pertes ne réduisent pas cwnd davantage.
+ *
+ * \param cc L'état de la session.
+ */
+void cc_on_loss(CongestionControl* cc) {
+    stats.losses++;
+    if (cc->in_recovery) {
+        return;
+    }
+    cc->cwnd /= 2;
+    clamp_cwnd(cc);
+    cc->ssthresh = cc->cwnd;
+    cc->in_recovery = 1;
+}
+
+
+
+/**
+ * \brief Réduit cwnd après l'expiration du délai de retransmission.
+ *
+ * \param cc L'état de la session.
+ */
+void cc_on_timeout(CongestionControl* cc) {
+    stats.timeouts++;
+    cc->ssthresh = cc->cwnd / 2 > 2 ? cc->cwnd / 2 : 2;
+    cc->cwnd = 1;
+    cc->credits = 1;
+    cc->in_recovery = 0;
+}
+
+
+
+/**
+ * \brief Retourne les compteurs du contrôle de congestion.
+ *
+ * \return Les compteurs.
+ */
+CcStats cc_get_stats(void) {
+    return stats;
+}
@@ -0,0 +1,122 @@
+/*
+   Contrôle de congestion des transferts fenêtrés (RFC 7440) - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "clock.h"
+
+#ifndef CC
+#define CC
+
+
+#define CC_INITIAL_WINDOW 4 // Fenêtre de congestion initiale (blocs)
+#define CC_INITIAL_RTT_US 10000 // RTT supposé avant la première mesure (µs)
+#define CC_TARGET_DELAY_US 25000 // Délai de file d'attente visé (µs, façon LEDBAT)
+#define CC_GAIN 1.0 // Gain de l'évitement de congestion
+#define CC_BASE_RTT_WINDOW 60 // Durée de validité du RTT de base (secondes)
+#define CC_HISTOGRAM_BUCKETS 8 // Classes de l'histogramme de cwnd (1, 2-3, 4-7, ..., 128+)
+
+
+// État du contrôle de congestion d'une session
+//
+// La fenêtre négociée (windowsize) fixe le nombre de blocs entre deux ACK du client ;
+// cwnd fixe le nombre de blocs envoyés par RTT. Si cwnd est plus petite que la fenêtre
+// négociée, les blocs de la fenêtre sont étalés sur plusieurs RTT.
+typedef struct {
+    double cwnd; // Fenêtre de congestion (blocs par RTT)
+    double ssthresh; // Seuil de fin du démarrage lent (blocs)
+    int max_window; // Fenêtre négociée avec le client (blocs)
+    long base_rtt_us; // Plus petit RTT observé (µs)
+    long srtt_us; // RTT lissé (µs)
+    int64_t base_rtt_time; // Date de la mesure du RTT de base (ns, horloge monotone)
+    double credits; // Blocs pouvant être envoyés immédiatement
+    int64_t last_refill; // Date du dernier calcul des crédits (ns)
+    int in_recovery; // Une perte a déjà réduit cwnd depuis le dernier ACK complet
+} CongestionControl;
+
+
+// Compteurs globaux du contrôle de congestion
+typedef struct {
+    unsigned long cwnd_histogram[CC_HISTOGRAM_BUCKETS]; // Distribution de cwnd, échantillonnée à chaque ACK
+    unsigned long acks; // ACK de fenêtre traités
+    unsigned long losses; // Pertes signalées par un ACK partiel
+    unsigned long timeouts; // Expirations du délai de retransmission
+} CcStats;
+
+
+
+/**
+ * \brief Initialise le contrôle de congestion d'une session.
+ *
+ * \param cc L'état de la session.
+ * \param max_window La fenêtre négociée (blocs).
+ */
+void cc_init(CongestionControl* cc, int max_window);
+
+
+
+/**
+ * \brief Retourne le délai avant de pouvoir envoyer le prochain bloc.
+ *
+ * \param cc L'état de la session.
+ * \param now La date courante (ns, voir clock_now).
+ * \return 0 si un bloc peut partir, sinon le délai en nanosecondes.
+ */
+int64_t cc_send_delay(CongestionControl* cc, int64_t now);
+
+
+
+/**
+ * \brief Enregistre l'envoi d'un bloc.
+ *
+ * \param cc L'état de la session.
+ */
+void cc_on_send(CongestionControl* cc);
+
+
+
+/**
+ * \brief Met à jour cwnd à la réception d'un ACK.
+ *
+ * Le RTT mesuré (envoi du bloc acquitté -> réception de l'ACK) est comparé au RTT de
+ * base : tant que le délai de file d'attente reste sous la cible, cwnd croît (démarrage
+ * lent, puis croissance proportionnelle à l'écart à la cible) ; au-delà, elle décroît.
+ *
+ * \param cc L'état de la session.
+ * \param acked Le nombre de blocs nouvellement acquittés.
+ * \param rtt_us Le RTT mesuré (µs), ou 0 si aucune mesure n'est disponible.
+ */
+void cc_on_ack(CongestionControl* cc, int acked, long rtt_us);
+
+
+
+/**
+ * \brief Réduit cwnd après une perte signalée par le client (ACK partiel).
+ *
+ * \param cc L'état de la session.
+ */
+void cc_on_loss(CongestionControl* cc);
+
+
+
+/**
+ * \brief Réduit cwnd après l'expiration du délai de retransmission.
+ *
+ * \param cc L'état de la session.
+ */
+void cc_on_timeout(CongestionControl* cc);
+
+
+
+/**
+ * \brief Retourne les compteurs du contrôle de congestion.
+ *
+ * \return Les compteurs.
+ */
+CcStats cc_get_stats(void);
+
+#endif
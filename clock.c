@@ -0,0 +1,42 @@
+#include "clock.h"
+
+
+// Date du dernier clock_refresh (ns)
+static int64_t now_ns = 0;
+
+
+
+/**
+ * \brief Lit l'horloge monotone et mémorise la date courante.
+ */
+void clock_refresh(void) {
+    now_ns = clock_read();
+}
+
+
+
+/**
+ * \brief Retourne la date mémorisée par le dernier clock_refresh.
+ *
+ * \return La date en nanosecondes depuis une origine arbitraire (jamais nulle).
+ */
+int64_t clock_now(void) {
+    if (now_ns == 0) {
+        clock_refresh();
+    }
+    return now_ns;
+}
+
+
+
+/**
+ * \brief Lit l'horloge monotone sans mémoriser la date (mesure de durées courtes).
+ *
+ * \return La date en nanosecondes depuis la même origine que clock_now.
+ */
+int64_t clock_read(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * CLOCK_NS_PER_SEC + ts.tv_nsec;
+}
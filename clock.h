@@ -0,0 +1,47 @@
+/*
+   Horloge monotone mise en cache par la boucle principale - Définitions et structures de données
+*/
+
+
+#include <stdint.h>
+#include <time.h>
+
+#ifndef CLOCK
+#define CLOCK
+
+
+#define CLOCK_NS_PER_SEC 1000000000LL
+#define CLOCK_NS_PER_MS 1000000LL
+#define CLOCK_NS_PER_US 1000LL
+
+
+
+/**
+ * \brief Lit l'horloge monotone et mémorise la date courante.
+ *
+ * Appelée une fois par tour de la boucle principale (au retour de select) : les
+ * délais, RTT et échéances calculés pendant le tour utilisent tous cette date, sans
+ * nouvel appel système. CLOCK_MONOTONIC ne recule pas et ne saute pas lorsque
+ * l'heure système est corrigée (NTP, date).
+ */
+void clock_refresh(void);
+
+
+
+/**
+ * \brief Retourne la date mémorisée par le dernier clock_refresh.
+ *
+ * \return La date en nanosecondes depuis une origine arbitraire (jamais nulle).
+ */
+int64_t clock_now(void);
+
+
+
+/**
+ * \brief Lit l'horloge monotone sans mémoriser la date (mesure de durées courtes).
+ *
+ * \return La date en nanosecondes depuis la même origine que clock_now.
+ */
+int64_t clock_read(void);
+
+#endif
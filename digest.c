@@ -0,0 +1,353 @@
+#include "digest.h"
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define DIGEST_X86 1
+#endif
+
+
+// Instructions disponibles, détectées au premier digest_init
+#define ENGINE_CRC32 1 // SSE4.2 (instruction crc32)
+#define ENGINE_SHA 2 // Extensions SHA (sha256rnds2, sha256msg1, sha256msg2)
+static int engine = -1;
+
+// Table du CRC32C logiciel (polynôme réfléchi 0x82F63B78)
+static uint32_t crc_table[256];
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+
+
+/**
+ * \brief Détecte les instructions disponibles et prépare la table du CRC32C logiciel.
+ */
+static void detect_engine(void) {
+    engine = 0;
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+        }
+        crc_table[i] = crc;
+    }
+
+#ifdef DIGEST_X86
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2)) {
+        engine |= ENGINE_CRC32;
+        // Les processeurs dotés des extensions SHA ont aussi SSSE3 et SSE4.1, utilisées avec elles
+        if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA)) {
+            engine |= ENGINE_SHA;
+        }
+    }
+#endif
+}
+
+
+
+/**
+ * \brief Met à jour un CRC32C (version logicielle).
+ *
+ * \param crc Le CRC en cours.
+ * \param data Les données.
+ * \param len La taille des données.
+ * \return Le nouveau CRC.
+ */
+static uint32_t crc32c_portable(uint32_t crc, const unsigned char* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        crc = (crc >> 8) ^ crc_table[(crc ^ data[i]) & 0xFF];
+    }
+    return crc;
+}
+
+
+
+#ifdef DIGEST_X86
+/**
+ * \brief Met à jour un CRC32C avec l'instruction crc32 (SSE4.2), 8 octets à la fois.
+ *
+ * \param crc Le CRC en cours.
+ * \param data Les données.
+ * \param len La taille des données.
+ * \return Le nouveau CRC.
+ */
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char* data, size_t len) {
+    uint64_t crc64 = crc;
+
+    while (len >= 8) {
+        uint64_t word;
+        memcpy(&word, data, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        data += 8;
+        len -= 8;
+    }
+    crc = (uint32_t) crc64;
+    while (len > 0) {
+        crc = _mm_crc32_u8(crc, *data++);
+        len--;
+    }
+    return crc;
+}
+
+
+
+/**
+ * \brief Traite des blocs SHA-256 de 64 octets avec les extensions SHA.
+ *
+ * \param state L'état SHA-256.
+ * \param data Les blocs.
+ * \param blocks Le nombre de blocs.
+ */
+__attribute__((target("sha,sse4.1,ssse3")))
+static void sha256_blocks_shani(uint32_t state[8], const unsigned char* data, size_t blocks) {
+    const __m128i byteswap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i msg[4];
+
+    // Réorganisation de l'état en ABEF / CDGH, attendue par sha256rnds2
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) &state[0]), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) &state[4]), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    while (blocks-- > 0) {
+        __m128i abef = state0;
+        __m128i cdgh = state1;
+
+        // 16 groupes de 4 tours ; les mots W[16..63] sont dérivés des 4 groupes précédents
+        for (int group = 0; group < 16; ++group) {
+            __m128i* w = &msg[group & 3];
+            if (group < 4) {
+                *w = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (data + 16 * group)), byteswap);
+            } else {
+                __m128i previous = msg[(group - 1) & 3];
+                __m128i sum = _mm_add_epi32(_mm_sha256msg1_epu32(*w, msg[(group - 3) & 3]),
+                                            _mm_alignr_epi8(previous, msg[(group - 2) & 3], 4));
+                *w = _mm_sha256msg2_epu32(sum, previous);
+            }
+            __m128i round = _mm_add_epi32(*w, _mm_loadu_si128((const __m128i*) &sha256_k[4 * group]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, round);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(round, 0x0E));
+        }
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+        data += 64;
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    _mm_storeu_si128((__m128i*) &state[0], _mm_blend_epi16(tmp, state1, 0xF0));
+    _mm_storeu_si128((__m128i*) &state[4], _mm_alignr_epi8(state1, tmp, 8));
+}
+#endif
+
+
+
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * \brief Traite des blocs SHA-256 de 64 octets (version logicielle).
+ *
+ * \param state L'état SHA-256.
+ * \param data Les blocs.
+ * \param blocks Le nombre de blocs.
+ */
+static void sha256_blocks_portable(uint32_t state[8], const unsigned char* data, size_t blocks) {
+    uint32_t w[64];
+
+    while (blocks-- > 0) {
+        for (int i = 0; i < 16; ++i) {
+            w[i] = ((uint32_t) data[4 * i] << 24) | ((uint32_t) data[4 * i + 1] << 16) | ((uint32_t) data[4 * i + 2] << 8) | data[4 * i + 3];
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+            uint32_t t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+        data += 64;
+    }
+}
+
+
+
+/**
+ * \brief Traite des blocs SHA-256 avec les instructions disponibles.
+ *
+ * \param state L'état SHA-256.
+ * \param data Les blocs.
+ * \param blocks Le nombre de blocs.
+ */
+static void sha256_blocks(uint32_t state[8], const unsigned char* data, size_t blocks) {
+#ifdef DIGEST_X86
+    if (engine & ENGINE_SHA) {
+        sha256_blocks_shani(state, data, blocks);
+        return;
+    }
+#endif
+    sha256_blocks_portable(state, data, blocks);
+}
+
+
+
+/**
+ * \brief Initialise le calcul des empreintes.
+ *
+ * \param digest L'état du calcul.
+ */
+void digest_init(Digest* digest) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+
+    if (engine < 0) {
+        detect_engine();
+    }
+    digest->crc = 0xFFFFFFFFu;
+    memcpy(digest->state, initial, sizeof(initial));
+    digest->block_len = 0;
+    digest->length = 0;
+}
+
+
+
+/**
+ * \brief Ajoute des données au calcul des empreintes.
+ *
+ * \param digest L'état du calcul.
+ * \param data Les données.
+ * \param len La taille des données.
+ */
+void digest_update(Digest* digest, const void* data, size_t len) {
+    const unsigned char* p = data;
+
+#ifdef DIGEST_X86
+    if (engine & ENGINE_CRC32) {
+        digest->crc = crc32c_sse42(digest->crc, p, len);
+    } else
+#endif
+    digest->crc = crc32c_portable(digest->crc, p, len);
+    digest->length += len;
+
+    if (digest->block_len > 0) {
+        size_t n = 64 - digest->block_len < len ? 64 - digest->block_len : len;
+        memcpy(digest->block + digest->block_len, p, n);
+        digest->block_len += n;
+        p += n;
+        len -= n;
+        if (digest->block_len < 64) {
+            return;
+        }
+        sha256_blocks(digest->state, digest->block, 1);
+        digest->block_len = 0;
+    }
+    if (len >= 64) {
+        sha256_blocks(digest->state, p, len / 64);
+        p += len - len % 64;
+        len %= 64;
+    }
+    memcpy(digest->block, p, len);
+    digest->block_len = len;
+}
+
+
+
+/**
+ * \brief Termine le calcul des empreintes.
+ *
+ * \param digest L'état du calcul (inutilisable ensuite).
+ * \param sha256 Reçoit l'empreinte SHA-256.
+ * \return Le CRC32C des données.
+ */
+uint32_t digest_final(Digest* digest, unsigned char sha256[DIGEST_SHA256_LENGTH]) {
+    uint64_t bits = digest->length * 8;
+
+    // Remplissage : 0x80, zéros, puis la longueur en bits (gros-boutiste) en fin de bloc
+    digest->block[digest->block_len++] = 0x80;
+    if (digest->block_len > 56) {
+        memset(digest->block + digest->block_len, 0, 64 - digest->block_len);
+        sha256_blocks(digest->state, digest->block, 1);
+        digest->block_len = 0;
+    }
+    memset(digest->block + digest->block_len, 0, 56 - digest->block_len);
+    for (int i = 0; i < 8; ++i) {
+        digest->block[56 + i] = (unsigned char) (bits >> (56 - 8 * i));
+    }
+    sha256_blocks(digest->state, digest->block, 1);
+
+    for (int i = 0; i < 8; ++i) {
+        sha256[4 * i] = (unsigned char) (digest->state[i] >> 24);
+        sha256[4 * i + 1] = (unsigned char) (digest->state[i] >> 16);
+        sha256[4 * i + 2] = (unsigned char) (digest->state[i] >> 8);
+        sha256[4 * i + 3] = (unsigned char) digest->state[i];
+    }
+    return digest->crc ^ 0xFFFFFFFFu;
+}
+
+
+
+/**
+ * \brief Écrit une empreinte SHA-256 en hexadécimal.
+ *
+ * \param sha256 L'empreinte.
+ * \param hex Reçoit la chaîne (DIGEST_HEX_LENGTH octets).
+ */
+void digest_hex(const unsigned char sha256[DIGEST_SHA256_LENGTH], char hex[DIGEST_HEX_LENGTH]) {
+    static const char digits[] = "0123456789abcdef";
+
+    for (int i = 0; i < DIGEST_SHA256_LENGTH; ++i) {
+        hex[2 * i] = digits[sha256[i] >> 4];
+        hex[2 * i + 1] = digits[sha256[i] & 0x0F];
+    }
+    hex[DIGEST_HEX_LENGTH - 1] = '\0';
+}
+
+
+
+/**
+ * \brief Retourne le nom des instructions utilisées pour les calculs.
+ *
+ * \return "sha-ni, sse4.2", "sse4.2" ou "portable".
+ */
+const char* digest_engine(void) {
+    if (engine < 0) {
+        detect_engine();
+    }
+    if (engine & ENGINE_SHA) {
+        return "sha-ni, sse4.2";
+    }
+    return engine & ENGINE_CRC32 ? "sse4.2" : "portable";
+}
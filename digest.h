@@ -0,0 +1,77 @@
+/*
+   Empreintes des fichiers reçus (SHA-256 et CRC32C), calculées au fil des blocs - Définitions et structures de données
+*/
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef DIGEST
+#define DIGEST
+
+
+#define DIGEST_SHA256_LENGTH 32 // Taille d'une empreinte SHA-256 (octets)
+#define DIGEST_HEX_LENGTH (2 * DIGEST_SHA256_LENGTH + 1) // Empreinte SHA-256 en hexadécimal, zéro final compris
+
+
+// Empreintes en cours de calcul d'un fichier
+typedef struct {
+    uint32_t crc; // CRC32C (Castagnoli) en cours
+    uint32_t state[8]; // État SHA-256
+    unsigned char block[64]; // Bloc SHA-256 incomplet
+    size_t block_len; // Octets en attente dans block
+    uint64_t length; // Nombre total d'octets traités
+} Digest;
+
+
+
+/**
+ * \brief Initialise le calcul des empreintes.
+ *
+ * \param digest L'état du calcul.
+ */
+void digest_init(Digest* digest);
+
+
+
+/**
+ * \brief Ajoute des données au calcul des empreintes.
+ *
+ * \param digest L'état du calcul.
+ * \param data Les données.
+ * \param len La taille des données.
+ */
+void digest_update(Digest* digest, const void* data, size_t len);
+
+
+
+/**
+ * \brief Termine le calcul des empreintes.
+ *
+ * \param digest L'état du calcul (inutilisable ensuite).
+ * \param sha256 Reçoit l'empreinte SHA-256.
+ * \return Le CRC32C des données.
+ */
+uint32_t digest_final(Digest* digest, unsigned char sha256[DIGEST_SHA256_LENGTH]);
+
+
+
+/**
+ * \brief Écrit une empreinte SHA-256 en hexadécimal.
+ *
+ * \param sha256 L'empreinte.
+ * \param hex Reçoit la chaîne (DIGEST_HEX_LENGTH octets).
+ */
+void digest_hex(const unsigned char sha256[DIGEST_SHA256_LENGTH], char hex[DIGEST_HEX_LENGTH]);
+
+
+
+/**
+ * \brief Retourne le nom des instructions utilisées pour les calculs.
+ *
+ * \return "sha-ni, sse4.2", "sse4.2" ou "portable".
+ */
+const char* digest_engine(void);
+
+#endif
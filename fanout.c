@@ -0,0 +1,142 @@
+#include "fanout.h"
+#include "prefetch.h"
+
+
+// Fichiers actuellement partagés
+static FanoutFile* files[FANOUT_MAX_FILES];
+
+
+
+/**
+ * \brief S'abonne à la lecture partagée d'un fichier.
+ *
+ * \param filename Le nom du fichier.
+ * \return L'entrée partagée, ou NULL en cas d'erreur.
+ */
+FanoutFile* fanout_open(const char* filename) {
+    int slot = -1;
+
+    for (int i = 0; i < FANOUT_MAX_FILES; ++i) {
+        if (files[i] != NULL && strcmp(files[i]->filename, filename) == 0) {
+            files[i]->refs++;
+            return files[i];
+        }
+        if (files[i] == NULL && slot < 0) {
+            slot = i;
+        }
+    }
+    if (slot < 0) {
+        return NULL;
+    }
+
+    FanoutFile* file = malloc(sizeof(FanoutFile));
+    if (file == NULL) {
+        return NULL;
+    }
+    memset(file, 0, sizeof(FanoutFile));
+    file->ring = malloc(FANOUT_RING_SIZE);
+    file->file_fd = fopen(filename, "rb");
+    if (file->ring == NULL || file->file_fd == NULL) {
+        if (file->file_fd != NULL) {
+            fclose(file->file_fd);
+        }
+        free(file->ring);
+        free(file);
+        return NULL;
+    }
+    // L'anneau remplace le tampon de stdio
+    setvbuf(file->file_fd, NULL, _IONBF, 0);
+    prefetch_sequential(file->file_fd);
+
+    strcpy(file->filename, filename);
+    file->refs = 1;
+    files[slot] = file;
+    return file;
+}
+
+
+
+/**
+ * \brief Lit le bloc suivant du fichier dans l'anneau.
+ *
+ * Les lectures sont alignées sur FANOUT_READ_CHUNK, qui divise FANOUT_RING_SIZE :
+ * une lecture ne chevauche donc jamais la fin de l'anneau.
+ *
+ * \param file L'entrée partagée.
+ */
+static void fill_chunk(FanoutFile* file) {
+    size_t n = fread(file->ring + (file->end % FANOUT_RING_SIZE), 1, FANOUT_READ_CHUNK, file->file_fd);
+    file->disk_reads++;
+    file->end += n;
+    if (n < FANOUT_READ_CHUNK) {
+        file->eof = 1;
+    } else {
+        // Lecture anticipée de la taille d'un anneau au-delà du bloc lu
+        prefetch_range(file->file_fd, file->end, FANOUT_RING_SIZE);
+    }
+    // Les octets les plus anciens ont été écrasés
+    if (file->end - file->base > FANOUT_RING_SIZE) {
+        file->base = file->end - FANOUT_RING_SIZE;
+    }
+}
+
+
+
+/**
+ * \brief Lit des données à un offset donné depuis l'anneau partagé.
+ *
+ * \param file L'entrée partagée.
+ * \param offset L'offset des données demandées.
+ * \param out Le tampon de sortie.
+ * \param len La taille demandée.
+ * \return Le nombre d'octets copiés, ou -1 si l'offset n'est plus dans l'anneau.
+ */
+long fanout_read(FanoutFile* file, off_t offset, char* out, size_t len) {
+    // Lecteur en retard (données écrasées) ou trop en avance (impossible en lecture séquentielle)
+    if (offset < file->base || offset > file->end + FANOUT_RING_SIZE) {
+        file->misses++;
+        return -1;
+    }
+
+    while (offset + (off_t)len > file->end && !file->eof) {
+        fill_chunk(file);
+    }
+    if (offset < file->base) {
+        file->misses++;
+        return -1;
+    }
+
+    size_t avail = offset < file->end ? (size_t)(file->end - offset) : 0;
+    size_t n = len < avail ? len : avail;
+    size_t pos = offset % FANOUT_RING_SIZE;
+    size_t first = n < FANOUT_RING_SIZE - pos ? n : FANOUT_RING_SIZE - pos;
+
+    memcpy(out, file->ring + pos, first);
+    memcpy(out + first, file->ring, n - first);
+    file->ring_hits++;
+    return (long) n;
+}
+
+
+
+/**
+ * \brief Se désabonne de la lecture partagée d'un fichier.
+ *
+ * \param file L'entrée partagée (NULL accepté).
+ */
+void fanout_close(FanoutFile* file) {
+    if (file == NULL || --file->refs > 0) {
+        return;
+    }
+
+    printf("Fanout : %s, %lu lectures disque pour %lu blocs partagés (%lu lectures directes)\n",
+           file->filename, file->disk_reads, file->ring_hits, file->misses);
+    for (int i = 0; i < FANOUT_MAX_FILES; ++i) {
+        if (files[i] == file) {
+            files[i] = NULL;
+        }
+    }
+    fclose(file->file_fd);
+    free(file->ring);
+    free(file);
+}
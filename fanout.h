@@ -0,0 +1,75 @@
+/*
+   Lecture partagée d'un fichier par plusieurs sessions - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#ifndef FANOUT
+#define FANOUT
+
+
+// Taille des lectures anticipées (16 Ko) et de l'anneau partagé (16 lectures, 256 Ko)
+#define FANOUT_READ_CHUNK (32 * 512)
+#define FANOUT_RING_SIZE (16 * FANOUT_READ_CHUNK)
+#define FANOUT_MAX_FILES 64
+
+
+// Fichier lu par une ou plusieurs sessions : l'octet d'offset o est stocké dans ring[o % FANOUT_RING_SIZE]
+typedef struct {
+    char filename[504]; // Nom du fichier
+    FILE* file_fd; // Descripteur utilisé par le producteur
+    char* ring; // Anneau des derniers octets lus
+    off_t base; // Offset du plus ancien octet présent dans l'anneau
+    off_t end; // Offset suivant le dernier octet lu
+    int eof; // La fin du fichier a été atteinte
+    int refs; // Nombre de sessions abonnées
+    unsigned long disk_reads; // Nombre de lectures disque effectuées
+    unsigned long ring_hits; // Nombre de lectures servies par l'anneau
+    unsigned long misses; // Nombre de lectures hors de l'anneau (lecture directe par la session)
+} FanoutFile;
+
+
+
+/**
+ * \brief S'abonne à la lecture partagée d'un fichier.
+ *
+ * Crée l'entrée du fichier lors du premier abonnement.
+ *
+ * \param filename Le nom du fichier.
+ * \return L'entrée partagée, ou NULL en cas d'erreur.
+ */
+FanoutFile* fanout_open(const char* filename);
+
+
+
+/**
+ * \brief Lit des données à un offset donné depuis l'anneau partagé.
+ *
+ * Le lecteur le plus avancé déclenche la lecture anticipée suivante (FANOUT_READ_CHUNK
+ * octets en une seule lecture disque). Un lecteur trop lent, dont l'offset est sorti de
+ * l'anneau, doit lire lui-même le fichier.
+ *
+ * \param file L'entrée partagée.
+ * \param offset L'offset des données demandées.
+ * \param out Le tampon de sortie.
+ * \param len La taille demandée.
+ * \return Le nombre d'octets copiés, ou -1 si l'offset n'est plus dans l'anneau.
+ */
+long fanout_read(FanoutFile* file, off_t offset, char* out, size_t len);
+
+
+
+/**
+ * \brief Se désabonne de la lecture partagée d'un fichier.
+ *
+ * L'entrée est libérée lorsque la dernière session se désabonne.
+ *
+ * \param file L'entrée partagée (NULL accepté).
+ */
+void fanout_close(FanoutFile* file);
+
+#endif
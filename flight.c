@@ -0,0 +1,124 @@
+#include "flight.h"
+#include "prof.h"
+
+
+// Session terminée : description et copie de son journal
+typedef struct {
+    char label[FLIGHT_LABEL_LENGTH];
+    FlightRecorder recorder;
+} FinishedSession;
+
+// Sessions terminées, en anneau
+static FinishedSession finished[FLIGHT_FINISHED];
+static unsigned long num_finished = 0;
+
+// Description des événements, dans l'ordre des constantes FLIGHT_* (arguments a et b)
+static const char* event_formats[FLIGHT_TYPES] = {
+    "requête, opcode %u",
+    "OACK, bloc de %u octets, fenêtre %u",
+    "DATA depuis le bloc de rang %u, %u blocs",
+    "ACK du bloc %u, %u blocs acquittés",
+    "ACK répété du bloc %u",
+    "ACK inattendu du bloc %u",
+    "DATA reçu, bloc %u, %u octets",
+    "ACK envoyé, bloc %u",
+    "socket plein, %u blocs différés",
+    "socket de nouveau inscriptible",
+    "expiration n°%u, dernier bloc acquitté de rang %u",
+    "erreur %u reçue du client",
+    "fin de session, %u Ko"
+};
+
+
+
+/**
+ * \brief Initialise le journal d'une session.
+ *
+ * \param recorder Le journal.
+ */
+void flight_init(FlightRecorder* recorder) {
+    recorder->count = 0;
+}
+
+
+
+/**
+ * \brief Enregistre un événement, daté par clock_now (sans appel système).
+ *
+ * \param recorder Le journal.
+ * \param type Le type d'événement (FLIGHT_*).
+ * \param a Le premier argument.
+ * \param b Le second argument.
+ */
+void flight_record(FlightRecorder* recorder, int type, uint32_t a, uint32_t b) {
+    FlightEvent* event = &recorder->events[recorder->count % FLIGHT_EVENTS];
+
+    event->time = clock_now();
+    event->type = (uint8_t) type;
+    event->a = a;
+    event->b = b;
+    recorder->count++;
+}
+
+
+
+/**
+ * \brief Écrit les événements conservés d'un journal, du plus ancien au plus récent.
+ *
+ * \param recorder Le journal.
+ * \param out Le flux de sortie.
+ * \param now La date de référence (ns, voir clock_now).
+ */
+void flight_print(const FlightRecorder* recorder, FILE* out, int64_t now) {
+    unsigned long first = recorder->count > FLIGHT_EVENTS ? recorder->count - FLIGHT_EVENTS : 0;
+    char age[32];
+    char gap[32];
+
+    if (first > 0) {
+        fprintf(out, "    ... %lu événements plus anciens écrasés\n", first);
+    }
+    for (unsigned long i = first; i < recorder->count; ++i) {
+        const FlightEvent* event = &recorder->events[i % FLIGHT_EVENTS];
+        const FlightEvent* previous = &recorder->events[(i - 1) % FLIGHT_EVENTS];
+
+        prof_format_duration(now - event->time, age, sizeof(age));
+        prof_format_duration(i > first ? event->time - previous->time : 0, gap, sizeof(gap));
+        fprintf(out, "    -%s (+%s) ", age, gap);
+        fprintf(out, event_formats[event->type], event->a, event->b);
+        fprintf(out, "\n");
+    }
+}
+
+
+
+/**
+ * \brief Conserve le journal d'une session qui se termine.
+ *
+ * \param recorder Le journal.
+ * \param label La description de la session (tronquée à FLIGHT_LABEL_LENGTH).
+ */
+void flight_retire(const FlightRecorder* recorder, const char* label) {
+    FinishedSession* slot = &finished[num_finished % FLIGHT_FINISHED];
+
+    snprintf(slot->label, sizeof(slot->label), "%s", label);
+    slot->recorder = *recorder;
+    num_finished++;
+}
+
+
+
+/**
+ * \brief Écrit les journaux des dernières sessions terminées, de la plus ancienne à la plus récente.
+ *
+ * \param out Le flux de sortie.
+ * \param now La date de référence (ns, voir clock_now).
+ */
+void flight_print_finished(FILE* out, int64_t now) {
+    unsigned long first = num_finished > FLIGHT_FINISHED ? num_finished - FLIGHT_FINISHED : 0;
+
+    for (unsigned long i = first; i < num_finished; ++i) {
+        const FinishedSession* slot = &finished[i % FLIGHT_FINISHED];
+        fprintf(out, "Journal : %s (terminée)\n", slot->label);
+        flight_print(&slot->recorder, out, now);
+    }
+}
@@ -0,0 +1,110 @@
+/*
+   Journal de bord des sessions : derniers événements de chaque transfert, conservés en anneau - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "clock.h"
+
+#ifndef FLIGHT
+#define FLIGHT
+
+
+#define FLIGHT_EVENTS 64 // Événements conservés par session (les plus anciens sont écrasés)
+#define FLIGHT_FINISHED 16 // Sessions terminées dont le journal est conservé
+#define FLIGHT_LABEL_LENGTH 640 // Description d'une session terminée
+
+// Types d'événements
+#define FLIGHT_REQUEST 0 // Requête reçue (a : opcode)
+#define FLIGHT_OACK 1 // OACK envoyé (a : taille de bloc, b : fenêtre)
+#define FLIGHT_DATA 2 // Blocs envoyés (a : rang du premier, b : nombre)
+#define FLIGHT_ACK 3 // ACK reçu (a : numéro de bloc, b : blocs acquittés)
+#define FLIGHT_REPEATED_ACK 4 // ACK répétant le dernier bloc acquitté (a : numéro de bloc)
+#define FLIGHT_BAD_ACK 5 // ACK ne correspondant à aucun bloc en vol (a : numéro de bloc)
+#define FLIGHT_RECEIVE 6 // DATA reçu (a : numéro de bloc, b : octets)
+#define FLIGHT_SEND_ACK 7 // ACK envoyé (a : numéro de bloc)
+#define FLIGHT_DEFER 8 // Socket plein, envoi différé (a : blocs non envoyés)
+#define FLIGHT_FLUSH 9 // Socket de nouveau inscriptible
+#define FLIGHT_TIMEOUT 10 // Expiration du délai (a : tentative, b : rang du dernier bloc acquitté)
+#define FLIGHT_ERROR 11 // Paquet d'erreur reçu du client (a : code)
+#define FLIGHT_END 12 // Fin de la session (a : Ko transférés)
+#define FLIGHT_TYPES 13
+
+
+// Événement du journal
+typedef struct {
+    int64_t time; // Date (ns, horloge monotone)
+    uint32_t a; // Arguments, selon le type
+    uint32_t b;
+    uint8_t type; // FLIGHT_*
+} FlightEvent;
+
+
+// Journal d'une session
+typedef struct {
+    FlightEvent events[FLIGHT_EVENTS]; // Anneau des derniers événements
+    unsigned long count; // Événements enregistrés depuis le début de la session
+} FlightRecorder;
+
+
+
+/**
+ * \brief Initialise le journal d'une session.
+ *
+ * \param recorder Le journal.
+ */
+void flight_init(FlightRecorder* recorder);
+
+
+
+/**
+ * \brief Enregistre un événement, daté par clock_now (sans appel système).
+ *
+ * \param recorder Le journal.
+ * \param type Le type d'événement (FLIGHT_*).
+ * \param a Le premier argument.
+ * \param b Le second argument.
+ */
+void flight_record(FlightRecorder* recorder, int type, uint32_t a, uint32_t b);
+
+
+
+/**
+ * \brief Écrit les événements conservés d'un journal, du plus ancien au plus récent.
+ *
+ * Chaque événement est daté par rapport à now et par rapport à l'événement précédent :
+ * un long intervalle désigne l'étape où le transfert a attendu.
+ *
+ * \param recorder Le journal.
+ * \param out Le flux de sortie.
+ * \param now La date de référence (ns, voir clock_now).
+ */
+void flight_print(const FlightRecorder* recorder, FILE* out, int64_t now);
+
+
+
+/**
+ * \brief Conserve le journal d'une session qui se termine.
+ *
+ * Seules les FLIGHT_FINISHED dernières sessions terminées sont gardées.
+ *
+ * \param recorder Le journal.
+ * \param label La description de la session (tronquée à FLIGHT_LABEL_LENGTH).
+ */
+void flight_retire(const FlightRecorder* recorder, const char* label);
+
+
+
+/**
+ * \brief Écrit les journaux des dernières sessions terminées, de la plus ancienne à la plus récente.
+ *
+ * \param out Le flux de sortie.
+ * \param now La date de référence (ns, voir clock_now).
+ */
+void flight_print_finished(FILE* out, int64_t now);
+
+#endif
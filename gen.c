@@ -0,0 +1,329 @@
+#include "gen.h"
+#include "tftp.h"
+
+#include <ctype.h>
+#include <dlfcn.h>
+#include <fnmatch.h>
+#include <arpa/inet.h>
+
+
+// Règles chargées, dans l'ordre du fichier de configuration
+static GenRule rules[GEN_MAX_RULES];
+static int num_rules = 0;
+
+
+
+/**
+ * \brief Lit un fichier entier en mémoire.
+ *
+ * \param path Le chemin du fichier.
+ * \param len Reçoit la taille du contenu.
+ * \return Le contenu alloué, ou NULL en cas d'erreur.
+ */
+static char* read_whole_file(const char* path, size_t* len) {
+    FILE* file = fopen(path, "rb");
+    char* data = NULL;
+    long size;
+
+    if (file == NULL) {
+        return NULL;
+    }
+    if (fseek(file, 0, SEEK_END) == 0 && (size = ftell(file)) >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = malloc(size + 1);
+        if (data != NULL && fread(data, 1, size, file) != (size_t) size) {
+            free(data);
+            data = NULL;
+        } else if (data != NULL) {
+            *len = size;
+        }
+    }
+    fclose(file);
+    return data;
+}
+
+
+
+/**
+ * \brief Charge les règles de génération depuis un fichier de configuration.
+ *
+ * \param config Le chemin du fichier de configuration.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int gen_load(const char* config) {
+    char line[1024];
+    char pattern[GEN_MAX_PATTERN];
+    char type[16];
+    char path[512];
+    int line_number = 0;
+
+    FILE* file = fopen(config, "r");
+    if (file == NULL) {
+        perror("Erreur lors de l'ouverture de la configuration des générateurs");
+        return -1;
+    }
+
+    // Rechargement : les règles précédentes sont remplacées (la génération est synchrone,
+    // aucune session ne référence un gabarit ou un greffon)
+    for (int i = 0; i < num_rules; ++i) {
+        free(rules[i].template);
+        if (rules[i].handle != NULL) {
+            dlclose(rules[i].handle);
+        }
+    }
+    num_rules = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char* start = line;
+        while (isspace((unsigned char)*start)) {
+            start++;
+        }
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+
+        int ttl = GEN_DEFAULT_TTL;
+        if (sscanf(start, "%255s %15s %511s %d", pattern, type, path, &ttl) < 3 || ttl < 0) {
+            printf("Générateurs : ligne %d invalide\n", line_number);
+            continue;
+        }
+        if (num_rules == GEN_MAX_RULES) {
+            printf("Générateurs : plus de %d règles, ligne %d ignorée\n", GEN_MAX_RULES, line_number);
+            continue;
+        }
+
+        GenRule* rule = &rules[num_rules];
+        memset(rule, 0, sizeof(GenRule));
+        strcpy(rule->pattern, pattern);
+        rule->ttl = ttl;
+
+        if (strcmp(type, "template") == 0) {
+            rule->type = GEN_TEMPLATE;
+            rule->template = read_whole_file(path, &rule->template_len);
+            if (rule->template == NULL) {
+                printf("Générateurs : gabarit %s illisible (ligne %d)\n", path, line_number);
+                continue;
+            }
+            rule->uses_port = memmem(rule->template, rule->template_len, "${port}", 7) != NULL;
+        } else if (strcmp(type, "plugin") == 0) {
+            rule->type = GEN_PLUGIN;
+            void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+            if (handle == NULL) {
+                printf("Générateurs : %s (ligne %d)\n", dlerror(), line_number);
+                continue;
+            }
+            // Conversion void* -> pointeur de fonction, autorisée par POSIX pour dlsym
+            *(void**)(&rule->callback) = dlsym(handle, GEN_PLUGIN_SYMBOL);
+            if (rule->callback == NULL) {
+                printf("Générateurs : %s n'exporte pas %s (ligne %d)\n", path, GEN_PLUGIN_SYMBOL, line_number);
+                dlclose(handle);
+                continue;
+            }
+            rule->handle = handle;
+        } else {
+            printf("Générateurs : type %s inconnu (ligne %d)\n", type, line_number);
+            continue;
+        }
+        num_rules++;
+    }
+
+    fclose(file);
+    printf("Générateurs : %d règles chargées depuis %s\n", num_rules, config);
+    return 0;
+}
+
+
+
+/**
+ * \brief Recherche la règle qui s'applique à un nom de fichier.
+ *
+ * \param filename Le nom de fichier demandé.
+ * \return La première règle dont le motif correspond, ou NULL.
+ */
+const GenRule* gen_find(const char* filename) {
+    for (int i = 0; i < num_rules; ++i) {
+        if (fnmatch(rules[i].pattern, filename, FNM_PATHNAME) == 0) {
+            return &rules[i];
+        }
+    }
+    return NULL;
+}
+
+
+
+/**
+ * \brief Extrait une adresse MAC d'un nom de fichier (ex. pxelinux.cfg/01-aa-bb-cc-dd-ee-ff).
+ *
+ * \param filename Le nom de fichier.
+ * \param mac Reçoit l'adresse au format aa:bb:cc:dd:ee:ff (18 octets), ou une chaîne vide.
+ */
+static void extract_mac(const char* filename, char* mac) {
+    size_t len = strlen(filename);
+
+    // Dernière occurrence : "01-" (type ARP) précède l'adresse dans les noms pxelinux
+    mac[0] = '\0';
+    for (size_t i = len >= 17 ? len - 17 + 1 : 0; i > 0; --i) {
+        const char* p = filename + i - 1;
+        int valid = 1;
+        for (int k = 0; k < 17 && valid; ++k) {
+            if (k % 3 == 2) {
+                valid = (p[k] == '-' || p[k] == ':') && p[k] == p[2];
+            } else {
+                valid = isxdigit((unsigned char)p[k]);
+            }
+        }
+        if (valid) {
+            for (int k = 0; k < 17; ++k) {
+                mac[k] = k % 3 == 2 ? ':' : tolower((unsigned char)p[k]);
+            }
+            mac[17] = '\0';
+            return;
+        }
+    }
+}
+
+
+
+/**
+ * \brief Ajoute des octets à un tampon extensible.
+ *
+ * \param out Le tampon (réalloué si nécessaire).
+ * \param len La taille utilisée.
+ * \param capacity La capacité du tampon.
+ * \param data Les octets à ajouter.
+ * \param n Le nombre d'octets.
+ * \return 0 en cas de succès, -1 si la mémoire manque.
+ */
+static int append(char** out, size_t* len, size_t* capacity, const char* data, size_t n) {
+    if (*len + n > *capacity) {
+        size_t bigger = *capacity * 2 > *len + n ? *capacity * 2 : *len + n;
+        char* grown = realloc(*out, bigger);
+        if (grown == NULL) {
+            return -1;
+        }
+        *out = grown;
+        *capacity = bigger;
+    }
+    memcpy(*out + *len, data, n);
+    *len += n;
+    return 0;
+}
+
+
+
+/**
+ * \brief Produit le contenu d'un gabarit en remplaçant ses variables.
+ *
+ * Les variables inconnues sont laissées telles quelles.
+ *
+ * \param rule La règle (gabarit).
+ * \param filename Le nom de fichier demandé.
+ * \param client_ip L'adresse IP du client.
+ * \param port Le port du client.
+ * \param out Reçoit le contenu alloué.
+ * \param out_len Reçoit la taille du contenu.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+static int render_template(const GenRule* rule, const char* filename, const char* client_ip, int port,
+                           char** out, size_t* out_len) {
+    char port_str[8];
+    char mac[18];
+    const char* basename = strrchr(filename, '/');
+    size_t capacity = rule->template_len + 64;
+    size_t len = 0;
+    int result = 0;
+
+    snprintf(port_str, sizeof(port_str), "%d", port);
+    extract_mac(filename, mac);
+    basename = basename != NULL ? basename + 1 : filename;
+
+    const char* names[] = { "ip", "port", "filename", "basename", "mac" };
+    const char* values[] = { client_ip, port_str, filename, basename, mac };
+
+    *out = malloc(capacity);
+    if (*out == NULL) {
+        return -1;
+    }
+
+    const char* p = rule->template;
+    const char* end = rule->template + rule->template_len;
+    while (p < end && result == 0) {
+        const char* var = memchr(p, '$', end - p);
+        if (var == NULL) {
+            result = append(out, &len, &capacity, p, end - p);
+            break;
+        }
+        result = append(out, &len, &capacity, p, var - p);
+        p = var;
+
+        const char* close = var + 1 < end && var[1] == '{' ? memchr(var, '}', end - var) : NULL;
+        int found = -1;
+        for (size_t i = 0; close != NULL && i < sizeof(names) / sizeof(names[0]); ++i) {
+            size_t name_len = strlen(names[i]);
+            if ((size_t)(close - var - 2) == name_len && memcmp(var + 2, names[i], name_len) == 0) {
+                found = (int) i;
+            }
+        }
+        if (result == 0 && found >= 0) {
+            result = append(out, &len, &capacity, values[found], strlen(values[found]));
+            p = close + 1;
+        } else if (result == 0) {
+            result = append(out, &len, &capacity, p, 1);
+            p++;
+        }
+    }
+
+    if (result != 0) {
+        free(*out);
+        *out = NULL;
+        return -1;
+    }
+    *out_len = len;
+    return 0;
+}
+
+
+
+/**
+ * \brief Retourne le contenu généré pour un client, depuis le cache ou en le produisant.
+ *
+ * \param rule La règle à appliquer.
+ * \param filename Le nom de fichier demandé.
+ * \param addr L'adresse du client.
+ * \return L'entrée du cache référencée, ou NULL en cas d'échec.
+ */
+CacheEntry* gen_produce(const GenRule* rule, const char* filename, const struct sockaddr_storage* addr) {
+    char client_ip[INET6_ADDRSTRLEN];
+    char key[CACHE_KEY_LENGTH];
+    char* data = NULL;
+    size_t len = 0;
+    int result;
+
+    sockaddr_format(addr, client_ip, sizeof(client_ip));
+    if (rule->type == GEN_TEMPLATE && rule->uses_port) {
+        snprintf(key, sizeof(key), "gen:%s:%d:%s", client_ip, sockaddr_port(addr), filename);
+    } else {
+        snprintf(key, sizeof(key), "gen:%s:%s", client_ip, filename);
+    }
+
+    CacheEntry* entry = cache_lookup(key, NULL);
+    if (entry != NULL) {
+        return entry;
+    }
+
+    if (rule->type == GEN_TEMPLATE) {
+        result = render_template(rule, filename, client_ip, sockaddr_port(addr), &data, &len);
+    } else {
+        result = rule->callback(filename, client_ip, &data, &len);
+    }
+    if (result != 0) {
+        free(data);
+        return NULL;
+    }
+
+    entry = cache_insert_ttl(key, data, len, rule->ttl);
+    if (entry == NULL) {
+        printf("Générateurs : contenu de %s trop grand pour le cache\n", filename);
+    }
+    return entry;
+}
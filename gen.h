@@ -0,0 +1,99 @@
+/*
+   Contenu généré à la demande (gabarits et greffons) - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netinet/in.h>
+
+#include "cache.h"
+
+#ifndef GEN
+#define GEN
+
+
+#define GEN_MAX_RULES 32 // Nombre maximal de règles de génération
+#define GEN_MAX_PATTERN 256 // Taille maximale d'un motif de nom de fichier
+#define GEN_DEFAULT_TTL 30 // Durée de vie par défaut du contenu généré (secondes)
+#define GEN_PLUGIN_SYMBOL "tftp_generate" // Fonction exportée par un greffon
+
+
+/**
+ * \brief Fonction exportée par un greffon (bibliothèque partagée).
+ *
+ * \param filename Le nom de fichier demandé.
+ * \param client_ip L'adresse IP du client.
+ * \param out Reçoit le contenu généré, alloué avec malloc (libéré par le serveur).
+ * \param out_len Reçoit la taille du contenu.
+ * \return 0 en cas de succès, une autre valeur si le fichier ne peut pas être généré.
+ */
+typedef int (*GenCallback)(const char* filename, const char* client_ip, char** out, size_t* out_len);
+
+
+// Type de générateur
+typedef enum {
+    GEN_TEMPLATE, // Gabarit avec variables ${ip}, ${port}, ${filename}, ${basename}, ${mac}
+    GEN_PLUGIN // Fonction d'une bibliothèque partagée
+} GenType;
+
+
+// Règle associant un motif de nom de fichier à un générateur
+typedef struct {
+    char pattern[GEN_MAX_PATTERN]; // Motif (fnmatch) des noms de fichiers concernés
+    GenType type; // Type de générateur
+    char* template; // Contenu du gabarit (GEN_TEMPLATE)
+    size_t template_len; // Taille du gabarit
+    int uses_port; // Le gabarit contient ${port} : contenu mis en cache par port du client
+    GenCallback callback; // Fonction du greffon (GEN_PLUGIN)
+    void* handle; // Bibliothèque du greffon (dlopen)
+    int ttl; // Durée de vie du contenu généré en cache (secondes)
+} GenRule;
+
+
+
+/**
+ * \brief Charge les règles de génération depuis un fichier de configuration.
+ *
+ * Chaque ligne contient un motif, un type ("template" ou "plugin"), le chemin du gabarit
+ * ou de la bibliothèque partagée, et optionnellement une durée de vie en secondes :
+ *
+ *     pxelinux.cfg/01-*   template   templates/pxe.tpl   30
+ *
+ * Les lignes vides et celles commençant par '#' sont ignorées. Un nouvel appel
+ * (rechargement) remplace les règles précédentes ; le contenu déjà généré reste en
+ * cache jusqu'à l'expiration de sa durée de vie.
+ *
+ * \param config Le chemin du fichier de configuration.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int gen_load(const char* config);
+
+
+
+/**
+ * \brief Recherche la règle qui s'applique à un nom de fichier.
+ *
+ * \param filename Le nom de fichier demandé.
+ * \return La première règle dont le motif correspond, ou NULL.
+ */
+const GenRule* gen_find(const char* filename);
+
+
+
+/**
+ * \brief Retourne le contenu généré pour un client, depuis le cache ou en le produisant.
+ *
+ * Le contenu dépend de l'adresse du client : il est mis en cache par couple
+ * (adresse, fichier), ou (adresse et port, fichier) si le gabarit utilise ${port},
+ * pendant la durée de vie de la règle.
+ *
+ * \param rule La règle à appliquer.
+ * \param filename Le nom de fichier demandé.
+ * \param addr L'adresse du client.
+ * \return L'entrée du cache référencée (à libérer avec cache_release), ou NULL en cas d'échec.
+ */
+CacheEntry* gen_produce(const GenRule* rule, const char* filename, const struct sockaddr_storage* addr);
+
+#endif
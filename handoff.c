@@ -0,0 +1,183 @@
+#include "handoff.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+
+
+
+/**
+ * \brief Prépare l'adresse d'un socket de contrôle.
+ *
+ * \param addr L'adresse à remplir.
+ * \param path Le chemin du socket.
+ * \return 0 en cas de succès, -1 si le chemin est trop long.
+ */
+static int control_address(struct sockaddr_un* addr, const char* path) {
+    memset(addr, 0, sizeof(struct sockaddr_un));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        printf("Relève : chemin du socket de contrôle trop long (%s)\n", path);
+        return -1;
+    }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+
+
+/**
+ * \brief Demande le socket d'écoute au processus en cours d'exécution.
+ *
+ * \param path Le chemin du socket de contrôle.
+ * \return Le socket d'écoute reçu, ou -1 si aucun processus ne répond.
+ */
+int handoff_receive(const char* path) {
+    struct sockaddr_un addr;
+    if (control_address(&addr, path) != 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("Erreur lors de la création du socket de contrôle");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+        // Premier démarrage : aucun processus à relever
+        close(fd);
+        return -1;
+    }
+    struct timeval timeout = { HANDOFF_TIMEOUT_SEC, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char byte = HANDOFF_REQUEST;
+    if (send(fd, &byte, 1, MSG_NOSIGNAL) != 1) {
+        close(fd);
+        return -1;
+    }
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { &byte, 1 };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    int sockfd = -1;
+    if (recvmsg(fd, &msg, MSG_CMSG_CLOEXEC) > 0) {
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            memcpy(&sockfd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+    if (sockfd < 0) {
+        printf("Relève : l'ancien processus n'a pas transmis son socket\n");
+    }
+    close(fd);
+    return sockfd;
+}
+
+
+
+/**
+ * \brief Crée le socket de contrôle sur lequel un futur processus demandera le socket d'écoute.
+ *
+ * \param path Le chemin du socket de contrôle.
+ * \return Le descripteur du socket de contrôle, ou -1 en cas d'erreur.
+ */
+int handoff_listen(const char* path) {
+    struct sockaddr_un addr;
+    if (control_address(&addr, path) != 0) {
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("Erreur lors de la création du socket de contrôle");
+        return -1;
+    }
+    // L'ancien processus garde son socket ouvert : seul le chemin est remplacé
+    unlink(path);
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+        perror("Erreur lors de la liaison du socket de contrôle");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+
+
+/**
+ * \brief Accepte une connexion sur le socket de contrôle.
+ *
+ * \param control_fd Le socket de contrôle.
+ * \return La connexion acceptée (non bloquante), ou -1 en cas d'erreur.
+ */
+int handoff_accept(int control_fd) {
+    int fd = accept4(control_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        perror("Erreur lors de l'acceptation sur le socket de contrôle");
+    }
+    return fd;
+}
+
+
+
+/**
+ * \brief Lit la commande d'une connexion acceptée, sans attendre.
+ *
+ * \param fd La connexion (voir handoff_accept).
+ * \param command Reçoit la commande (un octet).
+ * \return 1 si la commande a été lue, 0 si elle n'est pas encore arrivée, -1 si la
+ *         connexion a été fermée sans commande ou en cas d'erreur.
+ */
+int handoff_read_command(int fd, char* command) {
+    ssize_t received = recv(fd, command, 1, MSG_DONTWAIT);
+    if (received == 1) {
+        return 1;
+    }
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return 0;
+    }
+    return -1;
+}
+
+
+
+/**
+ * \brief Transmet le socket d'écoute sur une connexion acceptée, puis la ferme.
+ *
+ * \param fd La connexion (voir handoff_accept).
+ * \param sockfd Le socket d'écoute à transmettre.
+ * \return 0 si le socket a été transmis, -1 en cas d'erreur.
+ */
+int handoff_send(int fd, int sockfd) {
+    char byte = 0;
+    char control[CMSG_SPACE(sizeof(int))];
+    struct iovec iov = { &byte, 1 };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &sockfd, sizeof(int));
+
+    int result = sendmsg(fd, &msg, MSG_NOSIGNAL) == 1 ? 0 : -1;
+    if (result != 0) {
+        perror("Erreur lors de la transmission du socket d'écoute");
+    }
+    close(fd);
+    return result;
+}
@@ -0,0 +1,82 @@
+/*
+   Relève sans interruption : transmission du socket d'écoute au nouveau processus - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef HANDOFF
+#define HANDOFF
+
+
+#define HANDOFF_TIMEOUT_SEC 5 // Attente maximale de la réponse de l'ancien processus
+
+// Commandes reçues sur le socket de contrôle (un octet)
+#define HANDOFF_REQUEST 'H' // Demande du socket d'écoute par une nouvelle instance
+#define HANDOFF_DUMP 'D' // Demande du profil des étapes et du journal de bord des sessions
+
+
+
+/**
+ * \brief Demande le socket d'écoute au processus en cours d'exécution.
+ *
+ * Se connecte au socket de contrôle (AF_UNIX) de l'ancien processus et reçoit son
+ * socket d'écoute UDP (SCM_RIGHTS). Les requêtes arrivées entre-temps restent dans la
+ * file du socket et sont traitées par le nouveau processus.
+ *
+ * \param path Le chemin du socket de contrôle.
+ * \return Le socket d'écoute reçu, ou -1 si aucun processus ne répond.
+ */
+int handoff_receive(const char* path);
+
+
+
+/**
+ * \brief Crée le socket de contrôle sur lequel un futur processus demandera le socket d'écoute.
+ *
+ * Un socket de contrôle existant (celui de l'ancien processus) est remplacé.
+ *
+ * \param path Le chemin du socket de contrôle.
+ * \return Le descripteur du socket de contrôle, ou -1 en cas d'erreur.
+ */
+int handoff_listen(const char* path);
+
+
+
+/**
+ * \brief Accepte une connexion sur le socket de contrôle.
+ *
+ * La connexion rendue est non bloquante : sa commande est lue par handoff_read_command
+ * lorsqu'elle arrive, sans faire attendre la boucle principale.
+ *
+ * \param control_fd Le socket de contrôle.
+ * \return La connexion acceptée, ou -1 en cas d'erreur.
+ */
+int handoff_accept(int control_fd);
+
+
+
+/**
+ * \brief Lit la commande d'une connexion acceptée, sans attendre.
+ *
+ * \param fd La connexion (voir handoff_accept).
+ * \param command Reçoit la commande (un octet : HANDOFF_REQUEST, HANDOFF_DUMP...).
+ * \return 1 si la commande a été lue, 0 si elle n'est pas encore arrivée, -1 si la
+ *         connexion a été fermée sans commande ou en cas d'erreur.
+ */
+int handoff_read_command(int fd, char* command);
+
+
+
+/**
+ * \brief Transmet le socket d'écoute sur une connexion acceptée, puis la ferme.
+ *
+ * \param fd La connexion (voir handoff_accept).
+ * \param sockfd Le socket d'écoute à transmettre.
+ * \return 0 si le socket a été transmis, -1 en cas d'erreur.
+ */
+int handoff_send(int fd, int sockfd);
+
+#endif
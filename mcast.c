@@ -0,0 +1,381 @@
+#include "mcast.h"
+
+#include <sys/stat.h>
+
+
+// Groupes actifs, par indice et par descripteur de socket
+static McastGroup* groups[MCAST_MAX_GROUPS];
+static McastGroup* groups_by_fd[FD_SETSIZE];
+static int num_groups = 0;
+
+static fd_set* mcast_readfds;
+static ServerFileArray* mcast_files;
+
+
+
+/**
+ * \brief Initialise le module multicast.
+ *
+ * \param readfds Le set de descripteurs surveillés par la boucle principale.
+ * \param serverFileArray Le tableau dynamique des fichiers serveur.
+ */
+void mcast_init(fd_set* readfds, ServerFileArray* serverFileArray) {
+    mcast_readfds = readfds;
+    mcast_files = serverFileArray;
+}
+
+
+
+/**
+ * \brief Envoie un OACK "multicast" à un membre du groupe.
+ *
+ * \param group Le groupe.
+ * \param member L'indice du membre.
+ * \param is_master 1 si le membre devient le client maître.
+ */
+static void send_mcast_oack(McastGroup* group, int member, int is_master) {
+    TFTP_Option option;
+    char group_ip[INET_ADDRSTRLEN];
+
+    inet_ntop(AF_INET, &((struct sockaddr_in *) &group->group_addr)->sin_addr, group_ip, sizeof(group_ip));
+    strcpy(option.name, "multicast");
+    snprintf(option.value, sizeof(option.value), "%s,%d,%d", group_ip, MCAST_PORT, is_master);
+    send_oack_packet(group->sockfd, &group->members[member].addr, &option, 1);
+}
+
+
+
+/**
+ * \brief Libère un groupe (socket, fichier et session de lecture).
+ *
+ * \param group Le groupe à libérer.
+ */
+static void destroy_group(McastGroup* group) {
+    printf("Mcast[%d] : groupe %s terminé\n", group->sockfd, group->filename);
+    FD_CLR(group->sockfd, mcast_readfds);
+    close(group->sockfd);
+    fclose(group->file_fd);
+    stop_file_session(group->filename, READ_MODE, mcast_files);
+
+    groups_by_fd[group->sockfd] = NULL;
+    groups[group->index] = NULL;
+    num_groups--;
+    free(group);
+}
+
+
+
+/**
+ * \brief Choisit le prochain client maître parmi les membres actifs.
+ *
+ * Le nouveau maître reçoit un OACK avec mc=1 et répond par l'ACK du dernier bloc
+ * reçu consécutivement, ce qui permet de reprendre la diffusion à partir du premier
+ * bloc qui lui manque. Le groupe est libéré s'il ne reste aucun membre.
+ *
+ * \param group Le groupe.
+ */
+static void elect_master(McastGroup* group) {
+    group->master = -1;
+    for (int i = 0; i < group->num_members; ++i) {
+        if (group->members[i].active) {
+            group->master = i;
+            break;
+        }
+    }
+
+    if (group->master < 0) {
+        destroy_group(group);
+        return;
+    }
+
+    send_mcast_oack(group, group->master, 1);
+    group->state = MCAST_WAIT_MASTER;
+    group->retries = 0;
+    group->last_sent_time = clock_now();
+}
+
+
+
+/**
+ * \brief Lit et diffuse un bloc du fichier sur le groupe.
+ *
+ * \param group Le groupe.
+ * \param block_number Le numéro du bloc à envoyer.
+ */
+static void send_block(McastGroup* group, uint16_t block_number) {
+    if (fseek(group->file_fd, (long)(block_number - 1) * MAX_DATA_SIZE, SEEK_SET) != 0) {
+        group->buffer_size = 0;
+    } else {
+        group->buffer_size = fread(group->buffer, 1, MAX_DATA_SIZE, group->file_fd);
+    }
+    group->block_number = block_number;
+    send_data_packet(group->sockfd, &group->group_addr, group->block_number, group->buffer, group->buffer_size);
+    group->state = MCAST_SENDING;
+    group->retries = 0;
+    group->last_sent_time = clock_now();
+}
+
+
+
+/**
+ * \brief Crée un groupe pour un fichier.
+ *
+ * \param filename Le fichier à diffuser.
+ * \return Le groupe, ou NULL en cas d'erreur.
+ */
+static McastGroup* create_group(const char* filename) {
+    int index = -1;
+    for (int i = 0; i < MCAST_MAX_GROUPS && index < 0; ++i) {
+        if (groups[i] == NULL) {
+            index = i;
+        }
+    }
+    if (index < 0) {
+        return NULL;
+    }
+
+    // Dernier bloc au-delà du numéro 65535 : fichier laissé au transfert unicast (option rollover)
+    struct stat st;
+    if (stat(filename, &st) != 0 || st.st_size >= MCAST_MAX_FILE_SIZE) {
+        return NULL;
+    }
+
+    McastGroup* group = malloc(sizeof(McastGroup));
+    if (group == NULL) {
+        return NULL;
+    }
+    memset(group, 0, sizeof(McastGroup));
+    strcpy(group->filename, filename);
+    group->index = index;
+    group->master = -1;
+
+    if (start_file_session(filename, READ_MODE, mcast_files) != 0) {
+        free(group);
+        return NULL;
+    }
+
+    group->file_fd = fopen(filename, "rb");
+    group->sockfd = group->file_fd != NULL ? createUDPSocket("0.0.0.0", 0) : -1;
+    if (group->sockfd < 0 || group->sockfd >= FD_SETSIZE) {
+        if (group->sockfd >= 0) {
+            close(group->sockfd);
+        }
+        if (group->file_fd != NULL) {
+            fclose(group->file_fd);
+        }
+        stop_file_session(filename, READ_MODE, mcast_files);
+        free(group);
+        return NULL;
+    }
+
+    // Adresse de groupe : MCAST_BASE_ADDR + indice
+    unsigned char ttl = MCAST_TTL;
+    unsigned char loop = 1;
+    setsockopt(group->sockfd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+    setsockopt(group->sockfd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    struct sockaddr_in *group_addr = (struct sockaddr_in *) &group->group_addr;
+    group_addr->sin_family = AF_INET;
+    group_addr->sin_port = htons(MCAST_PORT);
+    inet_pton(AF_INET, MCAST_BASE_ADDR, &group_addr->sin_addr);
+    group_addr->sin_addr.s_addr = htonl(ntohl(group_addr->sin_addr.s_addr) + index);
+
+    // Numéro du dernier bloc (plus court que MAX_DATA_SIZE, éventuellement vide)
+    fseek(group->file_fd, 0, SEEK_END);
+    group->last_block = (uint16_t)(ftell(group->file_fd) / MAX_DATA_SIZE + 1);
+
+    FD_SET(group->sockfd, mcast_readfds);
+    groups[index] = group;
+    groups_by_fd[group->sockfd] = group;
+    num_groups++;
+    printf("Mcast[%d] : nouveau groupe pour %s\n", group->sockfd, filename);
+    return group;
+}
+
+
+
+/**
+ * \brief Ajoute un client au groupe multicast d'un fichier.
+ *
+ * \param filename Le fichier demandé.
+ * \param client_addr L'adresse unicast du client.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int mcast_join(const char* filename, struct sockaddr_storage* client_addr) {
+    if (client_addr->ss_family != AF_INET) {
+        return -1;
+    }
+
+    McastGroup* group = NULL;
+    for (int i = 0; i < MCAST_MAX_GROUPS && group == NULL; ++i) {
+        if (groups[i] != NULL && strcmp(groups[i]->filename, filename) == 0) {
+            group = groups[i];
+        }
+    }
+    if (group == NULL) {
+        group = create_group(filename);
+        if (group == NULL) {
+            return -1;
+        }
+    }
+
+    // Réutiliser l'emplacement d'un membre ayant terminé
+    int member = -1;
+    for (int i = 0; i < group->num_members && member < 0; ++i) {
+        if (!group->members[i].active) {
+            member = i;
+        }
+    }
+    if (member < 0) {
+        if (group->num_members == MCAST_MAX_MEMBERS) {
+            if (group->master < 0) {
+                destroy_group(group);
+            }
+            return -1;
+        }
+        member = group->num_members++;
+    }
+    group->members[member].addr = *client_addr;
+    group->members[member].active = 1;
+
+    if (group->master < 0) {
+        elect_master(group);
+    } else {
+        // Les blocs manqués seront demandés lorsque ce client deviendra maître
+        send_mcast_oack(group, member, 0);
+    }
+    return 0;
+}
+
+
+
+/**
+ * \brief Retourne le groupe associé à un descripteur de socket.
+ *
+ * \param sockfd Le descripteur de socket.
+ * \return Le groupe, ou NULL si le descripteur n'appartient à aucun groupe.
+ */
+McastGroup* mcast_find_by_fd(int sockfd) {
+    if (sockfd < 0 || sockfd >= FD_SETSIZE) {
+        return NULL;
+    }
+    return groups_by_fd[sockfd];
+}
+
+
+
+/**
+ * \brief Traite un paquet reçu sur la socket d'un groupe.
+ *
+ * \param group Le groupe.
+ * \param buffer Le paquet reçu.
+ * \param length La taille du paquet.
+ * \param from L'adresse de l'émetteur.
+ */
+void mcast_handle_packet(McastGroup* group, const char* buffer, int length, struct sockaddr_storage* from) {
+    int member = -1;
+    for (int i = 0; i < group->num_members && member < 0; ++i) {
+        if (group->members[i].active && sockaddr_equal(&group->members[i].addr, from)) {
+            member = i;
+        }
+    }
+    if (member < 0) {
+        send_error_packet(group->sockfd, from, UnknownTransferID, get_error_message(UnknownTransferID), NULL);
+        return;
+    }
+    if (length < TFTP_HEADER_SIZE) {
+        return;
+    }
+
+    uint16_t opcode, block_number;
+    memcpy(&opcode, buffer, sizeof(uint16_t));
+    memcpy(&block_number, buffer + 2, sizeof(uint16_t));
+    opcode = ntohs(opcode);
+    block_number = ntohs(block_number);
+
+    if (opcode == TFTP_OPCODE_ERR) {
+        // Le client abandonne le transfert
+        group->members[member].active = 0;
+        if (member == group->master) {
+            elect_master(group);
+        }
+        return;
+    }
+    if (opcode != TFTP_OPCODE_ACK) {
+        return;
+    }
+
+    // ACK du dernier bloc : le client a reçu tout le fichier
+    if (block_number == group->last_block) {
+        printf("Mcast[%d] ^_^ Transmission terminée avec succès (bloc %d)\n", group->sockfd, block_number);
+        group->members[member].active = 0;
+        if (member == group->master) {
+            elect_master(group);
+        }
+        return;
+    }
+
+    // Seul le client maître pilote la diffusion
+    if (member == group->master) {
+        if (group->state == MCAST_WAIT_MASTER || block_number == group->block_number) {
+            send_block(group, block_number + 1);
+        }
+    }
+}
+
+
+
+/**
+ * \brief Retransmet le dernier paquet des groupes dont le client maître ne répond plus.
+ *
+ * \param timeout_sec Le délai de retransmission en secondes.
+ * \return La prochaine échéance de retransmission (ns, horloge monotone), ou 0 si aucun groupe n'est actif.
+ */
+int64_t mcast_check_timeouts(int timeout_sec) {
+    int64_t now = clock_now();
+    int64_t next = 0;
+
+    for (int i = 0; i < MCAST_MAX_GROUPS; ++i) {
+        McastGroup* group = groups[i];
+        if (group == NULL) {
+            continue;
+        }
+        if (now - group->last_sent_time < timeout_sec * CLOCK_NS_PER_SEC) {
+            if (next == 0 || group->last_sent_time + timeout_sec * CLOCK_NS_PER_SEC < next) {
+                next = group->last_sent_time + timeout_sec * CLOCK_NS_PER_SEC;
+            }
+            continue;
+        }
+
+        if (group->state == MCAST_WAIT_MASTER) {
+            send_mcast_oack(group, group->master, 1);
+        } else {
+            send_data_packet(group->sockfd, &group->group_addr, group->block_number, group->buffer, group->buffer_size);
+            printf("Mcast[%d] : Time Out ! retransmission DATA[%d]\n", group->sockfd, group->block_number);
+        }
+        group->retries++;
+        group->last_sent_time = clock_now();
+
+        if (group->retries >= MAX_RETRIES) {
+            // Le client maître ne répond plus : passer au suivant
+            printf("Mcast[%d] : client maître perdu, nouvelle élection\n", group->sockfd);
+            group->members[group->master].active = 0;
+            elect_master(group);
+        }
+        // Le groupe a été détruit s'il ne reste aucun client
+        if (groups[i] != NULL && (next == 0 || now + timeout_sec * CLOCK_NS_PER_SEC < next)) {
+            next = now + timeout_sec * CLOCK_NS_PER_SEC;
+        }
+    }
+    return next;
+}
+
+
+
+/**
+ * \brief Retourne le nombre de groupes actifs.
+ *
+ * \return Le nombre de groupes actifs.
+ */
+int mcast_active_groups(void) {
+    return num_groups;
+}
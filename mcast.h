@@ -0,0 +1,134 @@
+/*
+   TFTP Multicast (RFC 2090) - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <sys/select.h>
+
+#include "tftp.h"
+#include "sync.h"
+#include "clock.h"
+
+#ifndef MCAST
+#define MCAST
+
+
+// Paramètres des groupes multicast
+#define MCAST_MAX_GROUPS 16
+#define MCAST_MAX_MEMBERS 64
+#define MCAST_BASE_ADDR "239.255.69.1" // Adresse du premier groupe, les suivants sont consécutifs
+#define MCAST_PORT 1758 // Port de destination des paquets DATA (tftp-mcast)
+#define MCAST_TTL 1
+#define MCAST_MAX_FILE_SIZE (65535L * MAX_DATA_SIZE) // Taille à partir de laquelle le dernier bloc dépasserait le numéro 65535
+
+
+// État d'un groupe
+typedef enum {
+    MCAST_WAIT_MASTER, // OACK envoyé au client maître, en attente de son ACK
+    MCAST_SENDING      // Transmission des blocs demandés par le client maître
+} McastState;
+
+
+// Client abonné à un groupe
+typedef struct {
+    struct sockaddr_storage addr; // Adresse unicast du client (IPv4)
+    int active; // Le client n'a pas encore terminé
+} McastMember;
+
+
+// Groupe multicast : un fichier, une session serveur, plusieurs clients
+typedef struct {
+    int sockfd; // Socket de session (envoi des DATA au groupe, réception des ACK)
+    int index; // Indice du groupe (détermine l'adresse multicast)
+    char filename[504]; // Fichier diffusé
+    FILE* file_fd; // Descripteur du fichier
+    struct sockaddr_storage group_addr; // Adresse multicast de destination (IPv4)
+    McastMember members[MCAST_MAX_MEMBERS]; // Clients abonnés
+    int num_members; // Nombre d'emplacements utilisés dans members
+    int master; // Indice du client maître dans members (-1 si aucun)
+    McastState state; // État du groupe
+    char buffer[MAX_DATA_SIZE]; // Dernier bloc envoyé
+    int buffer_size; // Taille du dernier bloc
+    uint16_t block_number; // Numéro du dernier bloc envoyé
+    uint16_t last_block; // Numéro du dernier bloc du fichier
+    int64_t last_sent_time; // Date du dernier envoi (ns, horloge monotone)
+    int retries; // Nombre de tentatives de retransmission
+} McastGroup;
+
+
+
+/**
+ * \brief Initialise le module multicast.
+ *
+ * \param readfds Le set de descripteurs surveillés par la boucle principale.
+ * \param serverFileArray Le tableau dynamique des fichiers serveur.
+ */
+void mcast_init(fd_set* readfds, ServerFileArray* serverFileArray);
+
+
+
+/**
+ * \brief Ajoute un client au groupe multicast d'un fichier.
+ *
+ * Crée le groupe (socket de session, ouverture du fichier, session de lecture)
+ * s'il n'existe pas encore. Le premier client devient le client maître ; les
+ * suivants reçoivent un OACK avec mc=0 et récupèrent les blocs manqués lorsqu'ils
+ * deviennent maîtres à leur tour.
+ *
+ * Les groupes sont des groupes IPv4 : le client doit avoir une adresse IPv4
+ * (éventuellement mappée, voir sockaddr_unmap).
+ *
+ * Les blocs ont MAX_DATA_SIZE octets et des numéros sur 16 bits, sans retour à zéro :
+ * un fichier d'au moins MCAST_MAX_FILE_SIZE octets est refusé (transfert unicast).
+ *
+ * \param filename Le fichier demandé.
+ * \param client_addr L'adresse unicast du client.
+ * \return 0 en cas de succès, -1 en cas d'erreur (aucun paquet n'est envoyé).
+ */
+int mcast_join(const char* filename, struct sockaddr_storage* client_addr);
+
+
+
+/**
+ * \brief Retourne le groupe associé à un descripteur de socket.
+ *
+ * \param sockfd Le descripteur de socket.
+ * \return Le groupe, ou NULL si le descripteur n'appartient à aucun groupe.
+ */
+McastGroup* mcast_find_by_fd(int sockfd);
+
+
+
+/**
+ * \brief Traite un paquet reçu sur la socket d'un groupe.
+ *
+ * \param group Le groupe.
+ * \param buffer Le paquet reçu.
+ * \param length La taille du paquet.
+ * \param from L'adresse de l'émetteur.
+ */
+void mcast_handle_packet(McastGroup* group, const char* buffer, int length, struct sockaddr_storage* from);
+
+
+
+/**
+ * \brief Retransmet le dernier paquet des groupes dont le client maître ne répond plus.
+ *
+ * Après MAX_RETRIES tentatives, le client maître est retiré et un nouveau maître est choisi.
+ *
+ * \param timeout_sec Le délai de retransmission en secondes.
+ * \return La prochaine échéance de retransmission (ns, horloge monotone), ou 0 si aucun groupe n'est actif.
+ */
+int64_t mcast_check_timeouts(int timeout_sec);
+
+
+
+/**
+ * \brief Retourne le nombre de groupes actifs.
+ *
+ * \return Le nombre de groupes actifs.
+ */
+int mcast_active_groups(void);
+
+#endif
@@ -0,0 +1,266 @@
+#include "metacache.h"
+#include "tftp.h"
+
+#include <unistd.h>
+#include <ftw.h>
+#include <sys/inotify.h>
+
+
+// Entrées du cache (adressage direct, une collision remplace l'entrée)
+static MetaEntry entries[METACACHE_SIZE];
+static MetaStats stats;
+
+// Surveillance inotify : chemin (relatif à la racine, terminé par '/') de chaque répertoire surveillé
+static int inotify_fd = -1;
+static char* watch_dirs[METACACHE_MAX_WATCHES];
+static const char* watch_root;
+
+#define WATCH_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO \
+                    | IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF)
+
+
+
+/**
+ * \brief Calcule l'empreinte d'un chemin (djb2).
+ *
+ * \param str Le chemin.
+ * \return L'empreinte.
+ */
+static unsigned long hash_path(const char* str) {
+    unsigned long hash = 5381;
+    while (*str) {
+        hash = hash * 33 + (unsigned char)*str++;
+    }
+    return hash;
+}
+
+
+
+/**
+ * \brief Retourne la clé d'un chemin : son écriture normalisée.
+ *
+ * "./f", "a//b" et "f", "a/b" partagent ainsi une même entrée, invalidée par inotify
+ * (qui ne connaît que l'écriture normalisée).
+ *
+ * \param filename Le chemin demandé.
+ * \param key Le tampon recevant la clé (taille de MetaEntry.filename).
+ * \return La clé, ou filename s'il ne peut pas être normalisé.
+ */
+static const char* entry_key(const char* filename, char* key) {
+    if (tftp_normalize_path(filename, key, sizeof(((MetaEntry*)0)->filename)) != 0) {
+        return filename;
+    }
+    return key;
+}
+
+
+
+/**
+ * \brief Invalide toutes les entrées.
+ */
+static void flush_all(void) {
+    for (int i = 0; i < METACACHE_SIZE; ++i) {
+        entries[i].filename[0] = '\0';
+    }
+}
+
+
+
+/**
+ * \brief Ajoute un répertoire à la surveillance (appelée par nftw).
+ *
+ * \param path Le chemin du répertoire.
+ * \param st Ses métadonnées.
+ * \param type Le type d'entrée rencontrée.
+ * \param ftw La position dans l'arborescence.
+ * \return 0 pour continuer le parcours.
+ */
+static int add_watch(const char* path, const struct stat* st, int type, struct FTW* ftw) {
+    (void) st;
+    (void) ftw;
+    if (type != FTW_D) {
+        return 0;
+    }
+
+    int wd = inotify_add_watch(inotify_fd, path, WATCH_MASK);
+    if (wd < 0 || wd >= METACACHE_MAX_WATCHES) {
+        return 0;
+    }
+
+    // Chemin relatif à la racine, tel que les clients l'écrivent ("" pour la racine)
+    const char* relative = path + strlen(watch_root);
+    while (*relative == '/') {
+        relative++;
+    }
+    free(watch_dirs[wd]);
+    watch_dirs[wd] = malloc(strlen(relative) + 2);
+    if (watch_dirs[wd] != NULL) {
+        strcpy(watch_dirs[wd], relative);
+        if (relative[0] != '\0') {
+            strcat(watch_dirs[wd], "/");
+        }
+    }
+    return 0;
+}
+
+
+
+/**
+ * \brief Initialise le cache et surveille l'arborescence servie avec inotify.
+ *
+ * \param root Le répertoire racine servi.
+ * \return Le descripteur inotify, ou -1 si inotify est indisponible.
+ */
+int metacache_init(const char* root) {
+    flush_all();
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        perror("inotify indisponible, cache de métadonnées borné par sa durée de vie");
+        return -1;
+    }
+    watch_root = root;
+    nftw(root, add_watch, 64, FTW_PHYS);
+    return inotify_fd;
+}
+
+
+
+/**
+ * \brief Retourne l'entrée d'un chemin si elle est présente et valide.
+ *
+ * \param filename Le chemin.
+ * \param hash L'empreinte du chemin.
+ * \return L'entrée, ou NULL.
+ */
+static MetaEntry* find_valid(const char* filename, unsigned long hash) {
+    MetaEntry* entry = &entries[hash % METACACHE_SIZE];
+    if (entry->hash == hash && strcmp(entry->filename, filename) == 0 && clock_now() < entry->expires) {
+        return entry;
+    }
+    return NULL;
+}
+
+
+
+/**
+ * \brief Retourne les métadonnées d'un chemin, depuis le cache ou le système de fichiers.
+ *
+ * \param filename Le chemin demandé.
+ * \param out Reçoit une copie de l'entrée.
+ */
+void metacache_lookup(const char* filename, MetaEntry* out) {
+    char key[sizeof(((MetaEntry*)0)->filename)];
+    filename = entry_key(filename, key);
+    unsigned long hash = hash_path(filename);
+    MetaEntry* entry = find_valid(filename, hash);
+
+    if (entry != NULL) {
+        stats.hits++;
+        if (!entry->exists) {
+            stats.negative_hits++;
+        }
+        *out = *entry;
+        return;
+    }
+
+    stats.misses++;
+    entry = &entries[hash % METACACHE_SIZE];
+    memset(entry, 0, sizeof(MetaEntry));
+    strcpy(entry->filename, filename);
+    entry->hash = hash;
+    entry->exists = stat(filename, &entry->st) == 0;
+    entry->readable = entry->exists && access(filename, R_OK) == 0;
+    entry->expires = clock_now() + (entry->exists ? METACACHE_POSITIVE_TTL : METACACHE_NEGATIVE_TTL) * CLOCK_NS_PER_SEC;
+    *out = *entry;
+}
+
+
+
+/**
+ * \brief Indique, sans appel système, si un chemin est connu comme inexistant.
+ *
+ * \param filename Le chemin demandé.
+ * \return 1 si une entrée négative valide existe, 0 sinon.
+ */
+int metacache_is_known_missing(const char* filename) {
+    char key[sizeof(((MetaEntry*)0)->filename)];
+    filename = entry_key(filename, key);
+    MetaEntry* entry = find_valid(filename, hash_path(filename));
+    if (entry != NULL && !entry->exists) {
+        stats.hits++;
+        stats.negative_hits++;
+        return 1;
+    }
+    return 0;
+}
+
+
+
+/**
+ * \brief Invalide l'entrée d'un chemin.
+ *
+ * \param filename Le chemin.
+ */
+void metacache_invalidate(const char* filename) {
+    char key[sizeof(((MetaEntry*)0)->filename)];
+    filename = entry_key(filename, key);
+    unsigned long hash = hash_path(filename);
+    MetaEntry* entry = &entries[hash % METACACHE_SIZE];
+    if (entry->hash == hash && strcmp(entry->filename, filename) == 0) {
+        entry->filename[0] = '\0';
+        stats.invalidations++;
+    }
+}
+
+
+
+/**
+ * \brief Traite les événements inotify en attente et invalide les entrées concernées.
+ */
+void metacache_handle_events(void) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    char path[1024];
+    ssize_t len;
+
+    if (inotify_fd < 0) {
+        return;
+    }
+
+    while ((len = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+        for (char* p = buffer; p < buffer + len; p += sizeof(struct inotify_event) + ((struct inotify_event*)p)->len) {
+            struct inotify_event* event = (struct inotify_event*) p;
+
+            // Répertoire déplacé ou supprimé, ou file d'événements saturée : tout invalider
+            if (event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF)
+                || ((event->mask & IN_ISDIR) && (event->mask & (IN_DELETE | IN_MOVED_FROM)))) {
+                flush_all();
+                stats.invalidations++;
+                continue;
+            }
+            if (event->wd < 0 || event->wd >= METACACHE_MAX_WATCHES || watch_dirs[event->wd] == NULL || event->len == 0) {
+                continue;
+            }
+
+            snprintf(path, sizeof(path), "%s%s", watch_dirs[event->wd], event->name);
+            metacache_invalidate(path);
+
+            // Nouveau sous-répertoire : le surveiller à son tour
+            if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO))) {
+                char full[1100];
+                snprintf(full, sizeof(full), "%s/%s", watch_root, path);
+                nftw(full, add_watch, 64, FTW_PHYS);
+            }
+        }
+    }
+}
+
+
+
+/**
+ * \brief Retourne les compteurs du cache.
+ *
+ * \return Les compteurs.
+ */
+MetaStats metacache_get_stats(void) {
+    return stats;
+}
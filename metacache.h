@@ -0,0 +1,100 @@
+/*
+   Cache des métadonnées des fichiers servis - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "clock.h"
+
+#ifndef METACACHE
+#define METACACHE
+
+
+#define METACACHE_SIZE 4096 // Nombre d'entrées (adressage direct)
+#define METACACHE_POSITIVE_TTL 60 // Durée de vie d'une entrée positive (secondes)
+#define METACACHE_NEGATIVE_TTL 5 // Durée de vie d'une entrée négative (secondes)
+#define METACACHE_MAX_WATCHES 8192 // Nombre maximal de répertoires surveillés
+
+
+// Métadonnées d'un chemin demandé par un client
+typedef struct {
+    char filename[504]; // Chemin demandé
+    unsigned long hash; // Empreinte du chemin
+    int exists; // Le fichier existe
+    int readable; // Le serveur a le droit de lire le fichier
+    struct stat st; // Taille, inode, date de modification (si exists)
+    int64_t expires; // Date d'expiration de l'entrée (ns, horloge monotone)
+} MetaEntry;
+
+
+// Compteurs du cache
+typedef struct {
+    unsigned long hits; // Recherches servies par le cache
+    unsigned long negative_hits; // Dont recherches de fichiers inexistants
+    unsigned long misses; // Recherches ayant nécessité des appels système
+    unsigned long invalidations; // Entrées invalidées par inotify
+} MetaStats;
+
+
+
+/**
+ * \brief Initialise le cache et surveille l'arborescence servie avec inotify.
+ *
+ * \param root Le répertoire racine servi.
+ * \return Le descripteur inotify à surveiller dans la boucle principale, ou -1 si
+ *         inotify est indisponible (les entrées restent bornées par leur durée de vie).
+ */
+int metacache_init(const char* root);
+
+
+
+/**
+ * \brief Retourne les métadonnées d'un chemin, depuis le cache ou le système de fichiers.
+ *
+ * \param filename Le chemin demandé.
+ * \param out Reçoit une copie de l'entrée.
+ */
+void metacache_lookup(const char* filename, MetaEntry* out);
+
+
+
+/**
+ * \brief Indique, sans appel système, si un chemin est connu comme inexistant.
+ *
+ * \param filename Le chemin demandé.
+ * \return 1 si une entrée négative valide existe, 0 sinon.
+ */
+int metacache_is_known_missing(const char* filename);
+
+
+
+/**
+ * \brief Invalide l'entrée d'un chemin.
+ *
+ * \param filename Le chemin.
+ */
+void metacache_invalidate(const char* filename);
+
+
+
+/**
+ * \brief Traite les événements inotify en attente et invalide les entrées concernées.
+ */
+void metacache_handle_events(void);
+
+
+
+/**
+ * \brief Retourne les compteurs du cache.
+ *
+ * \return Les compteurs.
+ */
+MetaStats metacache_get_stats(void);
+
+#endif
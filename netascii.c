@@ -0,0 +1,270 @@
+#include "netascii.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+
+/**
+ * \brief Recherche le premier octet égal à a ou b.
+ *
+ * \param data Les données à parcourir.
+ * \param len La taille des données.
+ * \param a Premier octet recherché.
+ * \param b Second octet recherché.
+ * \return L'indice du premier octet trouvé, ou len s'il n'y en a aucun.
+ */
+size_t netascii_scan(const char* data, size_t len, char a, char b) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+    for (; i + 32 <= len; i += 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(data + i));
+        __m256i match = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(match);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(data + i));
+        __m128i match = _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(match);
+        if (mask != 0) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#endif
+
+    // Repli scalaire (et fin de tampon)
+    for (; i < len; ++i) {
+        if (data[i] == a || data[i] == b) {
+            return i;
+        }
+    }
+    return len;
+}
+
+
+
+/**
+ * \brief Initialise un encodeur netascii.
+ *
+ * \param encoder L'encodeur à initialiser.
+ */
+void netascii_encoder_init(NetasciiEncoder* encoder) {
+    encoder->raw_pos = 0;
+    encoder->raw_len = 0;
+    encoder->pending = -1;
+}
+
+
+
+/**
+ * \brief Encode des données locales en netascii (LF -> CR LF, CR -> CR NUL).
+ *
+ * \param encoder L'état de l'encodeur.
+ * \param in Les données à encoder.
+ * \param in_len La taille des données.
+ * \param consumed Reçoit le nombre d'octets de in consommés.
+ * \param out Le tampon de sortie.
+ * \param out_cap La capacité du tampon de sortie.
+ * \return Le nombre d'octets écrits dans out.
+ */
+size_t netascii_encode(NetasciiEncoder* encoder, const char* in, size_t in_len, size_t* consumed, char* out, size_t out_cap) {
+    size_t i = 0, o = 0;
+
+    while (o < out_cap) {
+        // Compléter une séquence CR coupée au bloc précédent
+        if (encoder->pending >= 0) {
+            out[o++] = (char)encoder->pending;
+            encoder->pending = -1;
+            continue;
+        }
+        if (i == in_len) {
+            break;
+        }
+
+        // Copier d'un bloc tout ce qui précède le prochain CR ou LF
+        size_t room = out_cap - o;
+        size_t avail = in_len - i;
+        size_t n = netascii_scan(in + i, avail < room ? avail : room, '\r', '\n');
+        memcpy(out + o, in + i, n);
+        i += n;
+        o += n;
+
+        if (i < in_len && o < out_cap && (in[i] == '\r' || in[i] == '\n')) {
+            encoder->pending = (in[i] == '\n') ? '\n' : '\0';
+            out[o++] = '\r';
+            i++;
+        }
+    }
+
+    *consumed = i;
+    return o;
+}
+
+
+
+/**
+ * \brief Lit et encode un bloc netascii depuis un fichier.
+ *
+ * \param encoder L'état de l'encodeur.
+ * \param file Le fichier source.
+ * \param out Le tampon de sortie.
+ * \param out_cap La taille du bloc à produire.
+ * \return Le nombre d'octets produits.
+ */
+size_t netascii_read(NetasciiEncoder* encoder, FILE* file, char* out, size_t out_cap) {
+    size_t produced = 0;
+
+    while (produced < out_cap) {
+        if (encoder->raw_pos == encoder->raw_len && encoder->pending < 0) {
+            encoder->raw_len = fread(encoder->raw, 1, NETASCII_RAW_SIZE, file);
+            encoder->raw_pos = 0;
+            if (encoder->raw_len == 0) {
+                break; // fin de fichier
+            }
+        }
+
+        size_t consumed;
+        produced += netascii_encode(encoder, encoder->raw + encoder->raw_pos, encoder->raw_len - encoder->raw_pos,
+                                    &consumed, out + produced, out_cap - produced);
+        encoder->raw_pos += consumed;
+    }
+    return produced;
+}
+
+
+
+/**
+ * \brief Encode un fichier complet en netascii dans un tampon alloué.
+ *
+ * \param file Le fichier source, positionné au début.
+ * \param out_len Reçoit la taille du contenu encodé.
+ * \return Le tampon (à libérer avec free), ou NULL en cas d'erreur.
+ */
+char* netascii_encode_file(FILE* file, size_t* out_len) {
+    NetasciiEncoder encoder;
+    size_t capacity = NETASCII_RAW_SIZE * 2;
+    size_t len = 0;
+    char* buffer = malloc(capacity);
+
+    if (buffer == NULL) {
+        return NULL;
+    }
+    netascii_encoder_init(&encoder);
+
+    while (1) {
+        // L'encodage peut au plus doubler la taille d'un tampon brut
+        if (capacity - len < NETASCII_RAW_SIZE * 2) {
+            char* bigger = realloc(buffer, capacity * 2);
+            if (bigger == NULL) {
+                free(buffer);
+                return NULL;
+            }
+            buffer = bigger;
+            capacity *= 2;
+        }
+        size_t n = netascii_read(&encoder, file, buffer + len, NETASCII_RAW_SIZE * 2);
+        len += n;
+        if (n < NETASCII_RAW_SIZE * 2) {
+            break;
+        }
+    }
+
+    *out_len = len;
+    return buffer;
+}
+
+
+
+/**
+ * \brief Initialise un décodeur netascii.
+ *
+ * \param decoder Le décodeur à initialiser.
+ */
+void netascii_decoder_init(NetasciiDecoder* decoder) {
+    decoder->cr_pending = 0;
+}
+
+
+
+/**
+ * \brief Décode un bloc netascii (CR LF -> LF, CR NUL -> CR).
+ *
+ * \param decoder L'état du décodeur.
+ * \param in Le bloc reçu.
+ * \param len La taille du bloc.
+ * \param out Le tampon de sortie, d'au moins len + 1 octets.
+ * \return Le nombre d'octets écrits dans out.
+ */
+size_t netascii_decode(NetasciiDecoder* decoder, const char* in, size_t len, char* out) {
+    size_t i = 0, o = 0;
+
+    // Terminer la séquence CR commencée dans le bloc précédent
+    if (decoder->cr_pending && len > 0) {
+        decoder->cr_pending = 0;
+        if (in[0] == '\n') {
+            out[o++] = '\n';
+            i = 1;
+        } else {
+            out[o++] = '\r';
+            if (in[0] == '\0') {
+                i = 1;
+            }
+        }
+    }
+
+    while (i < len) {
+        size_t n = netascii_scan(in + i, len - i, '\r', '\r');
+        memcpy(out + o, in + i, n);
+        i += n;
+        o += n;
+        if (i == len) {
+            break;
+        }
+
+        i++; // CR
+        if (i == len) {
+            decoder->cr_pending = 1;
+            break;
+        }
+        if (in[i] == '\n') {
+            out[o++] = '\n';
+            i++;
+        } else {
+            out[o++] = '\r';
+            if (in[i] == '\0') {
+                i++;
+            }
+        }
+    }
+    return o;
+}
+
+
+
+/**
+ * \brief Termine le décodage (CR isolé en fin de transfert).
+ *
+ * \param decoder L'état du décodeur.
+ * \param out Le tampon de sortie, d'au moins 1 octet.
+ * \return Le nombre d'octets écrits dans out.
+ */
+size_t netascii_decode_flush(NetasciiDecoder* decoder, char* out) {
+    if (decoder->cr_pending) {
+        decoder->cr_pending = 0;
+        out[0] = '\r';
+        return 1;
+    }
+    return 0;
+}
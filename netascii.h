@@ -0,0 +1,134 @@
+/*
+   Conversion netascii (RFC 764) en flux - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef NETASCII
+#define NETASCII
+
+
+// Taille du tampon de lecture brute de l'encodeur
+#define NETASCII_RAW_SIZE 4096
+
+// Taille maximale d'un fichier dont la version netascii est mise en cache
+#define NETASCII_CACHE_MAX_FILE (4L * 1024 * 1024)
+
+
+// État de l'encodeur (fichier local -> netascii), conservé entre deux blocs
+typedef struct {
+    char raw[NETASCII_RAW_SIZE]; // Données lues du fichier et pas encore encodées
+    size_t raw_pos; // Position de lecture dans raw
+    size_t raw_len; // Nombre d'octets valides dans raw
+    int pending; // Octet restant à émettre après un CR (-1 si aucun)
+} NetasciiEncoder;
+
+
+// État du décodeur (netascii -> fichier local), conservé entre deux blocs
+typedef struct {
+    int cr_pending; // Le bloc précédent se terminait par un CR
+} NetasciiDecoder;
+
+
+
+/**
+ * \brief Recherche le premier octet égal à a ou b.
+ *
+ * Utilise AVX2 ou SSE2 lorsque disponibles, avec un repli scalaire.
+ *
+ * \param data Les données à parcourir.
+ * \param len La taille des données.
+ * \param a Premier octet recherché.
+ * \param b Second octet recherché.
+ * \return L'indice du premier octet trouvé, ou len s'il n'y en a aucun.
+ */
+size_t netascii_scan(const char* data, size_t len, char a, char b);
+
+
+
+/**
+ * \brief Initialise un encodeur netascii.
+ *
+ * \param encoder L'encodeur à initialiser.
+ */
+void netascii_encoder_init(NetasciiEncoder* encoder);
+
+
+
+/**
+ * \brief Encode des données locales en netascii (LF -> CR LF, CR -> CR NUL).
+ *
+ * S'arrête lorsque out est plein ; un CR coupé en fin de bloc est complété
+ * au prochain appel grâce à l'état de l'encodeur.
+ *
+ * \param encoder L'état de l'encodeur.
+ * \param in Les données à encoder.
+ * \param in_len La taille des données.
+ * \param consumed Reçoit le nombre d'octets de in consommés.
+ * \param out Le tampon de sortie.
+ * \param out_cap La capacité du tampon de sortie.
+ * \return Le nombre d'octets écrits dans out.
+ */
+size_t netascii_encode(NetasciiEncoder* encoder, const char* in, size_t in_len, size_t* consumed, char* out, size_t out_cap);
+
+
+
+/**
+ * \brief Lit et encode un bloc netascii depuis un fichier.
+ *
+ * \param encoder L'état de l'encodeur.
+ * \param file Le fichier source.
+ * \param out Le tampon de sortie.
+ * \param out_cap La taille du bloc à produire.
+ * \return Le nombre d'octets produits (inférieur à out_cap seulement en fin de fichier).
+ */
+size_t netascii_read(NetasciiEncoder* encoder, FILE* file, char* out, size_t out_cap);
+
+
+
+/**
+ * \brief Encode un fichier complet en netascii dans un tampon alloué.
+ *
+ * \param file Le fichier source, positionné au début.
+ * \param out_len Reçoit la taille du contenu encodé.
+ * \return Le tampon (à libérer avec free), ou NULL en cas d'erreur.
+ */
+char* netascii_encode_file(FILE* file, size_t* out_len);
+
+
+
+/**
+ * \brief Initialise un décodeur netascii.
+ *
+ * \param decoder Le décodeur à initialiser.
+ */
+void netascii_decoder_init(NetasciiDecoder* decoder);
+
+
+
+/**
+ * \brief Décode un bloc netascii (CR LF -> LF, CR NUL -> CR).
+ *
+ * \param decoder L'état du décodeur.
+ * \param in Le bloc reçu.
+ * \param len La taille du bloc.
+ * \param out Le tampon de sortie, d'au moins len + 1 octets.
+ * \return Le nombre d'octets écrits dans out.
+ */
+size_t netascii_decode(NetasciiDecoder* decoder, const char* in, size_t len, char* out);
+
+
+
+/**
+ * \brief Termine le décodage (CR isolé en fin de transfert).
+ *
+ * \param decoder L'état du décodeur.
+ * \param out Le tampon de sortie, d'au moins 1 octet.
+ * \return Le nombre d'octets écrits dans out.
+ */
+size_t netascii_decode_flush(NetasciiDecoder* decoder, char* out);
+
+#endif
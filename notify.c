@@ -0,0 +1,171 @@
+#include "notify.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "clock.h"
+
+
+// Descripteurs de la minuterie et du canal de réveil
+static int timer_fd = -1;
+static int event_fd = -1;
+static int64_t armed_deadline = 0; // Échéance programmée (0 : minuterie désarmée)
+
+// File circulaire des messages déposés par les threads
+static NotifyMessage queue[NOTIFY_QUEUE_SIZE];
+static int queue_head = 0;
+static int queue_len = 0;
+static pthread_mutex_t queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+
+
+/**
+ * \brief Crée la minuterie et le canal de réveil de la boucle principale.
+ *
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int notify_init(void) {
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timer_fd < 0) {
+        perror("Erreur lors de la création de la minuterie");
+        return -1;
+    }
+    event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0) {
+        perror("Erreur lors de la création du canal de réveil");
+        close(timer_fd);
+        timer_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+
+
+/**
+ * \brief Retourne le descripteur de la minuterie, à surveiller en lecture.
+ *
+ * \return Le descripteur (timerfd).
+ */
+int notify_timer_fd(void) {
+    return timer_fd;
+}
+
+
+
+/**
+ * \brief Retourne le descripteur du canal de réveil, à surveiller en lecture.
+ *
+ * \return Le descripteur (eventfd).
+ */
+int notify_event_fd(void) {
+    return event_fd;
+}
+
+
+
+/**
+ * \brief Programme la minuterie à une échéance absolue.
+ *
+ * \param deadline L'échéance (ns), ou 0 pour désarmer la minuterie.
+ */
+void notify_arm(int64_t deadline) {
+    struct itimerspec spec;
+
+    if (deadline == armed_deadline) {
+        return; // échéance inchangée : pas d'appel système
+    }
+    armed_deadline = deadline;
+    memset(&spec, 0, sizeof(spec));
+    if (deadline > 0) {
+        spec.it_value.tv_sec = deadline / CLOCK_NS_PER_SEC;
+        spec.it_value.tv_nsec = deadline % CLOCK_NS_PER_SEC;
+    }
+    if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+        perror("Erreur lors de la programmation de la minuterie");
+    }
+}
+
+
+
+/**
+ * \brief Acquitte l'expiration de la minuterie (à appeler lorsqu'elle est lisible).
+ */
+void notify_timer_expired(void) {
+    uint64_t expirations;
+
+    armed_deadline = 0;
+    if (read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+        perror("Erreur lors de la lecture de la minuterie");
+    }
+}
+
+
+
+/**
+ * \brief Confie un traitement à la boucle principale et la réveille.
+ *
+ * \param callback Le traitement.
+ * \param arg Son argument.
+ * \return 0 en cas de succès, -1 si la file est pleine.
+ */
+int notify_post(NotifyCallback callback, void* arg) {
+    pthread_mutex_lock(&queue_mutex);
+    if (queue_len == NOTIFY_QUEUE_SIZE) {
+        pthread_mutex_unlock(&queue_mutex);
+        return -1;
+    }
+    NotifyMessage* message = &queue[(queue_head + queue_len) % NOTIFY_QUEUE_SIZE];
+    message->callback = callback;
+    message->arg = arg;
+    queue_len++;
+    pthread_mutex_unlock(&queue_mutex);
+
+    notify_wakeup();
+    return 0;
+}
+
+
+
+/**
+ * \brief Réveille la boucle principale sans message (utilisable dans un gestionnaire de signal).
+ */
+void notify_wakeup(void) {
+    uint64_t one = 1;
+
+    if (event_fd >= 0) {
+        // write est sûr dans un gestionnaire de signal ; un compteur saturé (EAGAIN) réveille déjà la boucle
+        ssize_t written = write(event_fd, &one, sizeof(one));
+        (void) written;
+    }
+}
+
+
+
+/**
+ * \brief Exécute les traitements déposés par les threads (à appeler lorsque le canal est lisible).
+ */
+void notify_dispatch(void) {
+    uint64_t count;
+
+    if (read(event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        perror("Erreur lors de la lecture du canal de réveil");
+    }
+
+    // Un message à la fois : un traitement peut en déposer d'autres sans interblocage
+    while (1) {
+        pthread_mutex_lock(&queue_mutex);
+        if (queue_len == 0) {
+            pthread_mutex_unlock(&queue_mutex);
+            break;
+        }
+        NotifyMessage message = queue[queue_head];
+        queue_head = (queue_head + 1) % NOTIFY_QUEUE_SIZE;
+        queue_len--;
+        pthread_mutex_unlock(&queue_mutex);
+
+        message.callback(message.arg);
+    }
+}
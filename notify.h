@@ -0,0 +1,102 @@
+/*
+   Réveil de la boucle principale : échéances (timerfd) et messages des threads (eventfd) - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#ifndef NOTIFY
+#define NOTIFY
+
+
+#define NOTIFY_QUEUE_SIZE 256 // Nombre maximal de messages en attente de traitement
+
+
+// Traitement exécuté par la boucle principale pour le compte d'un thread
+typedef void (*NotifyCallback)(void* arg);
+
+
+// Message déposé par un thread
+typedef struct {
+    NotifyCallback callback;
+    void* arg;
+} NotifyMessage;
+
+
+
+/**
+ * \brief Crée la minuterie et le canal de réveil de la boucle principale.
+ *
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int notify_init(void);
+
+
+
+/**
+ * \brief Retourne le descripteur de la minuterie, à surveiller en lecture.
+ *
+ * \return Le descripteur (timerfd).
+ */
+int notify_timer_fd(void);
+
+
+
+/**
+ * \brief Retourne le descripteur du canal de réveil, à surveiller en lecture.
+ *
+ * \return Le descripteur (eventfd).
+ */
+int notify_event_fd(void);
+
+
+
+/**
+ * \brief Programme la minuterie à une échéance absolue.
+ *
+ * La minuterie utilise la même horloge que clock_now (CLOCK_MONOTONIC) ; une échéance
+ * déjà passée la rend lisible immédiatement.
+ *
+ * \param deadline L'échéance (ns), ou 0 pour désarmer la minuterie.
+ */
+void notify_arm(int64_t deadline);
+
+
+
+/**
+ * \brief Acquitte l'expiration de la minuterie (à appeler lorsqu'elle est lisible).
+ */
+void notify_timer_expired(void);
+
+
+
+/**
+ * \brief Confie un traitement à la boucle principale et la réveille.
+ *
+ * Utilisable depuis n'importe quel thread ; le traitement est exécuté par
+ * notify_dispatch dans le thread de la boucle principale.
+ *
+ * \param callback Le traitement.
+ * \param arg Son argument.
+ * \return 0 en cas de succès, -1 si la file est pleine.
+ */
+int notify_post(NotifyCallback callback, void* arg);
+
+
+
+/**
+ * \brief Réveille la boucle principale sans message (utilisable dans un gestionnaire de signal).
+ */
+void notify_wakeup(void);
+
+
+
+/**
+ * \brief Exécute les traitements déposés par les threads (à appeler lorsque le canal est lisible).
+ */
+void notify_dispatch(void);
+
+#endif
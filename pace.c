@@ -0,0 +1,203 @@
+#include "pace.h"
+#include "tftp.h"
+
+#include <ctype.h>
+
+
+// Débits par sous-réseau et seau partagé par toutes les sessions
+static PaceRule rules[PACE_MAX_RULES];
+static int num_rules = 0;
+static TokenBucket global_bucket;
+static int pacing_enabled = 0;
+static PaceStats stats;
+
+// Taille d'un paquet de données complet (en-tête compris)
+#define PACE_PACKET_BYTES 516
+
+
+
+/**
+ * \brief Initialise un seau plein.
+ *
+ * \param bucket Le seau.
+ * \param rate Le débit (octets/s, 0 : illimité).
+ * \param burst La capacité (octets, 0 : valeur par défaut).
+ */
+static void bucket_init(TokenBucket* bucket, double rate, double burst) {
+    bucket->rate = rate;
+    bucket->burst = burst > 0 ? burst : PACE_DEFAULT_BURST_PACKETS * PACE_PACKET_BYTES;
+    bucket->tokens = bucket->burst;
+    bucket->last = clock_now();
+}
+
+
+
+/**
+ * \brief Remplit un seau selon le temps écoulé et retourne le délai avant de disposer de bytes jetons.
+ *
+ * \param bucket Le seau.
+ * \param bytes Le nombre de jetons nécessaires.
+ * \param now La date courante (ns).
+ * \return 0 si les jetons sont disponibles, sinon le délai en nanosecondes.
+ */
+static int64_t bucket_refill(TokenBucket* bucket, size_t bytes, int64_t now) {
+    if (bucket->rate <= 0) {
+        return 0;
+    }
+
+    int64_t elapsed = now - bucket->last;
+    if (elapsed > 0) {
+        bucket->tokens += (double) elapsed * bucket->rate / CLOCK_NS_PER_SEC;
+        if (bucket->tokens > bucket->burst) {
+            bucket->tokens = bucket->burst;
+        }
+        bucket->last = now;
+    }
+
+    // Un envoi plus gros que la rafale passe dès que le seau est plein
+    double needed = (double) bytes < bucket->burst ? (double) bytes : bucket->burst;
+    if (bucket->tokens >= needed) {
+        return 0;
+    }
+    return (int64_t) ((needed - bucket->tokens) * CLOCK_NS_PER_SEC / bucket->rate) + 1;
+}
+
+
+
+/**
+ * \brief Charge les limites de débit depuis un fichier de configuration.
+ *
+ * \param config Le chemin du fichier de configuration.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int pace_load(const char* config) {
+    char line[256];
+    char target[64];
+    double rate_kb;
+    double burst_kb;
+    int line_number = 0;
+
+    FILE* file = fopen(config, "r");
+    if (file == NULL) {
+        perror("Erreur lors de l'ouverture de la configuration des débits");
+        return -1;
+    }
+
+    // Rechargement : les limites précédentes sont remplacées
+    num_rules = 0;
+    pacing_enabled = 0;
+    memset(&global_bucket, 0, sizeof(global_bucket));
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line_number++;
+        char* start = line;
+        while (isspace((unsigned char)*start)) {
+            start++;
+        }
+        if (*start == '\0' || *start == '#') {
+            continue;
+        }
+
+        burst_kb = 0;
+        if (sscanf(start, "%63s %lf %lf", target, &rate_kb, &burst_kb) < 2 || rate_kb < 0 || burst_kb < 0) {
+            printf("Débits : ligne %d invalide\n", line_number);
+            continue;
+        }
+
+        if (strcmp(target, "global") == 0) {
+            bucket_init(&global_bucket, rate_kb * 1024, burst_kb * 1024);
+            pacing_enabled = 1;
+            continue;
+        }
+
+        // Sous-réseau adresse/préfixe (une adresse seule vaut /32 ou /128)
+        struct in6_addr network;
+        int prefix_len;
+        if (sockaddr_parse_prefix(target, &network, &prefix_len) != 0) {
+            printf("Débits : sous-réseau invalide ligne %d\n", line_number);
+            continue;
+        }
+        if (num_rules == PACE_MAX_RULES) {
+            printf("Débits : plus de %d sous-réseaux, ligne %d ignorée\n", PACE_MAX_RULES, line_number);
+            continue;
+        }
+
+        PaceRule* rule = &rules[num_rules++];
+        rule->network = network;
+        rule->prefix_len = prefix_len;
+        rule->rate = rate_kb * 1024;
+        rule->burst = burst_kb * 1024;
+        pacing_enabled = 1;
+    }
+
+    fclose(file);
+    printf("Débits : %d sous-réseaux, limite globale %.0f Ko/s\n", num_rules, global_bucket.rate / 1024);
+    return 0;
+}
+
+
+
+/**
+ * \brief Initialise le seau d'une nouvelle session selon le sous-réseau du client.
+ *
+ * \param bucket Le seau de la session.
+ * \param addr L'adresse du client (IPv4 ou IPv6).
+ */
+void pace_session_init(TokenBucket* bucket, const struct sockaddr_storage* addr) {
+    const PaceRule* best = NULL;
+    struct in6_addr ip;
+
+    sockaddr_to_in6(addr, &ip);
+    for (int i = 0; i < num_rules; ++i) {
+        if (sockaddr_prefix_match(&ip, &rules[i].network, rules[i].prefix_len) && (best == NULL || rules[i].prefix_len > best->prefix_len)) {
+            best = &rules[i];
+        }
+    }
+    bucket_init(bucket, best != NULL ? best->rate : 0, best != NULL ? best->burst : 0);
+}
+
+
+
+/**
+ * \brief Consomme les jetons d'un envoi, ou indique combien de temps attendre.
+ *
+ * \param bucket Le seau de la session.
+ * \param bytes La taille de l'envoi.
+ * \param now La date courante (ns, voir clock_now).
+ * \return 0 si l'envoi peut partir, sinon le délai d'attente en nanosecondes.
+ */
+int64_t pace_consume(TokenBucket* bucket, size_t bytes, int64_t now) {
+    if (!pacing_enabled) {
+        return 0;
+    }
+
+    int64_t wait = bucket_refill(bucket, bytes, now);
+    int64_t global_wait = bucket_refill(&global_bucket, bytes, now);
+    if (global_wait > wait) {
+        wait = global_wait;
+    }
+    if (wait > 0) {
+        stats.deferred++;
+        return wait;
+    }
+
+    stats.paced++;
+    if (bucket->rate > 0) {
+        bucket->tokens -= bytes;
+    }
+    if (global_bucket.rate > 0) {
+        global_bucket.tokens -= bytes;
+    }
+    return 0;
+}
+
+
+
+/**
+ * \brief Retourne les compteurs de la régulation.
+ *
+ * \return Les compteurs.
+ */
+PaceStats pace_get_stats(void) {
+    return stats;
+}
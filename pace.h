@@ -0,0 +1,101 @@
+/*
+   Régulation du débit d'émission par seaux à jetons - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "clock.h"
+
+#ifndef PACE
+#define PACE
+
+
+#define PACE_MAX_RULES 64 // Nombre maximal de sous-réseaux configurés
+#define PACE_DEFAULT_BURST_PACKETS 8 // Rafale par défaut, en paquets de données
+
+
+// Seau à jetons : rate octets par seconde, au plus burst octets d'avance
+typedef struct {
+    double rate; // Débit autorisé (octets/s, 0 : illimité)
+    double burst; // Capacité du seau (octets)
+    double tokens; // Jetons disponibles (octets)
+    int64_t last; // Date du dernier remplissage (ns, horloge monotone)
+} TokenBucket;
+
+
+// Débit par session appliqué aux clients d'un sous-réseau
+typedef struct {
+    struct in6_addr network; // Adresse du réseau (un réseau IPv4 est stocké sous forme mappée)
+    int prefix_len; // Longueur du préfixe sur 128 bits, pour retenir la règle la plus précise
+    double rate; // Débit par session (octets/s)
+    double burst; // Rafale par session (octets)
+} PaceRule;
+
+
+// Compteurs de la régulation
+typedef struct {
+    unsigned long paced; // Envois immédiats soumis à la régulation
+    unsigned long deferred; // Envois retardés faute de jetons
+} PaceStats;
+
+
+
+/**
+ * \brief Charge les limites de débit depuis un fichier de configuration.
+ *
+ * Chaque ligne contient un sous-réseau (adresse/préfixe) ou le mot "global", un débit
+ * en Ko/s et optionnellement une rafale en Ko :
+ *
+ *     global        50000
+ *     10.1.0.0/16   2000   32
+ *     2001:db8::/32 1000
+ *
+ * La ligne "global" limite l'ensemble du serveur ; les autres limitent chaque session
+ * d'un client du sous-réseau (la règle au préfixe le plus long s'applique).
+ * Un nouvel appel (rechargement) remplace les limites précédentes ; les sessions en
+ * cours gardent le débit fixé à leur création.
+ *
+ * \param config Le chemin du fichier de configuration.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int pace_load(const char* config);
+
+
+
+/**
+ * \brief Initialise le seau d'une nouvelle session selon le sous-réseau du client.
+ *
+ * \param bucket Le seau de la session.
+ * \param addr L'adresse du client (IPv4 ou IPv6).
+ */
+void pace_session_init(TokenBucket* bucket, const struct sockaddr_storage* addr);
+
+
+
+/**
+ * \brief Consomme les jetons d'un envoi, ou indique combien de temps attendre.
+ *
+ * L'envoi doit respecter à la fois le seau de la session et le seau global ; les jetons
+ * ne sont consommés que si les deux le permettent.
+ *
+ * \param bucket Le seau de la session.
+ * \param bytes La taille de l'envoi.
+ * \param now La date courante (ns, voir clock_now).
+ * \return 0 si l'envoi peut partir, sinon le délai d'attente en nanosecondes.
+ */
+int64_t pace_consume(TokenBucket* bucket, size_t bytes, int64_t now);
+
+
+
+/**
+ * \brief Retourne les compteurs de la régulation.
+ *
+ * \return Les compteurs.
+ */
+PaceStats pace_get_stats(void);
+
+#endif
@@ -0,0 +1,361 @@
+#include "pack.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// Pack actuellement ouvert
+static Pack pack;
+static int pack_loaded = 0;
+
+
+
+/**
+ * \brief Empreinte FNV-1a d'une chaîne avec graine.
+ *
+ * \param str La chaîne.
+ * \param seed La graine.
+ * \return L'empreinte.
+ */
+static uint32_t hash_name(const char* str, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ (seed * 16777619u);
+    while (*str) {
+        hash ^= (unsigned char)*str++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+
+
+/**
+ * \brief Retire un éventuel préfixe "./" ou "/" d'un chemin.
+ *
+ * \param name Le chemin.
+ * \return Le chemin sans préfixe.
+ */
+static const char* strip_prefix(const char* name) {
+    while (name[0] == '.' && name[1] == '/') {
+        name += 2;
+    }
+    while (name[0] == '/') {
+        name++;
+    }
+    return name;
+}
+
+
+
+/**
+ * \brief Lit un champ numérique octal d'un en-tête tar.
+ *
+ * \param field Le champ.
+ * \param len La taille du champ.
+ * \return La valeur.
+ */
+static size_t parse_octal(const char* field, size_t len) {
+    size_t value = 0;
+    for (size_t i = 0; i < len && field[i] >= '0' && field[i] <= '7'; ++i) {
+        value = value * 8 + (field[i] - '0');
+    }
+    return value;
+}
+
+
+
+/**
+ * \brief Parcourt les en-têtes tar et remplit pack.entries.
+ *
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+static int read_entries(void) {
+    size_t offset = 0;
+    size_t capacity = 0;
+
+    while (offset + PACK_BLOCK_SIZE <= pack.map_len) {
+        const char* header = pack.map + offset;
+        if (header[0] == '\0') {
+            break; // bloc de fin d'archive
+        }
+
+        size_t size = parse_octal(header + 124, 12);
+        char type = header[156];
+        size_t data_offset = offset + PACK_BLOCK_SIZE;
+        if (data_offset + size > pack.map_len) {
+            return -1;
+        }
+
+        if (type == '0' || type == '\0') {
+            // Nom complet : préfixe ustar (155 octets) + "/" + nom (100 octets)
+            char name[256 + 2];
+            if (memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0') {
+                snprintf(name, sizeof(name), "%.155s/%.100s", header + 345, header);
+            } else {
+                snprintf(name, sizeof(name), "%.100s", header);
+            }
+
+            if (pack.count == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                PackEntry* bigger = realloc(pack.entries, capacity * sizeof(PackEntry));
+                if (bigger == NULL) {
+                    return -1;
+                }
+                pack.entries = bigger;
+            }
+            PackEntry* entry = &pack.entries[pack.count];
+            entry->name = strdup(strip_prefix(name));
+            entry->data = pack.map + data_offset;
+            entry->size = size;
+            if (entry->name == NULL) {
+                return -1;
+            }
+            pack.count++;
+        }
+
+        offset = data_offset + (size + PACK_BLOCK_SIZE - 1) / PACK_BLOCK_SIZE * PACK_BLOCK_SIZE;
+    }
+    return 0;
+}
+
+
+
+/**
+ * \brief Compare deux entrées par nom, puis par position décroissante dans l'archive.
+ *
+ * \param a Première entrée.
+ * \param b Seconde entrée.
+ * \return Le résultat de la comparaison.
+ */
+static int compare_entries(const void* a, const void* b) {
+    const PackEntry* ea = a;
+    const PackEntry* eb = b;
+    int cmp = strcmp(ea->name, eb->name);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return ea->data < eb->data ? 1 : (ea->data > eb->data ? -1 : 0);
+}
+
+
+
+/**
+ * \brief Supprime les doublons (un fichier ajouté plusieurs fois à l'archive).
+ *
+ * Comme avec tar, la dernière version du fichier dans l'archive est conservée.
+ */
+static void remove_duplicates(void) {
+    size_t kept = 0;
+
+    qsort(pack.entries, pack.count, sizeof(PackEntry), compare_entries);
+    for (size_t i = 0; i < pack.count; ++i) {
+        if (kept > 0 && strcmp(pack.entries[kept - 1].name, pack.entries[i].name) == 0) {
+            free(pack.entries[i].name);
+            continue;
+        }
+        pack.entries[kept++] = pack.entries[i];
+    }
+    pack.count = kept;
+}
+
+
+
+/**
+ * \brief Cherche la graine qui place toutes les clés d'un seau dans des cases libres.
+ *
+ * \param members Les indices des entrées du seau.
+ * \param n Le nombre d'entrées du seau.
+ * \param positions Reçoit la case de chaque entrée.
+ * \return La graine, ou 0 si aucune graine n'a été trouvée.
+ */
+static uint32_t find_seed(const size_t* members, size_t n, size_t* positions) {
+    for (uint32_t seed = 1; seed <= PACK_MAX_SEED; ++seed) {
+        size_t placed = 0;
+        for (; placed < n; ++placed) {
+            size_t pos = hash_name(pack.entries[members[placed]].name, seed) % pack.num_slots;
+            int taken = pack.slots[pos] >= 0;
+            for (size_t j = 0; j < placed && !taken; ++j) {
+                taken = positions[j] == pos;
+            }
+            if (taken) {
+                break;
+            }
+            positions[placed] = pos;
+        }
+        if (placed == n) {
+            return seed;
+        }
+    }
+    return 0;
+}
+
+
+
+/**
+ * \brief Construit l'index à hachage parfait (hash and displace).
+ *
+ * Les seaux sont traités du plus rempli au moins rempli ; pour chacun, on cherche
+ * une graine qui place toutes ses clés dans des cases encore libres.
+ *
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+static int build_index(void) {
+    int result = 0;
+
+    pack.num_buckets = pack.count / PACK_BUCKET_SIZE + 1;
+    pack.num_slots = pack.count + pack.count / 4 + 1;
+    pack.displacements = calloc(pack.num_buckets, sizeof(uint32_t));
+    pack.slots = malloc(pack.num_slots * sizeof(int32_t));
+    size_t* bucket_start = calloc(pack.num_buckets + 1, sizeof(size_t));
+    size_t* members = malloc((pack.count + 1) * sizeof(size_t));
+    size_t* order = malloc(pack.num_buckets * sizeof(size_t));
+    size_t* positions = malloc((pack.count + 1) * sizeof(size_t));
+    size_t max_size = 0;
+
+    if (!pack.displacements || !pack.slots || !bucket_start || !members || !order || !positions) {
+        result = -1;
+    } else {
+        for (size_t i = 0; i < pack.num_slots; ++i) {
+            pack.slots[i] = -1;
+        }
+
+        // Répartition des clés dans les seaux (tri par dénombrement)
+        for (size_t i = 0; i < pack.count; ++i) {
+            bucket_start[hash_name(pack.entries[i].name, 0) % pack.num_buckets + 1]++;
+        }
+        for (size_t b = 0; b < pack.num_buckets; ++b) {
+            size_t size = bucket_start[b + 1];
+            max_size = size > max_size ? size : max_size;
+            bucket_start[b + 1] += bucket_start[b];
+        }
+        for (size_t i = 0; i < pack.count; ++i) {
+            size_t b = hash_name(pack.entries[i].name, 0) % pack.num_buckets;
+            members[bucket_start[b]++] = i;
+        }
+        for (size_t b = pack.num_buckets; b > 0; --b) {
+            bucket_start[b] = bucket_start[b - 1];
+        }
+        bucket_start[0] = 0;
+
+        // Seaux par taille décroissante (les seaux sont petits : tri par dénombrement)
+        size_t n_order = 0;
+        for (size_t size = max_size; size > 0; --size) {
+            for (size_t b = 0; b < pack.num_buckets; ++b) {
+                if (bucket_start[b + 1] - bucket_start[b] == size) {
+                    order[n_order++] = b;
+                }
+            }
+        }
+
+        for (size_t k = 0; k < n_order; ++k) {
+            size_t b = order[k];
+            size_t n = bucket_start[b + 1] - bucket_start[b];
+            uint32_t seed = find_seed(members + bucket_start[b], n, positions);
+            if (seed == 0) {
+                result = -1;
+                break;
+            }
+            pack.displacements[b] = seed;
+            for (size_t j = 0; j < n; ++j) {
+                pack.slots[positions[j]] = (int32_t) members[bucket_start[b] + j];
+            }
+        }
+    }
+
+    free(bucket_start);
+    free(members);
+    free(order);
+    free(positions);
+    return result;
+}
+
+
+
+/**
+ * \brief Ouvre une archive tar et construit son index.
+ *
+ * \param path Le chemin de l'archive.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int pack_open(const char* path) {
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0 || fstat(fd, &st) != 0 || st.st_size == 0) {
+        perror("Erreur lors de l'ouverture du pack");
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    pack_close();
+    memset(&pack, 0, sizeof(pack));
+    pack.map_len = st.st_size;
+    pack.map = mmap(NULL, pack.map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (pack.map == MAP_FAILED) {
+        perror("Erreur lors de la projection du pack");
+        return -1;
+    }
+    pack_loaded = 1;
+
+    if (read_entries() != 0) {
+        printf("Pack : archive %s invalide\n", path);
+        pack_close();
+        return -1;
+    }
+    remove_duplicates();
+    if (build_index() != 0) {
+        printf("Pack : archive %s invalide\n", path);
+        pack_close();
+        return -1;
+    }
+    printf("Pack : %zu fichiers indexés depuis %s\n", pack.count, path);
+    return 0;
+}
+
+
+
+/**
+ * \brief Recherche un fichier dans le pack ouvert.
+ *
+ * \param name Le chemin demandé.
+ * \return L'entrée, ou NULL si aucun pack n'est ouvert ou si le fichier est absent.
+ */
+const PackEntry* pack_lookup(const char* name) {
+    if (!pack_loaded || pack.count == 0) {
+        return NULL;
+    }
+    name = strip_prefix(name);
+
+    uint32_t seed = pack.displacements[hash_name(name, 0) % pack.num_buckets];
+    int32_t index = pack.slots[hash_name(name, seed) % pack.num_slots];
+    if (index < 0 || strcmp(pack.entries[index].name, name) != 0) {
+        return NULL;
+    }
+    return &pack.entries[index];
+}
+
+
+
+/**
+ * \brief Ferme le pack ouvert et libère son index.
+ */
+void pack_close(void) {
+    if (!pack_loaded) {
+        return;
+    }
+    for (size_t i = 0; i < pack.count; ++i) {
+        free(pack.entries[i].name);
+    }
+    free(pack.entries);
+    free(pack.displacements);
+    free(pack.slots);
+    if (pack.map != MAP_FAILED && pack.map != NULL) {
+        munmap(pack.map, pack.map_len);
+    }
+    memset(&pack, 0, sizeof(pack));
+    pack_loaded = 0;
+}
@@ -0,0 +1,71 @@
+/*
+   Fichier pack (archive tar) servi en lecture seule - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifndef PACK
+#define PACK
+
+
+#define PACK_BLOCK_SIZE 512 // Taille d'un bloc tar
+#define PACK_BUCKET_SIZE 4 // Nombre moyen de clés par seau de l'index
+#define PACK_MAX_SEED (1u << 20) // Nombre maximal de graines essayées par seau
+
+
+// Fichier contenu dans le pack
+typedef struct {
+    char* name; // Chemin du fichier dans l'archive
+    const char* data; // Contenu (dans la projection mémoire du pack)
+    size_t size; // Taille du contenu
+} PackEntry;
+
+
+// Pack projeté en mémoire et son index à hachage parfait
+typedef struct {
+    char* map; // Projection mémoire de l'archive
+    size_t map_len; // Taille de la projection
+    PackEntry* entries; // Fichiers de l'archive
+    size_t count; // Nombre de fichiers
+    uint32_t* displacements; // Graine de hachage de chaque seau
+    size_t num_buckets; // Nombre de seaux
+    int32_t* slots; // Indice de l'entrée de chaque case (-1 si vide)
+    size_t num_slots; // Nombre de cases
+} Pack;
+
+
+
+/**
+ * \brief Ouvre une archive tar et construit son index.
+ *
+ * L'archive est projetée en mémoire ; seuls les fichiers réguliers sont indexés.
+ * L'index est une table à hachage parfait (hash and displace) : une recherche ne
+ * calcule que deux empreintes et ne compare qu'une seule clé.
+ *
+ * \param path Le chemin de l'archive.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int pack_open(const char* path);
+
+
+
+/**
+ * \brief Recherche un fichier dans le pack ouvert.
+ *
+ * \param name Le chemin demandé (un éventuel préfixe "./" est ignoré).
+ * \return L'entrée, ou NULL si aucun pack n'est ouvert ou si le fichier est absent.
+ */
+const PackEntry* pack_lookup(const char* name);
+
+
+
+/**
+ * \brief Ferme le pack ouvert et libère son index.
+ */
+void pack_close(void);
+
+#endif
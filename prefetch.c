@@ -0,0 +1,175 @@
+#include "prefetch.h"
+#include "tftp.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// Tables du prédicteur (adressage direct, une collision remplace l'entrée)
+static PrefetchNode nodes[PREFETCH_MAX_FILES];
+static PrefetchClient history[PREFETCH_MAX_CLIENTS];
+static PrefetchStats stats;
+
+
+
+/**
+ * \brief Calcule l'empreinte d'un nom de fichier (djb2).
+ *
+ * \param str La chaîne.
+ * \return L'empreinte.
+ */
+static unsigned long hash_string(const char* str) {
+    unsigned long hash = 5381;
+    while (*str) {
+        hash = hash * 33 + (unsigned char)*str++;
+    }
+    return hash;
+}
+
+
+
+/**
+ * \brief Retourne le noeud d'un fichier, en le créant si nécessaire.
+ *
+ * \param filename Le nom du fichier.
+ * \param create Créer le noeud s'il est absent.
+ * \return Le noeud, ou NULL s'il est absent et create vaut 0.
+ */
+static PrefetchNode* get_node(const char* filename, int create) {
+    PrefetchNode* node = &nodes[hash_string(filename) % PREFETCH_MAX_FILES];
+    if (strcmp(node->filename, filename) != 0) {
+        if (!create) {
+            return NULL;
+        }
+        memset(node, 0, sizeof(PrefetchNode));
+        strcpy(node->filename, filename);
+    }
+    return node;
+}
+
+
+
+/**
+ * \brief Enregistre l'enchaînement from -> to.
+ *
+ * \param from Le fichier précédent.
+ * \param to Le fichier suivant.
+ */
+static void learn(const char* from, const char* to) {
+    PrefetchNode* node = get_node(from, 1);
+    int weakest = 0;
+
+    for (int i = 0; i < PREFETCH_SUCCESSORS; ++i) {
+        if (node->next[i].count > 0 && strcmp(node->next[i].filename, to) == 0) {
+            node->next[i].count++;
+            return;
+        }
+        if (node->next[i].count < node->next[weakest].count) {
+            weakest = i;
+        }
+    }
+    // Nouveau successeur : remplacer le moins fréquent
+    strcpy(node->next[weakest].filename, to);
+    node->next[weakest].count = 1;
+}
+
+
+
+/**
+ * \brief Charge un fichier dans le cache de pages sans bloquer.
+ *
+ * \param filename Le nom du fichier.
+ */
+static void warm_file(const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+}
+
+
+
+/**
+ * \brief Indique au noyau qu'un fichier va être lu séquentiellement.
+ *
+ * \param file Le fichier ouvert.
+ */
+void prefetch_sequential(FILE* file) {
+    posix_fadvise(fileno(file), 0, 0, POSIX_FADV_SEQUENTIAL);
+}
+
+
+
+/**
+ * \brief Demande au noyau de charger une plage d'un fichier en arrière-plan.
+ *
+ * \param file Le fichier ouvert.
+ * \param offset Le début de la plage.
+ * \param len La taille de la plage.
+ */
+void prefetch_range(FILE* file, off_t offset, long len) {
+    posix_fadvise(fileno(file), offset, len, POSIX_FADV_WILLNEED);
+}
+
+
+
+/**
+ * \brief Enregistre une requête de lecture et précharge le fichier suivant probable.
+ *
+ * \param addr L'adresse du client.
+ * \param filename Le fichier demandé.
+ * \return Le fichier préchargé, ou NULL si aucun successeur n'est connu.
+ */
+const char* prefetch_record_request(const struct sockaddr_storage* addr, const char* filename) {
+    PrefetchClient* client = &history[sockaddr_hash(addr) % PREFETCH_MAX_CLIENTS];
+    int64_t now = clock_now();
+    struct in6_addr ip;
+
+    sockaddr_to_in6(addr, &ip);
+    if (memcmp(&client->addr, &ip, sizeof(ip)) == 0 && now - client->when <= PREFETCH_WINDOW_SEC * CLOCK_NS_PER_SEC) {
+        if (strcmp(client->predicted, filename) == 0) {
+            stats.hits++;
+        }
+        if (strcmp(client->last, filename) != 0) {
+            learn(client->last, filename);
+        }
+    } else {
+        memset(client, 0, sizeof(PrefetchClient));
+        client->addr = ip;
+    }
+    strcpy(client->last, filename);
+    client->predicted[0] = '\0';
+    client->when = now;
+
+    // Précharger le successeur le plus fréquent
+    PrefetchNode* node = get_node(filename, 0);
+    if (node == NULL) {
+        return NULL;
+    }
+    int best = -1;
+    for (int i = 0; i < PREFETCH_SUCCESSORS; ++i) {
+        if (node->next[i].count > 0 && (best < 0 || node->next[i].count > node->next[best].count)) {
+            best = i;
+        }
+    }
+    if (best >= 0) {
+        strcpy(client->predicted, node->next[best].filename);
+        warm_file(client->predicted);
+        stats.predictions++;
+        return client->predicted;
+    }
+    return NULL;
+}
+
+
+
+/**
+ * \brief Retourne les compteurs du prédicteur.
+ *
+ * \return Les compteurs.
+ */
+PrefetchStats prefetch_get_stats(void) {
+    return stats;
+}
@@ -0,0 +1,100 @@
+/*
+   Lecture anticipée et prédiction du prochain fichier demandé - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <arpa/inet.h>
+
+#include "clock.h"
+
+#ifndef PREFETCH
+#define PREFETCH
+
+
+// Dimensions des tables du prédicteur
+#define PREFETCH_MAX_FILES 256
+#define PREFETCH_MAX_CLIENTS 1024
+#define PREFETCH_SUCCESSORS 4
+
+// Délai au-delà duquel deux requêtes d'un client ne sont plus considérées comme enchaînées
+#define PREFETCH_WINDOW_SEC 120
+
+
+// Fichier ayant suivi un autre fichier dans les requêtes d'un même client
+typedef struct {
+    char filename[504]; // Fichier suivant
+    unsigned int count; // Nombre d'occurrences de l'enchaînement
+} PrefetchSuccessor;
+
+
+// Fichier connu du prédicteur et ses successeurs observés
+typedef struct {
+    char filename[504];
+    PrefetchSuccessor next[PREFETCH_SUCCESSORS];
+} PrefetchNode;
+
+
+// Dernière requête d'un client
+typedef struct {
+    struct in6_addr addr; // Adresse du client (IPv4 sous forme mappée)
+    char last[504]; // Dernier fichier demandé
+    char predicted[504]; // Fichier préchargé pour ce client
+    int64_t when; // Date de la dernière requête (ns, horloge monotone)
+} PrefetchClient;
+
+
+// Compteurs du prédicteur
+typedef struct {
+    unsigned long predictions; // Fichiers préchargés
+    unsigned long hits; // Requêtes correspondant au fichier préchargé
+} PrefetchStats;
+
+
+
+/**
+ * \brief Indique au noyau qu'un fichier va être lu séquentiellement.
+ *
+ * \param file Le fichier ouvert.
+ */
+void prefetch_sequential(FILE* file);
+
+
+
+/**
+ * \brief Demande au noyau de charger une plage d'un fichier en arrière-plan.
+ *
+ * \param file Le fichier ouvert.
+ * \param offset Le début de la plage.
+ * \param len La taille de la plage.
+ */
+void prefetch_range(FILE* file, off_t offset, long len);
+
+
+
+/**
+ * \brief Enregistre une requête de lecture et précharge le fichier suivant probable.
+ *
+ * L'enchaînement avec la requête précédente du même client est appris, puis le
+ * successeur le plus fréquent du fichier demandé est chargé dans le cache de pages.
+ *
+ * \param addr L'adresse du client.
+ * \param filename Le fichier demandé.
+ * \return Le fichier préchargé, ou NULL si aucun successeur n'est connu.
+ */
+const char* prefetch_record_request(const struct sockaddr_storage* addr, const char* filename);
+
+
+
+/**
+ * \brief Retourne les compteurs du prédicteur.
+ *
+ * \return Les compteurs.
+ */
+PrefetchStats prefetch_get_stats(void);
+
+#endif
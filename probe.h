@@ -0,0 +1,45 @@
+/*
+   Points de traçage statiques (USDT) du chemin des paquets, pour bpftrace et perf - Définitions et structures de données
+*/
+
+
+#include <stdint.h>
+
+#ifndef PROBE
+#define PROBE
+
+
+// Les sondes sont compilées si <sys/sdt.h> (paquet systemtap-sdt-dev) est disponible, sauf
+// avec -DTFTP_NO_PROBES. Une sonde inactive coûte une instruction nop ; sans <sys/sdt.h>,
+// elle disparaît et ses arguments ne sont pas évalués (ils ne doivent pas avoir d'effet).
+//
+// Fournisseur "tftp" ; les sondes et leurs arguments :
+//   request_accept  opcode, nom du fichier, 1 si mise en file d'attente
+//   session_start   session, opcode, nom du fichier
+//   session_end     session, octets transférés, durée (ns)
+//   data_send       session, numéro de bloc, octets, 1 si renvoi
+//   ack_receive     session, numéro de bloc, blocs acquittés, RTT du bloc (ns)
+//   data_receive    session, numéro de bloc, octets
+//   retransmit      session, numéro de bloc, tentative, cause (PROBE_RETRANSMIT_*)
+//   timeout_abort   session, tentatives, octets transférés
+//   file_contention nom du fichier, mode (READ_MODE, WRITE_MODE), lecteurs en cours
+#if !defined(TFTP_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define PROBES_ENABLED 1
+#endif
+#endif
+
+// Cause d'un renvoi (sonde retransmit)
+#define PROBE_RETRANSMIT_TIMEOUT 0 // Expiration du délai
+#define PROBE_RETRANSMIT_REPEATED_ACK 1 // ACK répété : le client a perdu un bloc de la fenêtre
+
+#ifdef PROBES_ENABLED
+#define PROBE3(name, a, b, c) DTRACE_PROBE3(tftp, name, a, b, c)
+#define PROBE4(name, a, b, c, d) DTRACE_PROBE4(tftp, name, a, b, c, d)
+#else
+#define PROBE3(name, a, b, c) do { } while (0)
+#define PROBE4(name, a, b, c, d) do { } while (0)
+#endif
+
+#endif
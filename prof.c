@@ -0,0 +1,143 @@
+#include "prof.h"
+
+
+static ProfHistogram histograms[PROF_STAGES];
+
+// Noms affichés, dans l'ordre des constantes PROF_*
+static const char* stage_names[PROF_STAGES] = {
+    "select", "boucle", "requête", "métadonnées", "ouverture",
+    "lecture", "écriture", "envoi", "attente ACK", "retransmission"
+};
+
+
+
+/**
+ * \brief Retourne la date de début d'une mesure (voir prof_end).
+ *
+ * \return La date en nanosecondes (horloge monotone, non mise en cache).
+ */
+int64_t prof_begin(void) {
+    return clock_read();
+}
+
+
+
+/**
+ * \brief Termine une mesure et l'ajoute à l'histogramme de l'étape.
+ *
+ * \param stage L'étape (PROF_*).
+ * \param start La date retournée par prof_begin.
+ */
+void prof_end(int stage, int64_t start) {
+    prof_add(stage, clock_read() - start);
+}
+
+
+
+/**
+ * \brief Ajoute une durée mesurée autrement à l'histogramme d'une étape.
+ *
+ * \param stage L'étape (PROF_*).
+ * \param ns La durée en nanosecondes.
+ */
+void prof_add(int stage, int64_t ns) {
+    ProfHistogram* histogram = &histograms[stage];
+    int bucket = 0;
+
+    if (ns < 0) {
+        ns = 0;
+    }
+    if (ns > 1) {
+        bucket = 63 - __builtin_clzll((unsigned long long) ns);
+        if (bucket >= PROF_BUCKETS) {
+            bucket = PROF_BUCKETS - 1;
+        }
+    }
+    histogram->buckets[bucket]++;
+    histogram->count++;
+    histogram->total += ns;
+    if (ns > histogram->max) {
+        histogram->max = ns;
+    }
+}
+
+
+
+/**
+ * \brief Retourne l'histogramme d'une étape.
+ *
+ * \param stage L'étape (PROF_*).
+ * \return Une copie de l'histogramme.
+ */
+ProfHistogram prof_get(int stage) {
+    return histograms[stage];
+}
+
+
+
+/**
+ * \brief Estime un quantile : borne supérieure de la classe qui le contient.
+ *
+ * \param histogram L'histogramme (non vide).
+ * \param fraction Le quantile (0.5 pour la médiane).
+ * \return La durée en nanosecondes (au plus le maximum observé).
+ */
+static int64_t quantile(const ProfHistogram* histogram, double fraction) {
+    unsigned long rank = (unsigned long) (fraction * histogram->count);
+    unsigned long seen = 0;
+
+    for (int b = 0; b < PROF_BUCKETS - 1; ++b) {
+        seen += histogram->buckets[b];
+        if (seen > rank) {
+            int64_t bound = (int64_t) 1 << (b + 1);
+            return bound < histogram->max ? bound : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+
+
+/**
+ * \brief Écrit une durée dans l'unité la plus lisible (ns, µs, ms, s).
+ *
+ * \param ns La durée en nanosecondes.
+ * \param text Le tampon recevant le texte.
+ * \param size La taille du tampon.
+ */
+void prof_format_duration(int64_t ns, char* text, size_t size) {
+    if (ns < 1000) {
+        snprintf(text, size, "%lld ns", (long long) ns);
+    } else if (ns < CLOCK_NS_PER_MS) {
+        snprintf(text, size, "%.1f µs", ns / 1e3);
+    } else if (ns < CLOCK_NS_PER_SEC) {
+        snprintf(text, size, "%.1f ms", ns / 1e6);
+    } else {
+        snprintf(text, size, "%.2f s", ns / 1e9);
+    }
+}
+
+
+
+/**
+ * \brief Écrit une ligne par étape mesurée : nombre, moyenne, quantiles (borne supérieure de leur classe) et maximum.
+ *
+ * \param out Le flux de sortie.
+ */
+void prof_print(FILE* out) {
+    char mean[32], p50[32], p90[32], p99[32], max[32];
+
+    for (int s = 0; s < PROF_STAGES; ++s) {
+        const ProfHistogram* histogram = &histograms[s];
+        if (histogram->count == 0) {
+            continue;
+        }
+        prof_format_duration(histogram->total / (int64_t) histogram->count, mean, sizeof(mean));
+        prof_format_duration(quantile(histogram, 0.5), p50, sizeof(p50));
+        prof_format_duration(quantile(histogram, 0.9), p90, sizeof(p90));
+        prof_format_duration(quantile(histogram, 0.99), p99, sizeof(p99));
+        prof_format_duration(histogram->max, max, sizeof(max));
+        fprintf(out, "Profil : %s, %lu mesures, moyenne %s, p50 < %s, p90 < %s, p99 < %s, max %s\n",
+                stage_names[s], histogram->count, mean, p50, p90, p99, max);
+    }
+}
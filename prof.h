@@ -0,0 +1,100 @@
+/*
+   Profil des étapes du traitement : histogrammes des durées (select, requête, ouverture, lecture, envoi...) - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "clock.h"
+
+#ifndef PROF
+#define PROF
+
+
+#define PROF_BUCKETS 40 // Classes de l'histogramme : [2^b, 2^(b+1)) ns, la dernière jusqu'à l'infini
+
+// Étapes mesurées
+#define PROF_SELECT 0 // Attente dans select
+#define PROF_LOOP 1 // Traitement d'un tour de boucle (hors select)
+#define PROF_PARSE 2 // Analyse d'une requête et création de la session
+#define PROF_LOOKUP 3 // Existence et droits du fichier (cache des métadonnées, access, stat)
+#define PROF_OPEN 4 // Ouverture du fichier (fopen, fichier anonyme, version compressée)
+#define PROF_READ 5 // Lecture d'un bloc (cache, anneau partagé, fread, décompression)
+#define PROF_WRITE 6 // Écriture d'un bloc reçu
+#define PROF_SEND 7 // Appel système d'envoi (DATA, rafale, ACK, OACK)
+#define PROF_ACK 8 // Attente de la réponse du client (dernier envoi → ACK ou DATA suivant)
+#define PROF_STALL 9 // Attente avant retransmission (dernier envoi → expiration)
+#define PROF_STAGES 10
+
+
+// Histogramme des durées d'une étape
+typedef struct {
+    unsigned long count; // Mesures
+    int64_t total; // Somme des durées (ns)
+    int64_t max; // Plus longue durée (ns)
+    unsigned long buckets[PROF_BUCKETS]; // Répartition par puissance de deux
+} ProfHistogram;
+
+
+
+/**
+ * \brief Retourne la date de début d'une mesure (voir prof_end).
+ *
+ * \return La date en nanosecondes (horloge monotone, non mise en cache).
+ */
+int64_t prof_begin(void);
+
+
+
+/**
+ * \brief Termine une mesure et l'ajoute à l'histogramme de l'étape.
+ *
+ * \param stage L'étape (PROF_*).
+ * \param start La date retournée par prof_begin.
+ */
+void prof_end(int stage, int64_t start);
+
+
+
+/**
+ * \brief Ajoute une durée mesurée autrement à l'histogramme d'une étape.
+ *
+ * \param stage L'étape (PROF_*).
+ * \param ns La durée en nanosecondes.
+ */
+void prof_add(int stage, int64_t ns);
+
+
+
+/**
+ * \brief Retourne l'histogramme d'une étape.
+ *
+ * \param stage L'étape (PROF_*).
+ * \return Une copie de l'histogramme.
+ */
+ProfHistogram prof_get(int stage);
+
+
+
+/**
+ * \brief Écrit une ligne par étape mesurée : nombre, moyenne, quantiles (borne supérieure de leur classe) et maximum.
+ *
+ * \param out Le flux de sortie.
+ */
+void prof_print(FILE* out);
+
+
+
+/**
+ * \brief Écrit une durée dans l'unité la plus lisible (ns, µs, ms, s).
+ *
+ * \param ns La durée en nanosecondes.
+ * \param text Le tampon recevant le texte.
+ * \param size La taille du tampon.
+ */
+void prof_format_duration(int64_t ns, char* text, size_t size);
+
+#endif
@@ -0,0 +1,199 @@
+#include "sched.h"
+
+
+// Classes de taille (par taille croissante) et état des sessions
+static SchedClass classes[SCHED_MAX_CLASSES];
+static int num_classes = 0;
+static SchedSlot slots[FD_SETSIZE];
+
+// File circulaire des sessions en attente et position du tour courant
+static int ring[FD_SETSIZE];
+static int ring_len = 0;
+static int cursor = 0;
+
+
+
+/**
+ * \brief Compare deux classes par taille croissante.
+ *
+ * \param a Première classe.
+ * \param b Seconde classe.
+ * \return Le résultat de la comparaison.
+ */
+static int compare_classes(const void* a, const void* b) {
+    long sa = ((const SchedClass*) a)->max_size;
+    long sb = ((const SchedClass*) b)->max_size;
+    return sa < sb ? -1 : (sa > sb ? 1 : 0);
+}
+
+
+
+/**
+ * \brief Configure les poids par taille de fichier.
+ *
+ * \param spec La spécification "taille_Ko:poids[,taille_Ko:poids...]".
+ * \return 0 en cas de succès, -1 si la spécification est invalide.
+ */
+int sched_configure(const char* spec) {
+    const char* p = spec;
+
+    num_classes = 0;
+    while (*p != '\0') {
+        long size_kb;
+        int weight;
+        int consumed;
+        if (sscanf(p, "%ld:%d%n", &size_kb, &weight, &consumed) != 2 || size_kb < 0 || weight < 1
+            || num_classes == SCHED_MAX_CLASSES) {
+            printf("Ordonnanceur : poids invalides \"%s\"\n", spec);
+            return -1;
+        }
+        classes[num_classes].max_size = size_kb * 1024;
+        classes[num_classes].weight = weight;
+        num_classes++;
+        p += consumed;
+        if (*p == ',') {
+            p++;
+        }
+    }
+    qsort(classes, num_classes, sizeof(SchedClass), compare_classes);
+    return 0;
+}
+
+
+
+/**
+ * \brief Fixe le poids d'une session d'après la taille du fichier transféré.
+ *
+ * \param fd Le descripteur de la session.
+ * \param size La taille du fichier (octets).
+ */
+void sched_set_size(int fd, long size) {
+    slots[fd].weight = SCHED_DEFAULT_WEIGHT;
+    for (int i = 0; i < num_classes; ++i) {
+        if (size <= classes[i].max_size) {
+            slots[fd].weight = classes[i].weight;
+            break;
+        }
+    }
+}
+
+
+
+/**
+ * \brief Place une session ayant un envoi en attente dans la file de l'ordonnanceur.
+ *
+ * La session est insérée juste avant la position courante : elle sera servie à la fin
+ * du tour en cours, après les sessions qui attendaient déjà.
+ *
+ * \param fd Le descripteur de la session.
+ * \param cost Le coût d'un envoi (octets).
+ */
+void sched_enqueue(int fd, long cost) {
+    if (slots[fd].queued) {
+        return;
+    }
+    if (slots[fd].weight < 1) {
+        slots[fd].weight = SCHED_DEFAULT_WEIGHT;
+    }
+    memmove(&ring[cursor + 1], &ring[cursor], (ring_len - cursor) * sizeof(int));
+    ring[cursor] = fd;
+    ring_len++;
+    cursor = (cursor + 1) % ring_len;
+    slots[fd].queued = 1;
+    slots[fd].cost = cost;
+    slots[fd].deficit = 0;
+    slots[fd].topped = 0;
+}
+
+
+
+/**
+ * \brief Retire une session de la file (envoi effectué ou session terminée).
+ *
+ * \param fd Le descripteur de la session.
+ */
+void sched_dequeue(int fd) {
+    if (!slots[fd].queued) {
+        return;
+    }
+    for (int i = 0; i < ring_len; ++i) {
+        if (ring[i] != fd) {
+            continue;
+        }
+        memmove(&ring[i], &ring[i + 1], (ring_len - i - 1) * sizeof(int));
+        ring_len--;
+        if (i < cursor) {
+            cursor--;
+        }
+        if (cursor >= ring_len) {
+            cursor = 0;
+        }
+        break;
+    }
+    // Une session sans envoi en attente ne garde pas de budget (DRR)
+    slots[fd].queued = 0;
+    slots[fd].deficit = 0;
+    slots[fd].topped = 0;
+}
+
+
+
+/**
+ * \brief Retourne le nombre de sessions en attente.
+ *
+ * \return Le nombre de sessions dans la file.
+ */
+int sched_queued(void) {
+    return ring_len;
+}
+
+
+
+/**
+ * \brief Choisit la prochaine session à servir (deficit round robin).
+ *
+ * \return Le descripteur de la session, ou -1 si la file est vide.
+ */
+int sched_next(void) {
+    if (ring_len == 0) {
+        return -1;
+    }
+
+    // Le budget de chaque passage croît avec le poids : la boucle se termine toujours
+    while (1) {
+        SchedSlot* slot = &slots[ring[cursor]];
+        if (!slot->topped) {
+            slot->deficit += (long) SCHED_QUANTUM * slot->weight;
+            slot->topped = 1;
+        }
+        if (slot->deficit >= slot->cost) {
+            slot->deficit -= slot->cost;
+            return ring[cursor];
+        }
+        slot->topped = 0;
+        cursor = (cursor + 1) % ring_len;
+    }
+}
+
+
+
+/**
+ * \brief Rend le budget d'une session choisie qui n'a pas pu envoyer, et passe à la suivante.
+ *
+ * \param fd Le descripteur de la session.
+ */
+void sched_skip(int fd) {
+    // Le budget non utilisé est conservé, dans la limite d'un tour (ou d'un envoi, s'il coûte plus)
+    long limit = (long) SCHED_QUANTUM * slots[fd].weight;
+    if (limit < slots[fd].cost) {
+        limit = slots[fd].cost;
+    }
+    slots[fd].deficit += slots[fd].cost;
+    if (slots[fd].deficit > limit) {
+        slots[fd].deficit = limit;
+    }
+    slots[fd].topped = 0;
+    if (ring_len > 0 && ring[cursor] == fd) {
+        cursor = (cursor + 1) % ring_len;
+    }
+}
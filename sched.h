@@ -0,0 +1,112 @@
+/*
+   Ordonnancement équitable des envois entre sessions (deficit round robin) - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+
+#ifndef SCHED
+#define SCHED
+
+
+#define SCHED_QUANTUM 516 // Budget ajouté à chaque tour pour un poids de 1 (un paquet de données de 512 octets)
+#define SCHED_MAX_CLASSES 8 // Nombre maximal de classes de taille de fichier
+#define SCHED_DEFAULT_WEIGHT 1
+
+
+// Poids des transferts de fichiers de taille inférieure ou égale à max_size
+typedef struct {
+    long max_size; // Taille maximale du fichier (octets)
+    int weight; // Poids (nombre de quanta par tour)
+} SchedClass;
+
+
+// État d'une session dans l'ordonnanceur (indexé par descripteur)
+typedef struct {
+    int weight; // Poids de la session
+    long deficit; // Budget restant (octets)
+    long cost; // Coût d'un envoi : taille d'un paquet de la session (octets)
+    int queued; // La session a un envoi en attente
+    int topped; // Le quantum du passage courant a déjà été ajouté
+} SchedSlot;
+
+
+
+/**
+ * \brief Configure les poids par taille de fichier.
+ *
+ * La spécification est une liste "taille_Ko:poids" séparée par des virgules, par exemple
+ * "64:8,4096:2" : les fichiers de 64 Ko au plus ont un poids de 8, ceux de 4 Mo au plus
+ * un poids de 2, les autres le poids par défaut.
+ *
+ * \param spec La spécification.
+ * \return 0 en cas de succès, -1 si la spécification est invalide.
+ */
+int sched_configure(const char* spec);
+
+
+
+/**
+ * \brief Fixe le poids d'une session d'après la taille du fichier transféré.
+ *
+ * \param fd Le descripteur de la session.
+ * \param size La taille du fichier (octets).
+ */
+void sched_set_size(int fd, long size);
+
+
+
+/**
+ * \brief Place une session ayant un envoi en attente dans la file de l'ordonnanceur.
+ *
+ * \param fd Le descripteur de la session.
+ * \param cost Le coût d'un envoi : taille d'un paquet de données de la session (octets),
+ *        qui dépend de la taille de bloc négociée.
+ */
+void sched_enqueue(int fd, long cost);
+
+
+
+/**
+ * \brief Retire une session de la file (envoi effectué ou session terminée).
+ *
+ * \param fd Le descripteur de la session.
+ */
+void sched_dequeue(int fd);
+
+
+
+/**
+ * \brief Retourne le nombre de sessions en attente.
+ *
+ * \return Le nombre de sessions dans la file.
+ */
+int sched_queued(void);
+
+
+
+/**
+ * \brief Choisit la prochaine session à servir (deficit round robin).
+ *
+ * Chaque session reçoit à chaque tour un budget proportionnel à son poids et est servie
+ * tant que son budget couvre le coût d'un de ses envois ; le budget est débité de ce coût.
+ * Une session aux grands blocs attend donc plusieurs tours entre deux envois : le partage
+ * se fait en octets, pas en paquets.
+ *
+ * \return Le descripteur de la session, ou -1 si la file est vide.
+ */
+int sched_next(void);
+
+
+
+/**
+ * \brief Rend le budget d'une session choisie qui n'a pas pu envoyer, et passe à la suivante.
+ *
+ * \param fd Le descripteur de la session.
+ */
+void sched_skip(int fd);
+
+#endif
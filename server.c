@@ -4,47 +4,168 @@
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <sys/time.h>
+#include <sys/stat.h>
 #include <fcntl.h>
 #include <errno.h>
 #include <strings.h>
+#include <signal.h>
 
 #include "tftp.h"
 #include "sync.h"
+#include "cache.h"
+#include "netascii.h"
+#include "mcast.h"
+#include "fanout.h"
+#include "prefetch.h"
+#include "warm.h"
+#include "pack.h"
+#include "metacache.h"
+#include "gen.h"
+#include "pace.h"
+#include "sched.h"
+#include "cc.h"
+#include "clock.h"
+#include "notify.h"
+#include "handoff.h"
+#include "acl.h"
+#include "zst.h"
+#include "digest.h"
+#include "store.h"
+#include "upload.h"
+#include "admit.h"
+#include "prof.h"
+#include "flight.h"
+#include "probe.h"
 
 
 #define SERVER_MAIN_PORT 69
 
-#define SELECT_TIMEOUT_SEC 1
 #define TIMEOUT_SEC 4
 
+#define MAX_OACK_OPTIONS 3 // blksize, windowsize, rollover
+
+#define MAX_CONTROL_CONNECTIONS 4 // Connexions simultanées sur le socket de contrôle
+
 
 // type def
 
+// Bloc lu et envoyé, conservé jusqu'à son acquittement
+typedef struct {
+    char *data; // block_size octets, dans window_data
+    int size;
+    int64_t sent_time; // Date du dernier envoi (ns, nulle si jamais envoyé)
+    int retransmitted; // Bloc renvoyé : son ACK ne donne pas de mesure de RTT fiable
+} WindowBlock;
+
 typedef struct {
     int sockfd;
-    struct sockaddr_in addr;
+    struct sockaddr_storage addr;
     socklen_t len;
     TFTP_Request request;
     FILE* file_fd;
-    char buffer[MAX_DATA_SIZE];
-    int buffer_size;
-    uint16_t block_number;
-    struct timeval last_sent_time; // Temps du dernier envoi de paquet
+    int upload; // Nature du fichier reçu en cours d'écriture (UPLOAD_NONE, UPLOAD_ANONYMOUS, UPLOAD_NAMED)
+    int64_t last_sent_time; // Date du dernier envoi de paquet (ns, horloge monotone)
     PacketType last_action_type; // Type de la dernière action effectuée (paquet de données ou paquet d'acquittement)
     int retries; // Nombre de tentatives de retransmission
+    off_t bytes_transferred; // Nombre d'octets de données transférés
+    int netascii; // Transfert en mode netascii
+    NetasciiEncoder encoder; // État de conversion netascii (RRQ)
+    NetasciiDecoder decoder; // État de conversion netascii (WRQ)
+    Digest digest; // Empreintes du contenu reçu, calculées au fil des blocs (WRQ)
+    CacheEntry* cache_entry; // Entrée du cache référencée par la session (NULL si aucune)
+    const char* mem_data; // Contenu servi depuis la mémoire, cache ou pack (NULL : lecture dans file_fd)
+    size_t mem_len; // Taille du contenu en mémoire
+    size_t mem_offset; // Position de lecture dans mem_data
+    int mem_translate; // Convertir le contenu en mémoire en netascii à la volée
+    int file_session; // Une session de fichier (sync.c) est ouverte pour ce client, fermée par delete_client
+    FileMode file_mode; // Mode de la session de fichier ouverte (READ_MODE ou WRITE_MODE)
+    FanoutFile* fanout; // Lecture partagée avec les autres sessions du même fichier
+    ZstReader* zst; // Version compressée servie décompressée (NULL si aucune)
+    off_t file_offset; // Offset du prochain bloc à lire dans le fichier
+    TokenBucket pacer; // Débit autorisé pour la session
+    int64_t send_at; // Date à laquelle réessayer l'envoi du prochain bloc (ns, nulle si aucune)
+    int window_size; // Fenêtre négociée (RFC 7440) ; 1 : un ACK par bloc (RFC 1350)
+    WindowBlock* window; // Blocs lus et non acquittés (RRQ), window_size emplacements
+    char* window_data; // Données des blocs de la fenêtre (window_size * block_size octets)
+    int block_size; // Taille de bloc négociée (RFC 2348) ; MAX_DATA_SIZE sans l'option
+    int max_datagram; // Plus grand datagramme vers le client sans fragmentation (0 : non mesuré, pas de rafale)
+    int rollover; // Numéro suivant le bloc 65535 (TFTP_ROLLOVER_ZERO ou TFTP_ROLLOVER_ONE)
+    TFTP_Option oack[MAX_OACK_OPTIONS]; // Options acceptées, renvoyées dans l'OACK
+    int num_oack;
+    unsigned long read_seq; // Numéro non tronqué du dernier bloc lu
+    unsigned long next_seq; // Numéro du prochain bloc à envoyer
+    unsigned long acked_seq; // Numéro du dernier bloc acquitté (RRQ) ou reçu (WRQ)
+    int eof; // Le dernier bloc du fichier a été lu
+    int oack_pending; // OACK envoyé, en attente de l'ACK du bloc 0
+    uint16_t ack_block; // Numéro du dernier ACK envoyé (WRQ)
+    int blocked; // Socket plein : envoi différé jusqu'à ce qu'il redevienne inscriptible (writefds)
+    uint32_t rx_drops; // Datagrammes perdus en réception déjà comptés (SO_RXQ_OVFL)
+    long admit_bytes; // Octets de fenêtre comptés par le contrôle d'admission
+    int admit_files; // Fichier ouvert compté par le contrôle d'admission
+    CongestionControl cc; // Contrôle de congestion des transferts fenêtrés
+    unsigned long id; // Numéro de la session (croissant, jamais réutilisé contrairement au socket)
+    int64_t started; // Date de création de la session (ns, horloge monotone)
+    FlightRecorder flight; // Derniers événements de la session
 } ClientInfo;
 
+// Connexion sur le socket de contrôle : commande attendue, puis réponse envoyée sans bloquer
+typedef struct {
+    int fd; // -1 si l'emplacement est libre
+    int64_t accepted; // Date d'acceptation (ns, horloge monotone)
+    char *output; // Réponse à envoyer (HANDOFF_DUMP), NULL tant que la commande n'est pas lue
+    size_t output_len; // Taille de la réponse
+    size_t output_sent; // Octets déjà envoyés
+} ControlConnection;
+
 typedef void (*TFTP_HandlerFunction)(ClientInfo* client);
 
 // fun def
 void initialize_Client(ClientInfo* client);
 void add_client(ClientInfo *client, int sockfd);
 void delete_client(int sockfd);
+void start_session(const char *packet, int length, const struct sockaddr_storage *addr, socklen_t addr_len);
+int normalize_request(char *packet, int *length);
+void queue_request(const char *packet, int length, const struct sockaddr_storage *addr, socklen_t addr_len);
+void reject_request(const struct sockaddr_storage *addr);
+void dispatch_queued_requests(void);
+long request_size(const char *filename);
 void handle_new_read_request(ClientInfo *client);
+int compressed_path(const char *filename, char *path, size_t size);
+int start_compressed_read(ClientInfo *client);
 void handle_new_write_request(ClientInfo *client);
 void update_maxfd();
+void usage(const char *program);
+void print_stats(void);
+void print_diagnostics(FILE *out);
+void handle_sigusr1(int sig);
+void handle_sigusr2(int sig);
+void handle_sighup(int sig);
+void reload_config(void);
+void handle_control(void);
+void handle_control_connection(ControlConnection *conn, int readable, int writable);
+void flush_control_connection(ControlConnection *conn);
+void close_control_connection(ControlConnection *conn);
+int read_next_block(ClientInfo *client, char *out);
+void start_read_transfer(ClientInfo *client);
+void fill_window(ClientInfo *client);
+unsigned long unsent_blocks(ClientInfo *client);
+int handle_data_ack(ClientInfo *client, uint16_t block_number);
+void handle_repeated_ack(ClientInfo *client);
+void send_next_block(ClientInfo *client);
+void send_ack(ClientInfo *client, uint16_t block_number);
+void negotiate_options(ClientInfo *client, int allow_window);
+void accept_option(ClientInfo *client, const char *name, int value);
+void send_session_oack(ClientInfo *client);
+void defer_session(ClientInfo *client);
+void flush_session(ClientInfo *client);
+void count_rx_drops(uint32_t *seen, uint32_t drops);
+int send_pending_blocks(ClientInfo *client, int64_t now, int max_blocks);
+int64_t send_scheduled_blocks(void);
+int64_t next_timer_deadline(int64_t next_send, int64_t next_mcast);
+int write_block(ClientInfo *client, const char *data, size_t size);
+int finish_write(ClientInfo *client);
+void publish_digest(ClientInfo *client);
 
-double elapsed_time(struct timeval *start, struct timeval *end);
 void check_timeouts_and_retransmit();
 
 
@@ -54,9 +175,355 @@ void check_timeouts_and_retransmit();
 ClientInfo* clients[FD_SETSIZE];
 int maxfd;
 int num_clients = 0;
+int scan_start = 0; // Position de départ du parcours des sessions (tourne à chaque itération)
 fd_set readfds;
+fd_set writefds; // Sessions en attente de place dans leur socket
 int server_sockfd;
+uint32_t listen_drops = 0; // Datagrammes perdus en réception sur le port principal déjà comptés
+unsigned long deferred_sends = 0; // Envois différés faute de place dans un socket
+unsigned long rx_dropped = 0; // Datagrammes perdus en réception faute de place (tous sockets)
 ServerFileArray fileArray;
+volatile sig_atomic_t stats_requested = 0;
+volatile sig_atomic_t dump_requested = 0;
+unsigned long next_session_id = 1;
+volatile sig_atomic_t reload_requested = 0;
+// Configuration relue sur SIGHUP
+const char *manifest = NULL;
+int warm_threads = WARM_DEFAULT_THREADS;
+const char *gen_config = NULL;
+const char *pace_config = NULL;
+const char *acl_config = NULL;
+const char *admit_config = NULL;
+int default_rollover = TFTP_ROLLOVER_ZERO; // Numérotation après le bloc 65535 sans option rollover
+// Relève : socket de contrôle (-1 si désactivée), sessions en cours terminées avant de quitter
+int control_fd = -1;
+ControlConnection controls[MAX_CONTROL_CONNECTIONS];
+int draining = 0;
+
+
+
+
+
+
+
+/**
+ * Affiche l'aide de la ligne de commande.
+ * 
+ * @param program Le nom du programme.
+ */
+void usage(const char *program) {
+    printf("Usage : %s [-m manifeste] [-j threads] [-c taille_cache_Mo] [-p pack.tar] [-g generateurs.conf] [-l debits.conf] [-w taille_Ko:poids,...] [-s controle.sock] [-a acces.conf] [-d depot] [-q admission.conf] [-r 0|1]\n", program);
+    printf("  -m manifeste  fichiers (ou motifs glob) à précharger en cache au démarrage\n");
+    printf("  -j threads    nombre de threads de préchargement (défaut %d)\n", WARM_DEFAULT_THREADS);
+    printf("  -c taille     taille maximale du cache de contenu en Mo (défaut %ld)\n", CACHE_DEFAULT_BYTES / (1024 * 1024));
+    printf("  -p pack.tar   archive tar servie en lecture seule avant le répertoire courant\n");
+    printf("  -g fichier    règles de génération de contenu (motif, template|plugin, chemin, durée de vie)\n");
+    printf("  -l fichier    limites de débit (global ou sous-réseau, Ko/s, rafale en Ko)\n");
+    printf("  -w poids      poids des sessions par taille de fichier, ex. 64:8,4096:2 (défaut %d)\n", SCHED_DEFAULT_WEIGHT);
+    printf("  -s chemin     socket de contrôle de la relève : une nouvelle instance lancée avec le même\n");
+    printf("                chemin reprend le port %d, l'ancienne termine ses transferts puis s'arrête\n", SERVER_MAIN_PORT);
+    printf("  -a fichier    règles d'accès (sous-réseau, préfixe de chemin, read|write|rw|deny)\n");
+    printf("  -d dépôt      dépôt adressé par contenu : les fichiers reçus identiques partagent un seul objet\n");
+    printf("  -q fichier    limites d'admission (sessions, Ko en vol, fichiers) et file d'attente prioritaire\n");
+    printf("                (défaut %d sessions, %d fichiers, file de %d requêtes)\n", ADMIT_DEFAULT_SESSIONS, ADMIT_DEFAULT_FILES, ADMIT_DEFAULT_QUEUE);
+    printf("  -r 0|1        numéro du bloc suivant le bloc 65535 si le client n'envoie pas l'option rollover (défaut 0)\n");
+    printf("Envoyer SIGUSR1 au processus affiche les compteurs (caches, régulation, accès, admission, sockets...).\n");
+    printf("Envoyer SIGUSR2 au processus affiche le profil des étapes et le journal de bord des sessions ;\n");
+    printf("avec -s, la commande D sur le socket de contrôle le renvoie : printf D | socat - UNIX-CONNECT:controle.sock\n");
+    printf("Envoyer SIGHUP au processus relit les fichiers de -a, -g, -l, -m et -q sans interrompre les transferts.\n");
+}
+
+
+
+
+/**
+ * Gestionnaire de SIGUSR1 : demande l'affichage des compteurs à la boucle principale.
+ * 
+ * @param sig Le numéro du signal.
+ */
+void handle_sigusr1(int sig) {
+    (void) sig;
+    stats_requested = 1;
+    notify_wakeup();
+}
+
+
+
+
+/**
+ * Gestionnaire de SIGUSR2 : demande l'affichage du profil et du journal de bord à la boucle principale.
+ * 
+ * @param sig Le numéro du signal.
+ */
+void handle_sigusr2(int sig) {
+    (void) sig;
+    dump_requested = 1;
+    notify_wakeup();
+}
+
+
+
+
+/**
+ * Gestionnaire de SIGHUP : demande le rechargement de la configuration à la boucle principale.
+ * 
+ * @param sig Le numéro du signal.
+ */
+void handle_sighup(int sig) {
+    (void) sig;
+    reload_requested = 1;
+    notify_wakeup();
+}
+
+
+
+
+/**
+ * Relit les fichiers de configuration (accès, admission, générateurs, débits, manifeste de préchargement).
+ * 
+ * Les sessions en cours ne sont pas interrompues ; un fichier illisible laisse la
+ * configuration correspondante inchangée.
+ */
+void reload_config(void) {
+    printf("Rechargement de la configuration\n");
+    if (acl_config != NULL && acl_load(acl_config) != 0) {
+        printf("Accès : configuration précédente conservée\n");
+    }
+    if (admit_config != NULL && admit_load(admit_config) != 0) {
+        printf("Admission : configuration précédente conservée\n");
+    }
+    if (gen_config != NULL && gen_load(gen_config) != 0) {
+        printf("Générateurs : configuration précédente conservée\n");
+    }
+    if (pace_config != NULL && pace_load(pace_config) != 0) {
+        printf("Débits : configuration précédente conservée\n");
+    }
+    if (manifest != NULL && warm_start(manifest, warm_threads) != 0) {
+        printf("Préchargement désactivé (manifeste illisible)\n");
+    }
+}
+
+
+
+
+/**
+ * Accepte une connexion sur le socket de contrôle ; sa commande sera lue par handle_control_connection.
+ * 
+ * Si toutes les places sont prises, la connexion la plus ancienne est fermée : une connexion
+ * muette ne bloque ni la boucle principale ni les suivantes.
+ */
+void handle_control(void) {
+    int fd = handoff_accept(control_fd);
+    ControlConnection *slot = &controls[0];
+
+    if (fd < 0) {
+        return;
+    }
+    if (fd >= FD_SETSIZE) {
+        close(fd);
+        return;
+    }
+    for (int i = 0; i < MAX_CONTROL_CONNECTIONS; ++i) {
+        if (controls[i].fd < 0) {
+            slot = &controls[i];
+            break;
+        }
+        if (controls[i].accepted < slot->accepted) {
+            slot = &controls[i];
+        }
+    }
+    close_control_connection(slot);
+    slot->fd = fd;
+    slot->accepted = clock_now();
+    FD_SET(fd, &readfds);
+    if (fd > maxfd) {
+        maxfd = fd;
+    }
+}
+
+
+
+
+
+/**
+ * Traite une connexion du socket de contrôle devenue lisible ou inscriptible.
+ * 
+ * HANDOFF_DUMP : le profil et le journal de bord sont mis en forme en mémoire puis envoyés
+ * sans bloquer, au rythme où le client les lit.
+ * HANDOFF_REQUEST : le socket d'écoute est transmis à la nouvelle instance, puis les requêtes
+ * ne sont plus lues : les transferts en cours se terminent avant l'arrêt du processus.
+ * Toute autre commande, ou une connexion fermée sans commande, est ignorée.
+ * 
+ * @param conn La connexion.
+ * @param readable La connexion est lisible (commande attendue).
+ * @param writable La connexion est inscriptible (réponse en cours d'envoi).
+ */
+void handle_control_connection(ControlConnection *conn, int readable, int writable) {
+    char command;
+
+    if (conn->output != NULL) {
+        if (writable) {
+            flush_control_connection(conn);
+        }
+        return;
+    }
+    if (!readable) {
+        return;
+    }
+
+    int result = handoff_read_command(conn->fd, &command);
+    if (result == 0) {
+        return;
+    }
+    if (result < 0 || (command != HANDOFF_DUMP && command != HANDOFF_REQUEST)) {
+        close_control_connection(conn);
+        return;
+    }
+
+    if (command == HANDOFF_DUMP) {
+        FILE *out = open_memstream(&conn->output, &conn->output_len);
+        if (out == NULL) {
+            close_control_connection(conn);
+            return;
+        }
+        print_diagnostics(out);
+        fclose(out);
+        conn->output_sent = 0;
+        FD_CLR(conn->fd, &readfds);
+        FD_SET(conn->fd, &writefds);
+        flush_control_connection(conn);
+        return;
+    }
+
+    // handoff_send ferme la connexion
+    int fd = conn->fd;
+    FD_CLR(fd, &readfds);
+    conn->fd = -1;
+    if (handoff_send(fd, server_sockfd) != 0) {
+        return;
+    }
+    // Le socket reste ouvert (même socket que celui de la nouvelle instance) pour les erreurs
+    // UnknownTransferID, mais il n'est plus lu
+    FD_CLR(server_sockfd, &readfds);
+    FD_CLR(control_fd, &readfds);
+    close(control_fd);
+    control_fd = -1;
+    draining = 1;
+    printf("Relève : socket d'écoute transmis, %d transferts à terminer\n", num_clients + mcast_active_groups());
+}
+
+
+
+
+
+/**
+ * Envoie la suite de la réponse d'une connexion de contrôle, sans bloquer.
+ * 
+ * La connexion est fermée une fois la réponse envoyée, ou si le client est parti (MSG_NOSIGNAL :
+ * pas de SIGPIPE).
+ * 
+ * @param conn La connexion.
+ */
+void flush_control_connection(ControlConnection *conn) {
+    while (conn->output_sent < conn->output_len) {
+        ssize_t sent = send(conn->fd, conn->output + conn->output_sent, conn->output_len - conn->output_sent,
+                            MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return; // la suite partira lorsque le socket sera de nouveau inscriptible
+        }
+        if (sent <= 0) {
+            break;
+        }
+        conn->output_sent += (size_t) sent;
+    }
+    close_control_connection(conn);
+}
+
+
+
+
+
+/**
+ * Ferme une connexion de contrôle et libère sa réponse (emplacement libre accepté).
+ * 
+ * @param conn La connexion.
+ */
+void close_control_connection(ControlConnection *conn) {
+    if (conn->fd >= 0) {
+        FD_CLR(conn->fd, &readfds);
+        FD_CLR(conn->fd, &writefds);
+        close(conn->fd);
+    }
+    free(conn->output);
+    conn->fd = -1;
+    conn->output = NULL;
+    conn->output_len = 0;
+    conn->output_sent = 0;
+}
+
+
+
+
+/**
+ * Affiche les compteurs du serveur : caches (métadonnées, prédiction du fichier suivant), régulation,
+ * accès, admission, zstd, réception et dépôt, sockets et contrôle de congestion.
+ */
+void print_stats(void) {
+    MetaStats meta = metacache_get_stats();
+    PrefetchStats prefetch = prefetch_get_stats();
+    PaceStats pace = pace_get_stats();
+    AclStats acl = acl_get_stats();
+    AdmitStats admit = admit_get_stats();
+    ZstStats zst = zst_get_stats();
+    StoreStats store = store_get_stats();
+    CcStats cc = cc_get_stats();
+    unsigned long lookups = meta.hits + meta.misses;
+
+    printf("Stats : métadonnées %lu/%lu trouvées en cache (%.1f %%), dont %lu fichiers inexistants, %lu invalidations\n",
+           meta.hits, lookups, lookups ? 100.0 * meta.hits / lookups : 0.0, meta.negative_hits, meta.invalidations);
+    printf("Stats : préchargement %lu prédictions, %lu confirmées\n", prefetch.predictions, prefetch.hits);
+    printf("Stats : régulation %lu envois immédiats, %lu retardés\n", pace.paced, pace.deferred);
+    printf("Stats : accès %lu autorisés, %lu refusés\n", acl.allowed, acl.denied);
+    printf("Stats : admission %lu immédiates, %lu mises en file (%lu servies, %lu évincées, %lu expirées, pic %d), %lu refusées, %d en attente\n",
+           admit.admitted, admit.queued, admit.dequeued, admit.evicted, admit.expired, admit.peak_queue, admit.refused, admit_queued());
+    printf("Stats : zstd %lu fichiers, trames %lu en cache / %lu décompressées, %lu tampons en flux, %llu octets décompressés\n",
+           zst.opened, zst.frame_hits, zst.frame_decoded, zst.streamed, zst.bytes_decoded);
+    printf("Stats : réception %lu fichiers hachés (%llu octets, %s), dépôt %lu nouveaux, %lu dédupliqués (%llu octets économisés), %lu erreurs\n",
+           store.hashed, store.bytes_hashed, digest_engine(), store.stored, store.deduplicated, store.bytes_saved, store.errors);
+    printf("Stats : sockets %lu envois différés (file d'émission pleine), %lu datagrammes perdus en réception (file pleine)\n",
+           deferred_sends, rx_dropped);
+    printf("Stats : fenêtres %lu ACK, %lu pertes, %lu expirations ; cwnd", cc.acks, cc.losses, cc.timeouts);
+    for (int b = 0; b < CC_HISTOGRAM_BUCKETS; ++b) {
+        printf(" %d%s:%lu", 1 << b, b == CC_HISTOGRAM_BUCKETS - 1 ? "+" : "", cc.cwnd_histogram[b]);
+    }
+    printf("\n");
+}
+
+
+
+
+/**
+ * Écrit le profil des étapes puis le journal de bord des sessions terminées récemment et des sessions en cours.
+ * 
+ * @param out Le flux de sortie.
+ */
+void print_diagnostics(FILE *out) {
+    int64_t now = clock_now();
+
+    prof_print(out);
+    flight_print_finished(out, now);
+    for (int i = server_sockfd + 1; i <= maxfd; ++i) {
+        ClientInfo *client = clients[i];
+        if (client == NULL) {
+            continue;
+        }
+        fprintf(out, "Journal : session %lu | %s | %s | fd %d | %lld octets, bloc %lu acquitté, %lu lu (en cours)\n",
+                client->id, ntohs(client->request.opcode) == TFTP_OPCODE_WRQ ? "WRQ" : "RRQ", client->request.filename,
+                client->sockfd, (long long) client->bytes_transferred, client->acked_seq, client->read_seq);
+        flight_print(&client->flight, out, now);
+    }
+    fflush(out);
+}
 
 
 
@@ -64,52 +531,223 @@ ServerFileArray fileArray;
 
 
 
-int main() {
-    struct sockaddr_in cliaddr;
+int main(int argc, char *argv[]) {
+    struct sockaddr_storage cliaddr;
     socklen_t len;
-    char buffer[MAX_PACKET_SIZE];
+    char buffer[TFTP_MAX_PACKET_SIZE + 1];
+    const char *handoff_path = NULL;
+    int opt;
+
+    // Options de la ligne de commande
+    while ((opt = getopt(argc, argv, "m:j:c:p:g:l:w:s:a:d:q:r:h")) != -1) {
+        switch (opt) {
+            case 'm':
+                manifest = optarg;
+                break;
+            case 'j':
+                warm_threads = atoi(optarg);
+                break;
+            case 'c':
+                cache_set_limit((size_t) atol(optarg) * 1024 * 1024);
+                break;
+            case 'p':
+                if (pack_open(optarg) != 0) {
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'g':
+                if (gen_load(optarg) != 0) {
+                    exit(EXIT_FAILURE);
+                }
+                gen_config = optarg;
+                break;
+            case 'l':
+                if (pace_load(optarg) != 0) {
+                    exit(EXIT_FAILURE);
+                }
+                pace_config = optarg;
+                break;
+            case 'w':
+                if (sched_configure(optarg) != 0) {
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 's':
+                handoff_path = optarg;
+                break;
+            case 'a':
+                if (acl_load(optarg) != 0) {
+                    exit(EXIT_FAILURE);
+                }
+                acl_config = optarg;
+                break;
+            case 'q':
+                if (admit_load(optarg) != 0) {
+                    exit(EXIT_FAILURE);
+                }
+                admit_config = optarg;
+                break;
+            case 'd':
+                if (store_init(optarg) != 0) {
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'r':
+                if (strcmp(optarg, "0") != 0 && strcmp(optarg, "1") != 0) {
+                    usage(argv[0]);
+                    exit(EXIT_FAILURE);
+                }
+                default_rollover = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+                exit(opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
     
-    // Création socket
-    server_sockfd = createUDPSocket(NULL,SERVER_MAIN_PORT);
+    // Création socket, ou reprise de celui de l'instance en cours d'exécution
+    server_sockfd = -1;
+    if (handoff_path != NULL) {
+        server_sockfd = handoff_receive(handoff_path);
+        if (server_sockfd >= 0) {
+            printf("Relève : socket d'écoute repris de l'instance précédente\n");
+        }
+    }
+    if (server_sockfd < 0) {
+        server_sockfd = createUDPSocket(NULL,SERVER_MAIN_PORT);
+    }
 
     if (server_sockfd < 0){
         printf("err création main socket !\n");
         exit(EXIT_FAILURE);
     }
+    // Tampon de réception agrandi pour absorber les rafales de requêtes ; un socket repris
+    // d'une version antérieure est rendu non bloquant
+    fcntl(server_sockfd, F_SETFL, fcntl(server_sockfd, F_GETFL) | O_NONBLOCK);
+    tune_socket(server_sockfd, TFTP_SOCKET_BUFFER, TFTP_LISTEN_BUFFER);
 
     printf("server init (fd_setsize %d)\n",FD_SETSIZE);
     printf("Serveur TFTP en attente de connexions sur le port %d...\n",SERVER_MAIN_PORT);
 
+    // Minuterie des échéances et canal de réveil par les threads (préchargement...)
+    if (notify_init() != 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Préchargement en arrière-plan : le serveur répond pendant ce temps depuis le disque
+    if (manifest != NULL && warm_start(manifest, warm_threads) != 0) {
+        printf("Préchargement désactivé (manifeste illisible)\n");
+    }
+
     // Server Is Working
     memset(&cliaddr, 0, sizeof(cliaddr));
     initialize_serverFileArray(&fileArray);
+    mcast_init(&readfds, &fileArray);
 
     FD_ZERO(&readfds);
+    FD_ZERO(&writefds);
     FD_SET(server_sockfd, &readfds);
     maxfd = server_sockfd;
+    for (int i = 0; i < MAX_CONTROL_CONNECTIONS; ++i) {
+        controls[i].fd = -1;
+        controls[i].output = NULL;
+    }
+    if (handoff_path != NULL) {
+        control_fd = handoff_listen(handoff_path);
+    }
+    if (control_fd >= 0) {
+        FD_SET(control_fd, &readfds);
+        if (control_fd > maxfd) {
+            maxfd = control_fd;
+        }
+    }
+    FD_SET(notify_timer_fd(), &readfds);
+    FD_SET(notify_event_fd(), &readfds);
+    if (notify_timer_fd() > maxfd) {
+        maxfd = notify_timer_fd();
+    }
+    if (notify_event_fd() > maxfd) {
+        maxfd = notify_event_fd();
+    }
+
+    // Cache des métadonnées, invalidé par inotify sur le répertoire servi
+    int inotify_fd = metacache_init(".");
+    if (inotify_fd >= 0) {
+        FD_SET(inotify_fd, &readfds);
+        if (inotify_fd > maxfd) {
+            maxfd = inotify_fd;
+        }
+    }
 
-    long size_in_bytes, size_in_mb,size_in_kb;
-    // Configuration du timeout pour select
-    struct timeval timeout;
-    struct timeval *timeout_pointer;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_sigusr1;
+    sigaction(SIGUSR1, &sa, NULL);
+    sa.sa_handler = handle_sigusr2;
+    sigaction(SIGUSR2, &sa, NULL);
+    sa.sa_handler = handle_sighup;
+    sigaction(SIGHUP, &sa, NULL);
+    // Client parti avant la fin d'une réponse (socket de contrôle) : erreur EPIPE plutôt que l'arrêt du serveur
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, NULL);
+
+    long long size_in_bytes, size_in_mb,size_in_kb;
+    int64_t busy_since = 0; // Retour du dernier select (profil du traitement d'un tour)
 
     // boucle principal
     while (1) {
         
-        if (num_clients > 0){
-            timeout.tv_sec = SELECT_TIMEOUT_SEC;
-            timeout.tv_usec = 0;
-            timeout_pointer = &timeout;
+        // Relève : la nouvelle instance répond aux requêtes, s'arrêter après le dernier transfert
+        if (draining && num_clients == 0 && mcast_active_groups() == 0 && admit_queued() == 0) {
+            printf("Relève : transferts terminés, arrêt de l'ancienne instance\n");
+            exit(EXIT_SUCCESS);
+        }
+
+        // Capacité libérée par les sessions terminées : requêtes en attente servies (ou expirées)
+        dispatch_queued_requests();
+
+        if (num_clients > 0 || mcast_active_groups() > 0 || admit_queued() > 0){
             check_timeouts_and_retransmit();
+            int64_t next_mcast = mcast_check_timeouts(TIMEOUT_SEC);
+
+            // Retransmissions, blocs en attente (ordonnanceur, régulation) : la minuterie
+            // réveille select à l'échéance la plus proche
+            int64_t next_send = send_scheduled_blocks();
+            notify_arm(next_timer_deadline(next_send, next_mcast));
         }else {
-            timeout_pointer = NULL;
+            notify_arm(0);
         }
         
         fd_set tmpfds = readfds;
-        int activity = select(maxfd+1, &tmpfds, NULL, NULL, timeout_pointer);
+        fd_set tmpwfds = writefds;
+        int64_t select_start = prof_begin();
+        if (busy_since != 0) {
+            prof_add(PROF_LOOP, select_start - busy_since);
+        }
+        int activity = select(maxfd+1, &tmpfds, &tmpwfds, NULL, NULL);
+        int select_errno = errno; // les traitements ci-dessous peuvent modifier errno
+        clock_refresh(); // une seule lecture de l'horloge par tour de boucle
+        busy_since = clock_now();
+        prof_add(PROF_SELECT, busy_since - select_start);
+
+        if (stats_requested) {
+            stats_requested = 0;
+            print_stats();
+        }
+        if (reload_requested) {
+            reload_requested = 0;
+            reload_config();
+        }
+        if (dump_requested) {
+            dump_requested = 0;
+            print_diagnostics(stdout);
+        }
 
         // Vérification si select a renvoyé une erreur ou s'il n'y a eu aucune activité
-        if (activity < 0) {
+        if (activity < 0 && select_errno == EINTR) {
+            continue;
+        } else if (activity < 0) {
+            errno = select_errno;
             perror("select error");
             exit(EXIT_FAILURE);
         } else if (activity == 0) {
@@ -118,99 +756,114 @@ int main() {
             continue;
         }
 
-        if (FD_ISSET(server_sockfd, &tmpfds)) {
+        if (FD_ISSET(notify_timer_fd(), &tmpfds)) {
+            notify_timer_expired();
+        }
+        if (FD_ISSET(notify_event_fd(), &tmpfds)) {
+            notify_dispatch();
+        }
+
+        if (inotify_fd >= 0 && FD_ISSET(inotify_fd, &tmpfds)) {
+            metacache_handle_events();
+        }
+
+        if (control_fd >= 0 && FD_ISSET(control_fd, &tmpfds)) {
+            handle_control();
+        }
+        for (int c = 0; c < MAX_CONTROL_CONNECTIONS; ++c) {
+            int fd = controls[c].fd;
+            if (fd >= 0 && (FD_ISSET(fd, &tmpfds) || FD_ISSET(fd, &tmpwfds))) {
+                handle_control_connection(&controls[c], FD_ISSET(fd, &tmpfds), FD_ISSET(fd, &tmpwfds));
+            }
+        }
+
+        if (!draining && FD_ISSET(server_sockfd, &tmpfds)) {
             len = sizeof(cliaddr);
 
             // Receive message from client
-            int bytes_received = recvfrom(server_sockfd, (char *)buffer, MAX_PACKET_SIZE,0,(struct sockaddr *)&cliaddr, &len);
+            uint32_t drops = listen_drops;
+            int bytes_received = recv_packet(server_sockfd, buffer, MAX_PACKET_SIZE, &cliaddr, &len, &drops);
+            count_rx_drops(&listen_drops, drops);
             if (bytes_received == -1) {
-                perror("Erreur lors de la réception des données");
-                exit(EXIT_FAILURE);
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    perror("Erreur lors de la réception des données");
+                }
+                continue;
             }
-
-            // printf("Taille du paquet reçu: %zd octets\n", bytes_received);
-            ClientInfo* client = (ClientInfo *)malloc(sizeof(ClientInfo));
-            initialize_Client(client);
-
-            // Récupérer et afficher l'adresse du client
-            char client_ip_address[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &cliaddr.sin_addr, client_ip_address, INET_ADDRSTRLEN);
-            // printf("Adresse du client: %s\n", client_ip_address);
-
-            
-            int newsockfd = createUDPSocket(client_ip_address,0); // Create a new socket with ephemeral port for responding to client
-            if (newsockfd < 0){
-                perror("socket creation failed");
+            buffer[bytes_received] = '\0';
+
+            // Contrôle d'accès avant toute création de session (et avant de révéler si le fichier existe),
+            // sur le chemin normalisé qui sert aussi à ouvrir le fichier
+            uint16_t request_opcode;
+            memcpy(&request_opcode, buffer, sizeof(uint16_t));
+            if (bytes_received >= 2 && (ntohs(request_opcode) == TFTP_OPCODE_RRQ || ntohs(request_opcode) == TFTP_OPCODE_WRQ)
+                && (normalize_request(buffer, &bytes_received) != 0
+                    || !acl_check(&cliaddr, buffer + 2, ntohs(request_opcode) == TFTP_OPCODE_RRQ ? ACL_READ : ACL_WRITE))) {
+                send_error_packet(server_sockfd, &cliaddr, AccessViolation, get_error_message(AccessViolation), NULL);
+                continue;
             }
-            // ajouet le client
-            add_client(client,newsockfd);
-
-            client->sockfd = newsockfd;
-            memcpy(&client->addr,&cliaddr,sizeof(cliaddr));
-            client->len = len;
-            
-
-            // remplissage et verification des info
 
-            memcpy(&client->request.opcode, buffer, sizeof(uint16_t));
-            TFTP_HandlerFunction selectedHandler = NULL;
-
-            // Gestion de la demande en fonction de l'opcode
-            if (ntohs(client->request.opcode) == TFTP_OPCODE_RRQ) {
-                client->block_number = 1;
-                selectedHandler = handle_new_read_request;
-            } else if (ntohs(client->request.opcode) == TFTP_OPCODE_WRQ) {
-                client->block_number = 0;
-                selectedHandler = handle_new_write_request;
-            } else {
-                // Opcode non pris en charge, envoi d'un paquet d'erreur au client
-                send_error_packet(client->sockfd,&client->addr,NotDefined,get_error_message(NotDefined),"Opcode non pris en charge");
-                delete_client(newsockfd);
+            // Fichier connu comme inexistant (ainsi que sa version compressée) : réponse immédiate, sans session ni appel système
+            char compressed[sizeof(((TFTP_Request *)0)->filename)];
+            if (ntohs(request_opcode) == TFTP_OPCODE_RRQ && strlen(buffer + 2) < sizeof(((TFTP_Request *)0)->filename)
+                && metacache_is_known_missing(buffer + 2) && pack_lookup(buffer + 2) == NULL
+                && gen_find(buffer + 2) == NULL
+                && (compressed_path(buffer + 2, compressed, sizeof(compressed)) != 0 || metacache_is_known_missing(compressed))) {
+                send_error_packet(server_sockfd, &cliaddr, FileNotFound, get_error_message(FileNotFound), NULL);
                 continue;
             }
 
-            // Extraction du nom de fichier
-            size_t filename_length = strlen(buffer + 2);
-            strcpy(client->request.filename, buffer + 2);
-            if (filename_length == 0) {
-                // Gestion de l'erreur : Nom de fichier vide
-                printf("Client[%d] : Erreur! Nom de fichier vide.\n",client->sockfd);
-                // Envoyer un paquet d'erreur au client
-                send_error_packet(client->sockfd,&client->addr,NotDefined,get_error_message(NotDefined),"Nom de fichier vide");
-                delete_client(newsockfd);
+            // Capacité atteinte (ou requêtes déjà en attente) : la requête attend son tour dans la file
+            if ((ntohs(request_opcode) == TFTP_OPCODE_RRQ || ntohs(request_opcode) == TFTP_OPCODE_WRQ)
+                && (admit_queued() > 0 || !admit_available())) {
+                PROBE3(request_accept, ntohs(request_opcode), buffer + 2, 1);
+                queue_request(buffer, bytes_received, &cliaddr, len);
                 continue;
             }
+            PROBE3(request_accept, ntohs(request_opcode), buffer + 2, 0);
+            admit_count_direct();
+            start_session(buffer, bytes_received, &cliaddr, len);
+        }
 
-            // Extraction du mode de transfert
-            size_t mode_offset = 2 + filename_length + 1; // Offset pour accéder au début du mode
-            size_t mode_length = strlen(buffer + mode_offset);
-
-            strcpy(client->request.mode, buffer + mode_offset);
-            if (mode_length == 0 || (strcasecmp(client->request.mode, "netascii") != 0 && strcasecmp(client->request.mode, "octet") != 0) ) {
-                // Gestion de l'erreur : Mode de transfert non reconnu
-                printf("Erreur: Mode de transfert non reconnu.\n");
-                send_error_packet(client->sockfd,&client->addr,NotDefined,get_error_message(NotDefined),"Mode de transfert non reconnu");
-                delete_client(newsockfd);
+        // Check if any clients are responding
+        // Le parcours commence à une position différente à chaque itération : les petits
+        // descripteurs ne sont pas toujours servis en premier
+        int span = maxfd - server_sockfd;
+        scan_start = span > 0 ? (scan_start + 1) % span : 0;
+        for (int k = 0; k < span; ++k) {
+            int i = server_sockfd + 1 + (scan_start + k) % span;
+            McastGroup* group = mcast_find_by_fd(i);
+            if (group != NULL && FD_ISSET(i, &tmpfds)) {
+                len = sizeof(cliaddr);
+                int bytes_received = recvfrom(i, buffer, MAX_PACKET_SIZE, 0, (struct sockaddr *)&cliaddr, &len);
+                if (bytes_received >= 0) {
+                    mcast_handle_packet(group, buffer, bytes_received, &cliaddr);
+                }
                 continue;
             }
 
-            // RRQ | WRQ
-            selectedHandler(client);
-        }
+            // Socket de nouveau inscriptible : envoyer ce qui avait été différé
+            if (clients[i] != NULL && clients[i]->blocked && FD_ISSET(i, &tmpwfds)) {
+                flush_session(clients[i]);
+            }
 
-        // Check if any clients are responding
-        for (int i = server_sockfd + 1; i <= maxfd; ++i) {
             if (clients[i] != NULL && FD_ISSET(i, &tmpfds)) {
 
-                // int bytes_received = recvfrom(i, (char *)clients[i]->buffer, MAX_PACKET_SIZE, 0, (struct sockaddr *)&clients[i]->addr, &clients[i]->len);
-                int bytes_received = recvfrom(i, (char *)clients[i]->buffer, MAX_PACKET_SIZE, 0, (struct sockaddr *)&cliaddr, &len);
+                // Tampon de la taille de bloc maximale : un bloc plus grand que la taille négociée est détecté
+                uint32_t drops = clients[i]->rx_drops;
+                len = sizeof(cliaddr);
+                int bytes_received = recv_packet(i, buffer, TFTP_MAX_PACKET_SIZE, &cliaddr, &len, &drops);
+                count_rx_drops(&clients[i]->rx_drops, drops);
                 if (bytes_received == -1) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                        continue;
+                    }
                     perror("Erreur lors de la réception des données du client");
                     // Gérer l'erreur (par exemple, fermer la connexion avec le client)
                     continue;
                 }
 
-                if (clients[i]->addr.sin_addr.s_addr != cliaddr.sin_addr.s_addr || clients[i]->addr.sin_port != cliaddr.sin_port){
+                if (!sockaddr_equal(&clients[i]->addr, &cliaddr)){
                     send_error_packet(server_sockfd, &cliaddr,UnknownTransferID,get_error_message(UnknownTransferID),NULL);
                     continue;
                 }
@@ -218,8 +871,11 @@ int main() {
                 
                 // verifier le code operation du packet recu
                 uint16_t opcode;
-                memcpy(&opcode, clients[i]->buffer, sizeof(uint16_t));
+                memcpy(&opcode, buffer, sizeof(uint16_t));
                 opcode = ntohs(opcode);
+                if (opcode == TFTP_OPCODE_ACK || opcode == TFTP_OPCODE_DATA) {
+                    prof_add(PROF_ACK, clock_now() - clients[i]->last_sent_time);
+                }
 
                 if (opcode == TFTP_OPCODE_ACK){
                     
@@ -227,36 +883,45 @@ int main() {
                     
                     if (bytes_received >= 4) {
                         uint16_t block_number;
-                        memcpy(&block_number, clients[i]->buffer + 2, sizeof(uint16_t));
+                        memcpy(&block_number, buffer + 2, sizeof(uint16_t));
                         block_number = ntohs(block_number);
 
                         
-                        // Vérifiez si le numéro de bloc correspond au numéro attendu
-                        if (block_number == clients[i]->block_number) {
-                            // printf("[OLD] Client[%d] (bloc_num : %d) : \n",i, clients[i]->sockfd, clients[i]->block_number);
+                        // Vérifiez si le numéro de bloc correspond à un bloc envoyé
+                        unsigned long acked = clients[i]->acked_seq;
+                        if (clients[i]->oack_pending && block_number == 0) {
+                            // Options acceptées par le client : début du transfert
+                            flight_record(&clients[i]->flight, FLIGHT_ACK, 0, 0);
+                            clients[i]->oack_pending = 0;
+                            send_next_block(clients[i]);
+                        } else if (!clients[i]->oack_pending && handle_data_ack(clients[i], block_number)) {
+                            flight_record(&clients[i]->flight, FLIGHT_ACK, block_number, (uint32_t) (clients[i]->acked_seq - acked));
+                            PROBE4(ack_receive, clients[i]->id, block_number, clients[i]->acked_seq - acked,
+                                   clock_now() - clients[i]->window[clients[i]->acked_seq % clients[i]->window_size].sent_time);
                             
-                            if (clients[i]->buffer_size < MAX_DATA_SIZE){
-                                stop_file_session(clients[i]->request.filename,READ_MODE,&fileArray);
-                                size_in_bytes = ftell(clients[i]->file_fd);
+                            if (clients[i]->eof && clients[i]->acked_seq == clients[i]->read_seq){
+                                size_in_bytes = clients[i]->bytes_transferred;
                                 size_in_kb = size_in_bytes / 1024;
                                 size_in_mb = size_in_bytes / (1024 * 1024);
-                                printf("Client[%d] ^_^ Transmission terminée avec succès, total: %ld Mo (%ld Ko)\n",i, size_in_mb, size_in_kb);
+                                printf("Client[%d] ^_^ Transmission terminée avec succès, total: %lld Mo (%lld Ko)\n",i, size_in_mb, size_in_kb);
                                 delete_client(i);
                                 continue;
                             }
 
-                            clients[i]->block_number++;
-                            clients[i]->buffer_size = fread(clients[i]->buffer, 1, sizeof(clients[i]->buffer), clients[i]->file_fd);
-                            // Envoyer le paquet de données au client
-                            send_data_packet(clients[i]->sockfd, &clients[i]->addr, clients[i]->block_number, clients[i]->buffer,  clients[i]->buffer_size);
-                            clients[i]->last_action_type = DATA_PACKET;
-                            gettimeofday(&(clients[i]->last_sent_time), NULL);
+                            // Envoyer les paquets de données suivants au client
+                            send_next_block(clients[i]);
                             // printf("last_sent_time: %ld seconds, %ld microseconds\n", clients[i]->last_sent_time.tv_sec, clients[i]->last_sent_time.tv_usec);
 
 
+                        } else if (clients[i]->window_size > 1 && !clients[i]->oack_pending
+                                   && block_number == tftp_block_number(clients[i]->acked_seq, clients[i]->rollover)) {
+                            // ACK répété (RFC 7440) : le client a perdu le bloc suivant, renvoyer la fenêtre
+                            flight_record(&clients[i]->flight, FLIGHT_REPEATED_ACK, block_number, 0);
+                            handle_repeated_ack(clients[i]);
                         } else {
                             // Gérer le cas où un ACK incorrect est reçu
-                            printf("Client[%d] : ACK incorrect reçu pour le bloc %d (attendu: %d)\n",i, block_number, clients[i]->block_number);
+                            flight_record(&clients[i]->flight, FLIGHT_BAD_ACK, block_number, 0);
+                            printf("Client[%d] : ACK incorrect reçu pour le bloc %d (attendu: %d)\n",i, block_number, tftp_block_number(clients[i]->next_seq - 1, clients[i]->rollover));
                         }
                     } else {
                         // le cas où le paquet ACK reçu est trop court pour contenir le numéro de bloc
@@ -270,74 +935,90 @@ int main() {
 
                     // continuer un WRQ
 
+                    int data_size = bytes_received - TFTP_HEADER_SIZE;
+                    if (data_size < 0 || data_size > clients[i]->block_size) {
+                        // Bloc tronqué, ou plus grand que la taille de bloc négociée
+                        send_error_packet(clients[i]->sockfd,&clients[i]->addr,IllegalOperation,get_error_message(IllegalOperation),NULL);
+                        upload_abort(clients[i]->request.filename, clients[i]->upload);
+                                delete_client(i);
+                        continue;
+                    }
+
                     uint16_t block_number;
-                    memcpy(&block_number, clients[i]->buffer + 2, sizeof(uint16_t));
+                    memcpy(&block_number, buffer + 2, sizeof(uint16_t));
                     block_number = ntohs(block_number);
-
-                    
-                    if (block_number == clients[i]->block_number){
-                        size_t bytesWritten = fwrite(clients[i]->buffer + TFTP_HEADER_SIZE, 1, bytes_received - TFTP_HEADER_SIZE, clients[i]->file_fd);
-                        
-                        if ((int) bytesWritten < bytes_received - TFTP_HEADER_SIZE) {
+                    flight_record(&clients[i]->flight, FLIGHT_RECEIVE, block_number, (uint32_t) data_size);
+                    PROBE3(data_receive, clients[i]->id, block_number, data_size);
+
+                    // Écart avec le dernier bloc reçu, selon la numérotation après le bloc 65535 (option rollover)
+                    unsigned long advance = tftp_block_advance(block_number, clients[i]->acked_seq, clients[i]->rollover);
+                    if (advance == 1){
+                        clients[i]->oack_pending = 0; // le bloc 1 acquitte l'OACK
+                        // Dernier bloc : CR en attente et tampons vidés avant l'ACK final, une erreur
+                        // (disque plein) est signalée au client au lieu d'un succès
+                        if (write_block(clients[i], buffer + TFTP_HEADER_SIZE, data_size) != 0
+                            || (data_size < clients[i]->block_size && finish_write(clients[i]) != 0)) {
                             printf("Erreur lors de l'écriture dans le fichier\n");
                             // Envoi d'un paquet d'erreur au client
                             send_error_packet(clients[i]->sockfd,&clients[i]->addr,DiskFullOrAllocationExceeded,get_error_message(DiskFullOrAllocationExceeded),NULL);
-                            remove_tempfile(clients[i]->request.filename);
-                            delete_client(i);
-                            exit(EXIT_FAILURE);
+                            upload_abort(clients[i]->request.filename, clients[i]->upload);
+                                        delete_client(i);
+                            continue;
                         }
                         
-                        send_ack_packet(clients[i]->sockfd,&clients[i]->addr,clients[i]->block_number);
-                        clients[i]->last_action_type = ACK_PACKET;
-                        gettimeofday(&(clients[i]->last_sent_time), NULL);
-                    } else if(block_number == clients[i]->block_number-1) {
-                        send_ack_packet(clients[i]->sockfd,&clients[i]->addr,clients[i]->block_number);
-                        clients[i]->last_action_type = ACK_PACKET;
-                        gettimeofday(&(clients[i]->last_sent_time), NULL);
+                        clients[i]->acked_seq++;
+
+                        // Dernier bloc : fichier publié sous son nom (remplace atomiquement l'ancien)
+                        // avant l'ACK final, un échec est signalé au client au lieu d'un succès
+                        if (data_size < clients[i]->block_size) {
+                            if (upload_commit(clients[i]->file_fd, clients[i]->request.filename, clients[i]->upload) != 0) {
+                                perror("Erreur lors de la publication du fichier reçu");
+                                uint16_t code = (errno == ENOSPC || errno == EDQUOT) ? DiskFullOrAllocationExceeded : AccessViolation;
+                                send_error_packet(clients[i]->sockfd,&clients[i]->addr,code,get_error_message(code),NULL);
+                                upload_abort(clients[i]->request.filename, clients[i]->upload);
+                                                delete_client(i);
+                                continue;
+                            }
+                            clients[i]->upload = UPLOAD_NONE;
+                            publish_digest(clients[i]);
+                            metacache_invalidate(clients[i]->request.filename);
+                            cache_invalidate_file(clients[i]->request.filename);
+                        }
+                        send_ack(clients[i], block_number);
+                    } else if (advance == 0 && !clients[i]->oack_pending) {
+                        // Bloc déjà reçu : notre ACK a été perdu
+                        send_ack(clients[i], clients[i]->ack_block);
+                        continue;
                     } else {
                         send_error_packet(clients[i]->sockfd,&clients[i]->addr,NotDefined,get_error_message(NotDefined),NULL);
-                        remove_tempfile(clients[i]->request.filename);
+                        upload_abort(clients[i]->request.filename, clients[i]->upload);
                         delete_client(i);
                         continue;
                     }
                     
 
-                    if (bytes_received < MAX_PACKET_SIZE){
-                        // c'est le dernier packet
-
-                        // Supprimer l'ancien fichier
-                        if (access(clients[i]->request.filename, F_OK) != -1) {
-                            // printf("Le fichier existe.\n");
-                            if (remove(clients[i]->request.filename) != 0) {
-                                perror("Erreur lors de la suppression de l'ancien fichier");
-                            }
-                        }
-
-                        // Renommer le fichier temporaire en cas de succès
-                        if (rename(get_temp_file_name(clients[i]->request.filename), clients[i]->request.filename) != 0) {
-                            perror("Erreur lors du renommage du fichier temporaire");
-                        }
-
-                        remove_tempfile(clients[i]->request.filename);
-                        
-                        stop_file_session(clients[i]->request.filename,WRITE_MODE,&fileArray);
-                        size_in_bytes = ftell(clients[i]->file_fd);
+                    if (data_size < clients[i]->block_size){
+                        // c'est le dernier packet (déjà écrit, publié et acquitté)
+                                size_in_bytes = clients[i]->bytes_transferred;
                         size_in_kb = size_in_bytes / 1024;
                         size_in_mb = size_in_bytes / (1024 * 1024);
 
-                        printf("Client[%d] ^_^ Réception terminée avec succès. total: %ld Mo (%ld Ko)\n",i, size_in_mb, size_in_kb);
+                        printf("Client[%d] ^_^ Réception terminée avec succès. total: %lld Mo (%lld Ko)\n",i, size_in_mb, size_in_kb);
                         delete_client(i);
                         continue;
                     }
-
-                    clients[i]->block_number++;
                 } else if (opcode == TFTP_OPCODE_ERR){
-                    remove_tempfile(clients[i]->request.filename);
+                    uint16_t code = 0;
+                    if (bytes_received >= 4) {
+                        memcpy(&code, buffer + 2, sizeof(uint16_t));
+                    }
+                    flight_record(&clients[i]->flight, FLIGHT_ERROR, ntohs(code), 0);
+                    upload_abort(clients[i]->request.filename, clients[i]->upload);
                     delete_client(i);
                     continue;
                 }else {
                     send_error_packet(clients[i]->sockfd,&clients[i]->addr,IllegalOperation,get_error_message(IllegalOperation),NULL);
-                    remove_tempfile(clients[i]->request.filename);
+                    upload_abort(clients[i]->request.filename, clients[i]->upload);
                     delete_client(i);
                     continue;
                 }
@@ -353,44 +1034,305 @@ int main() {
 
 
 /**
- * Ajoute un nouveau client au serveur.
+ * Crée la session d'une requête reçue sur le port principal et la confie au gestionnaire RRQ ou WRQ.
  * 
- * Cette fonction ajoute un nouveau client au serveur en associant son descripteur de fichier à la structure
- * ClientInfo correspondante, en l'ajoutant au set de descripteurs de fichiers à surveiller et en mettant à
- * jour la valeur de maxfd si nécessaire.
+ * Appelée à la réception de la requête, ou plus tard lorsque le contrôle d'admission la sort de
+ * la file d'attente.
  * 
- * @param client Un pointeur vers la structure ClientInfo représentant le nouveau client.
- * @param sockfd Le descripteur de fichier associé au nouveau client.
+ * @param packet Le datagramme reçu (terminé par '\0').
+ * @param length La taille du datagramme.
+ * @param addr L'adresse du client.
+ * @param addr_len La taille de l'adresse.
  */
-void add_client(ClientInfo *client, int sockfd) {
-        clients[sockfd] = client;
-        
-        FD_SET(sockfd, &readfds);// Add the new socket to the set of sockets to monitor
-        if (sockfd > maxfd) {
-            maxfd = sockfd;
+void start_session(const char *packet, int length, const struct sockaddr_storage *addr, socklen_t addr_len) {
+    int64_t parse_start = prof_begin();
+    int newsockfd = createUDPSocket(NULL,0); // Create a new socket with ephemeral port for responding to client
+    if (newsockfd < 0 || newsockfd >= FD_SETSIZE) {
+        // Plus de descripteur (ou descripteur hors de portée de select) : refus immédiat, sans session
+        if (newsockfd >= 0) {
+            close(newsockfd);
+        } else {
+            perror("socket creation failed");
         }
-        num_clients++;
-        // printf("Client[%d] Ajouté\n",sockfd);
-}
+        reject_request(addr);
+        return;
+    }
 
+    ClientInfo* client = (ClientInfo *)malloc(sizeof(ClientInfo));
+    initialize_Client(client);
 
+    // ajouet le client
+    add_client(client,newsockfd);
 
+    client->sockfd = newsockfd;
+    memcpy(&client->addr,addr,sizeof(client->addr));
+    client->len = addr_len;
+    pace_session_init(&client->pacer, addr);
+    
+
+    // remplissage et verification des info
+
+    memcpy(&client->request.opcode, packet, sizeof(uint16_t));
+    flight_record(&client->flight, FLIGHT_REQUEST, ntohs(client->request.opcode), 0);
+    TFTP_HandlerFunction selectedHandler = NULL;
+
+    // Gestion de la demande en fonction de l'opcode
+    if (ntohs(client->request.opcode) == TFTP_OPCODE_RRQ) {
+        selectedHandler = handle_new_read_request;
+    } else if (ntohs(client->request.opcode) == TFTP_OPCODE_WRQ) {
+        selectedHandler = handle_new_write_request;
+    } else {
+        // Opcode non pris en charge, envoi d'un paquet d'erreur au client
+        send_error_packet(client->sockfd,&client->addr,NotDefined,get_error_message(NotDefined),"Opcode non pris en charge");
+        delete_client(newsockfd);
+        return;
+    }
+
+    // Extraction du nom de fichier
+    size_t filename_length = strlen(packet + 2);
+    if (filename_length >= sizeof(client->request.filename)) {
+        send_error_packet(client->sockfd,&client->addr,NotDefined,get_error_message(NotDefined),"Nom de fichier trop long");
+        delete_client(newsockfd);
+        return;
+    }
+    strcpy(client->request.filename, packet + 2);
+    if (filename_length == 0) {
+        // Gestion de l'erreur : Nom de fichier vide
+        printf("Client[%d] : Erreur! Nom de fichier vide.\n",client->sockfd);
+        // Envoyer un paquet d'erreur au client
+        send_error_packet(client->sockfd,&client->addr,NotDefined,get_error_message(NotDefined),"Nom de fichier vide");
+        delete_client(newsockfd);
+        return;
+    }
+
+    // Extraction du mode de transfert
+    size_t mode_offset = 2 + filename_length + 1; // Offset pour accéder au début du mode
+    size_t mode_length = mode_offset < (size_t) length ? strlen(packet + mode_offset) : 0;
+
+    if (mode_length == 0 || mode_length >= sizeof(client->request.mode)) {
+        mode_length = 0;
+    } else {
+        strcpy(client->request.mode, packet + mode_offset);
+    }
+    if (mode_length == 0 || (strcasecmp(client->request.mode, "netascii") != 0 && strcasecmp(client->request.mode, "octet") != 0) ) {
+        // Gestion de l'erreur : Mode de transfert non reconnu
+        printf("Erreur: Mode de transfert non reconnu.\n");
+        send_error_packet(client->sockfd,&client->addr,NotDefined,get_error_message(NotDefined),"Mode de transfert non reconnu");
+        delete_client(newsockfd);
+        return;
+    }
+
+    // Extraction des options (RFC 2347)
+    parse_request_options(packet, length, mode_offset + mode_length + 1, &client->request);
+
+    // RRQ | WRQ
+    prof_end(PROF_PARSE, parse_start);
+    PROBE3(session_start, client->id, ntohs(client->request.opcode), (const char *) client->request.filename);
+    selectedHandler(client);
+
+    // Fichier ouvert par la session (elle a pu se terminer aussitôt : erreur, fichier vide...)
+    if (clients[newsockfd] == client && (client->file_fd != NULL || client->fanout != NULL || client->zst != NULL)) {
+        client->admit_files = 1;
+        admit_acquire(0, 0, 1);
+    }
+}
+
+
+
+
+
+/**
+ * Remplace, dans une requête RRQ ou WRQ, le nom du fichier par son chemin normalisé.
+ * 
+ * Le mode et les options sont décalés d'autant : contrôle d'accès, caches, file d'attente
+ * et session voient tous la même écriture du chemin ("./a//b" et "a/b" désignent le même fichier).
+ * 
+ * @param packet Le datagramme reçu (terminé par '\0'), modifié sur place.
+ * @param length La taille du datagramme, mise à jour.
+ * @return 0 en cas de succès, -1 si le chemin est refusé (absolu, segment "..", trop long).
+ */
+int normalize_request(char *packet, int *length) {
+    char normalized[sizeof(((TFTP_Request *)0)->filename)];
+    size_t name_length = strlen(packet + 2);
+
+    if (tftp_normalize_path(packet + 2, normalized, sizeof(normalized)) != 0) {
+        return -1;
+    }
+    size_t normalized_length = strlen(normalized);
+    if (normalized_length < name_length) {
+        // Reste du datagramme, '\0' final compris
+        memmove(packet + 2 + normalized_length, packet + 2 + name_length, (size_t) *length + 1 - 2 - name_length);
+        *length -= (int) (name_length - normalized_length);
+    }
+    memcpy(packet + 2, normalized, normalized_length);
+    return 0;
+}
+
+
+
+
+
+/**
+ * Met en file d'attente une requête arrivée alors que la capacité du serveur est atteinte.
+ * 
+ * Les petits fichiers passent en premier : leur taille est connue par le pack ou le cache
+ * des métadonnées. La requête refusée (la nouvelle, ou celle qu'elle évince) reçoit
+ * aussitôt une erreur.
+ * 
+ * @param packet Le datagramme reçu (terminé par '\0').
+ * @param length La taille du datagramme.
+ * @param addr L'adresse du client.
+ * @param addr_len La taille de l'adresse.
+ */
+void queue_request(const char *packet, int length, const struct sockaddr_storage *addr, socklen_t addr_len) {
+    AdmitRequest evicted;
+    uint16_t opcode;
+    long size = -1;
+
+    memcpy(&opcode, packet, sizeof(uint16_t));
+    if (ntohs(opcode) == TFTP_OPCODE_RRQ) {
+        size = request_size(packet + 2);
+    }
+
+    int result = admit_enqueue(packet, length, addr, addr_len, size, &evicted);
+    if (result == ADMIT_EVICTED) {
+        reject_request(&evicted.addr);
+    } else if (result == ADMIT_REFUSED) {
+        reject_request(addr);
+    }
+}
+
+
+
+
+
+/**
+ * Refuse une requête faute de capacité, depuis le port principal (aucune session n'est créée).
+ * 
+ * TFTP n'a pas de code d'erreur « occupé » : le message indique au client de réessayer.
+ * 
+ * @param addr L'adresse du client.
+ */
+void reject_request(const struct sockaddr_storage *addr) {
+    struct sockaddr_storage dest;
+
+    memcpy(&dest, addr, sizeof(dest));
+    send_error_packet(server_sockfd, &dest, NotDefined, get_error_message(NotDefined), "Serveur surchargé, réessayez plus tard");
+}
+
+
+
+
+
+/**
+ * Sert les requêtes en attente tant que la capacité le permet, et refuse celles qui ont trop attendu.
+ */
+void dispatch_queued_requests(void) {
+    AdmitRequest request;
+    int result;
+
+    while ((result = admit_next(clock_now(), &request)) != ADMIT_NONE) {
+        if (result == ADMIT_EXPIRED) {
+            reject_request(&request.addr);
+        } else {
+            start_session(request.packet, request.length, &request.addr, request.addr_len);
+        }
+    }
+}
+
+
+
+
+
+/**
+ * Retourne la taille d'un fichier demandé, sans l'ouvrir (pack ou cache des métadonnées).
+ * 
+ * @param filename Le fichier demandé.
+ * @return La taille en octets, ou -1 si elle est inconnue.
+ */
+long request_size(const char *filename) {
+    MetaEntry meta;
+
+    if (strlen(filename) >= sizeof(((TFTP_Request *)0)->filename)) {
+        return -1;
+    }
+    const PackEntry* packed = pack_lookup(filename);
+    if (packed != NULL) {
+        return (long) packed->size;
+    }
+    metacache_lookup(filename, &meta);
+    return meta.exists ? (long) meta.st.st_size : -1;
+}
+
+
+
+
+
+/**
+ * Ajoute un nouveau client au serveur.
+ * 
+ * Cette fonction ajoute un nouveau client au serveur en associant son descripteur de fichier à la structure
+ * ClientInfo correspondante, en l'ajoutant au set de descripteurs de fichiers à surveiller et en mettant à
+ * jour la valeur de maxfd si nécessaire.
+ * 
+ * @param client Un pointeur vers la structure ClientInfo représentant le nouveau client.
+ * @param sockfd Le descripteur de fichier associé au nouveau client.
+ */
+void add_client(ClientInfo *client, int sockfd) {
+        clients[sockfd] = client;
+        
+        FD_SET(sockfd, &readfds);// Add the new socket to the set of sockets to monitor
+        if (sockfd > maxfd) {
+            maxfd = sockfd;
+        }
+        num_clients++;
+        client->id = next_session_id++;
+        admit_acquire(1, 0, 0);
+        // printf("Client[%d] Ajouté\n",sockfd);
+}
+
+
+
+
+/**
+ * Supprime un client du serveur.
+ * 
+ * Cette fonction supprime un client du serveur en retirant son descripteur de fichier du
+ * set de descripteurs de fichiers à surveiller, en fermant le socket du client, en terminant sa
+ * session de fichier (sync.c) s'il en a une et en libérant la mémoire allouée pour la structure
+ * ClientInfo correspondante.
+ * 
+ * @param sockfd Le descripteur de fichier du client à supprimer.
+ */
+void delete_client(int sockfd) {
+        char label[FLIGHT_LABEL_LENGTH];
+        ClientInfo *client = clients[sockfd];
+
+        // Journal de bord conservé pour les diagnostics après la fin de la session
+        flight_record(&client->flight, FLIGHT_END, (uint32_t) (client->bytes_transferred / 1024), 0);
+        snprintf(label, sizeof(label), "session %lu | %s | %s | fd %d | %lld octets", client->id,
+                 ntohs(client->request.opcode) == TFTP_OPCODE_WRQ ? "WRQ" : "RRQ", client->request.filename,
+                 sockfd, (long long) client->bytes_transferred);
+        flight_retire(&client->flight, label);
+        PROBE3(session_end, client->id, (long long) client->bytes_transferred, clock_now() - client->started);
 
-/**
- * Supprime un client du serveur.
- * 
- * Cette fonction supprime un client du serveur en retirant son descripteur de fichier du
- * set de descripteurs de fichiers à surveiller, en fermant le socket du client et en libérant
- * la mémoire allouée pour la structure ClientInfo correspondante.
- * 
- * @param sockfd Le descripteur de fichier du client à supprimer.
- */
-void delete_client(int sockfd) {
         FD_CLR(sockfd, &readfds); // Retirer le socket du set de sockets à surveiller
+        FD_CLR(sockfd, &writefds);
         close(sockfd); // Fermer le socket du client
         if (clients[sockfd]->file_fd !=NULL){
             fclose(clients[sockfd]->file_fd);
         }
+        // Verrou du fichier libéré ici, quelle que soit la fin de la session (succès, erreur, abandon)
+        if (clients[sockfd]->file_session) {
+            stop_file_session(clients[sockfd]->request.filename, clients[sockfd]->file_mode, &fileArray);
+        }
+        sched_dequeue(sockfd);
+        free(clients[sockfd]->window);
+        free(clients[sockfd]->window_data);
+        cache_release(clients[sockfd]->cache_entry);
+        fanout_close(clients[sockfd]->fanout);
+        zst_close(clients[sockfd]->zst);
+        admit_release(1, clients[sockfd]->admit_bytes, clients[sockfd]->admit_files);
         free(clients[sockfd]);
         clients[sockfd] = NULL;
         maxfd--;
@@ -421,7 +1363,49 @@ void handle_new_read_request(ClientInfo *client) {
 
     printf("New Client[%d] | %s | %s | %s\n",client->sockfd,"RRQ",client->request.filename,client->request.mode);
 
-    if (access(client->request.filename, F_OK) == -1) {
+    // Fichier présent dans le pack : servi depuis la projection mémoire, sans appel système
+    const PackEntry* packed = pack_lookup(client->request.filename);
+    if (packed != NULL) {
+        client->netascii = strcasecmp(client->request.mode, "netascii") == 0;
+        client->mem_data = packed->data;
+        client->mem_len = packed->size;
+        client->mem_translate = client->netascii;
+        sched_set_size(client->sockfd, client->mem_len);
+        maxfd++;
+        start_read_transfer(client);
+        return;
+    }
+
+    // Fichier généré à la demande : servi depuis le cache comme un fichier statique
+    const GenRule* rule = gen_find(client->request.filename);
+    if (rule != NULL) {
+        client->cache_entry = gen_produce(rule, client->request.filename, &client->addr);
+        if (client->cache_entry == NULL) {
+            printf("Client[%d] : generation failed\n",client->sockfd);
+            send_error_packet(client->sockfd,&client->addr,NotDefined,"Generation failed",NULL);
+            delete_client(client->sockfd);
+            return;
+        }
+        client->netascii = strcasecmp(client->request.mode, "netascii") == 0;
+        client->mem_data = client->cache_entry->data;
+        client->mem_len = client->cache_entry->len;
+        client->mem_translate = client->netascii;
+        sched_set_size(client->sockfd, client->mem_len);
+        maxfd++;
+        start_read_transfer(client);
+        return;
+    }
+
+    // Existence, droits et métadonnées, depuis le cache si possible
+    MetaEntry meta;
+    int64_t lookup_start = prof_begin();
+    metacache_lookup(client->request.filename, &meta);
+    prof_end(PROF_LOOKUP, lookup_start);
+
+    if (!meta.exists) {
+        if (start_compressed_read(client)) {
+            return;
+        }
         printf("Client[%d] : file Not Found\n",client->sockfd);
         send_error_packet(client->sockfd,&client->addr,FileNotFound,get_error_message(FileNotFound),NULL);
         delete_client(client->sockfd);
@@ -429,27 +1413,46 @@ void handle_new_read_request(ClientInfo *client) {
     } 
 
 
-    if (access(client->request.filename, R_OK ) == -1) {
+    if (!meta.readable) {
         printf("Client[%d] : Permission denied reading\n",client->sockfd);
         send_error_packet(client->sockfd,&client->addr,AccessViolation,get_error_message(AccessViolation),NULL);
         delete_client(client->sockfd);
         return;
     }
 
+    // Apprendre l'enchaînement des fichiers du client et précharger le suivant probable
+    const char* predicted = prefetch_record_request(&client->addr, client->request.filename);
+    if (predicted != NULL) {
+        printf("Client[%d] : préchargement de %s\n", client->sockfd, predicted);
+    }
+
+    // Option multicast (RFC 2090) : le fichier est diffusé une seule fois à tous les clients du groupe
+    // Les groupes sont IPv4 : un client IPv4 arrivé sur le socket double pile est repris sous sa forme IPv4
+    struct sockaddr_storage mcast_addr = client->addr;
+    if (get_request_option(&client->request, "multicast") != NULL && strcasecmp(client->request.mode, "octet") == 0
+        && sockaddr_unmap(&mcast_addr)) {
+        if (mcast_join(client->request.filename, &mcast_addr) == 0) {
+            printf("Client[%d] : transfert confié au groupe multicast\n", client->sockfd);
+            delete_client(client->sockfd);
+            return;
+        }
+        // Groupe indisponible : transfert unicast classique (option ignorée)
+    }
+
     if (start_file_session(client->request.filename,READ_MODE,&fileArray) !=0) {
         printf("Client[%d] : Error! The file is currently being accessed by another client.\n", client->sockfd);
         send_error_packet(client->sockfd,&client->addr,NotDefined,"The file is currently in use !",NULL);
         delete_client(client->sockfd);
         return;
     }
+    client->file_session = 1;
+    client->file_mode = READ_MODE;
     
 
     // Vérifier le mode de transfert (netascii ou octet)
     if (strcasecmp(client->request.mode, "netascii") == 0 ) {
-        client->file_fd = fopen(client->request.filename, "r");
-    } else if (strcasecmp(client->request.mode, "octet") == 0) {
-       client->file_fd = fopen(client->request.filename, "rb");
-    } else {
+        client->netascii = 1;
+    } else if (strcasecmp(client->request.mode, "octet") != 0) {
         // Mode de transfert non pris en charge, envoyer un paquet d'erreur au client
         send_error_packet(client->sockfd,&client->addr,IllegalOperation,get_error_message(IllegalOperation),NULL);
         printf("Client[%d] : Mode de transfert non pris en charge",client->sockfd);
@@ -457,20 +1460,122 @@ void handle_new_read_request(ClientInfo *client) {
         return;
     }
 
-    if (client->file_fd == NULL) {
-        // En cas d'erreur lors de l'ouverture du fichier, envoyer un paquet d'erreur au client
-        send_error_packet(client->sockfd,&client->addr,NotDefined,get_error_message(NotDefined),NULL);
-        perror("Erreur lors de l'ouverture du fichier en lecture");
-        delete_client(client->sockfd);
-        return;
+    // Contenu déjà en cache (préchargé, ou converti en netascii) : le fichier n'est pas ouvert
+    char key[CACHE_KEY_LENGTH];
+    if (client->netascii) {
+        snprintf(key, sizeof(key), "netascii:%s", client->request.filename);
+    } else {
+        warm_cache_key(key, client->request.filename);
     }
+    client->cache_entry = cache_lookup(key, &meta.st);
+
+    if (client->cache_entry == NULL) {
+        int64_t open_start = prof_begin();
+        client->file_fd = fopen(client->request.filename, "rb");
+        prof_end(PROF_OPEN, open_start);
+        if (client->file_fd == NULL) {
+            // En cas d'erreur lors de l'ouverture du fichier, envoyer un paquet d'erreur au client
+            send_error_packet(client->sockfd,&client->addr,NotDefined,get_error_message(NotDefined),NULL);
+            perror("Erreur lors de l'ouverture du fichier en lecture");
+            delete_client(client->sockfd);
+            return;
+        }
+
+        if (client->netascii) {
+            // Convertir une seule fois les petits fichiers en netascii et garder le résultat en cache
+            if (meta.st.st_size <= NETASCII_CACHE_MAX_FILE) {
+                size_t len;
+                char* data = netascii_encode_file(client->file_fd, &len);
+                if (data != NULL) {
+                    client->cache_entry = cache_insert(key, &meta.st, data, len);
+                }
+                rewind(client->file_fd);
+            }
+            if (client->cache_entry != NULL) {
+                fclose(client->file_fd);
+                client->file_fd = NULL;
+            } else {
+                prefetch_sequential(client->file_fd);
+            }
+        } else {
+            // Lecture partagée avec les autres sessions du même fichier
+            client->fanout = fanout_open(client->request.filename);
+        }
+    }
+
+    if (client->cache_entry != NULL) {
+        client->mem_data = client->cache_entry->data;
+        client->mem_len = client->cache_entry->len;
+    }
+    sched_set_size(client->sockfd, meta.st.st_size);
     maxfd++;
 
-    client->buffer_size = fread(client->buffer, 1, MAX_DATA_SIZE, client->file_fd);
-    send_data_packet(client->sockfd, &client->addr, client->block_number, client->buffer, client->buffer_size);
-    client->last_action_type = DATA_PACKET;
-    gettimeofday(&(client->last_sent_time), NULL);
-    // printf("data %d sent taille %d\n",client->block_number,client->buffer_size);
+    start_read_transfer(client);
+}
+
+
+
+
+
+/**
+ * Construit le chemin de la version compressée d'un fichier.
+ * 
+ * @param filename Le chemin demandé.
+ * @param path Le tampon recevant le chemin compressé.
+ * @param size La taille du tampon.
+ * @return 0 en cas de succès, -1 si le chemin est trop long.
+ */
+int compressed_path(const char *filename, char *path, size_t size) {
+    return snprintf(path, size, "%s%s", filename, ZST_SUFFIX) < (int) size ? 0 : -1;
+}
+
+
+
+
+
+/**
+ * Sert la version compressée (nom.zst) d'un fichier absent, décompressée à la volée.
+ * 
+ * Seul le mode octet est pris en charge. Les trames décompressées sont mises en cache : les
+ * lecteurs suivants du même fichier ne paient pas la décompression.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ * @return 1 si la demande a été traitée (transfert démarré ou erreur envoyée), 0 si aucune version compressée n'est disponible.
+ */
+int start_compressed_read(ClientInfo *client) {
+    char path[sizeof(client->request.filename)];
+    MetaEntry meta;
+
+    if (strcasecmp(client->request.mode, "octet") != 0 || compressed_path(client->request.filename, path, sizeof(path)) != 0) {
+        return 0;
+    }
+    int64_t lookup_start = prof_begin();
+    metacache_lookup(path, &meta);
+    prof_end(PROF_LOOKUP, lookup_start);
+    if (!meta.exists || !meta.readable) {
+        return 0;
+    }
+    int64_t open_start = prof_begin();
+    client->zst = zst_open(path, &meta.st);
+    prof_end(PROF_OPEN, open_start);
+    if (client->zst == NULL) {
+        return 0;
+    }
+
+    if (start_file_session(client->request.filename,READ_MODE,&fileArray) !=0) {
+        printf("Client[%d] : Error! The file is currently being accessed by another client.\n", client->sockfd);
+        send_error_packet(client->sockfd,&client->addr,NotDefined,"The file is currently in use !",NULL);
+        delete_client(client->sockfd);
+        return 1;
+    }
+    client->file_session = 1;
+    client->file_mode = READ_MODE;
+    printf("Client[%d] : servi depuis %s (%llu octets décompressés)\n", client->sockfd, path, client->zst->size);
+
+    sched_set_size(client->sockfd, client->zst->size);
+    maxfd++;
+    start_read_transfer(client);
+    return 1;
 }
 
 
@@ -504,24 +1609,26 @@ void handle_new_write_request(ClientInfo *client) {
         delete_client(client->sockfd);
         return;
     }
+    client->file_session = 1;
+    client->file_mode = WRITE_MODE;
     
 
 
-    char* temp_filename = get_temp_file_name(client->request.filename);
     // Vérifier le mode de transfert (netascii ou octet)
     if (strcasecmp(client->request.mode, "netascii") == 0 ) {
-        client->file_fd = fopen(temp_filename, "w");
-    } else if (strcasecmp(client->request.mode, "octet") == 0) {
-       client->file_fd = fopen(temp_filename, "wb");
-    } else {
+        client->netascii = 1;
+    } else if (strcasecmp(client->request.mode, "octet") != 0) {
         // Mode de transfert non pris en charge, envoyer un paquet d'erreur au client
         send_error_packet(client->sockfd,&client->addr,IllegalOperation,get_error_message(IllegalOperation),NULL);
         printf("Client[%d] : Mode de transfert non pris en charge",client->sockfd);
         delete_client(client->sockfd);
         return;
     }
-    free(temp_filename);
 
+    // Fichier anonyme dans le répertoire de destination, nommé seulement à la fin de la réception
+    int64_t open_start = prof_begin();
+    client->file_fd = upload_open(client->request.filename, &client->upload);
+    prof_end(PROF_OPEN, open_start);
     if (client->file_fd == NULL) {
         // En cas d'erreur lors de l'ouverture du fichier, envoyer un paquet d'erreur au client
         send_error_packet(client->sockfd,&client->addr,NotDefined,get_error_message(NotDefined),NULL);
@@ -529,15 +1636,663 @@ void handle_new_write_request(ClientInfo *client) {
         delete_client(client->sockfd);
         return;
     }
+    negotiate_options(client, 0);
+    client->admit_bytes = client->block_size;
+    admit_acquire(0, client->admit_bytes, 0);
 
     
     maxfd++;    
    
-    // Envoie un paquet d'acquittement pour confirmer le début de la transmission
-    send_ack_packet(client->sockfd,&client->addr,client->block_number);
+    // Confirme le début de la transmission : OACK si des options sont acceptées, sinon ACK du bloc 0
+    if (client->num_oack > 0) {
+        client->oack_pending = 1;
+        send_session_oack(client);
+        return;
+    }
+    send_ack(client, 0);
+}
+
+
+
+
+
+/**
+ * Lit le prochain bloc de données à envoyer au client.
+ * 
+ * Les données proviennent de la mémoire (cache ou pack) si le contenu y est disponible, sinon de l'anneau
+ * partagé par les sessions du même fichier ou du fichier lui-même (avec conversion
+ * netascii à la volée si nécessaire).
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ * @param out Le tampon recevant le bloc (client->block_size octets).
+ * @return Le nombre d'octets lus (inférieur à client->block_size pour le dernier bloc).
+ */
+int read_next_block(ClientInfo *client, char *out) {
+    int64_t start = prof_begin();
+    size_t block_size = client->block_size;
+    size_t n;
+
+    if (client->mem_data != NULL) {
+        size_t remaining = client->mem_len - client->mem_offset;
+        if (client->mem_translate) {
+            size_t consumed;
+            n = netascii_encode(&client->encoder, client->mem_data + client->mem_offset, remaining, &consumed, out, block_size);
+            client->mem_offset += consumed;
+        } else {
+            n = remaining < block_size ? remaining : block_size;
+            memcpy(out, client->mem_data + client->mem_offset, n);
+            client->mem_offset += n;
+        }
+    } else if (client->zst != NULL) {
+        long decoded = zst_read(client->zst, client->file_offset, out, block_size);
+        n = decoded > 0 ? (size_t) decoded : 0;
+        client->file_offset += n;
+    } else if (client->netascii) {
+        n = netascii_read(&client->encoder, client->file_fd, out, block_size);
+    } else {
+        long shared = -1;
+        if (client->fanout != NULL) {
+            shared = fanout_read(client->fanout, client->file_offset, out, block_size);
+        }
+        if (shared >= 0) {
+            n = (size_t) shared;
+        } else {
+            // Pas de lecture partagée, ou session trop lente sortie de l'anneau
+            fseeko(client->file_fd, client->file_offset, SEEK_SET);
+            n = fread(out, 1, block_size, client->file_fd);
+        }
+        client->file_offset += n;
+    }
+
+    client->bytes_transferred += n;
+    prof_end(PROF_READ, start);
+    return (int) n;
+}
+
+
+
+
+
+/**
+ * Démarre l'envoi d'un fichier : négocie les options (taille de bloc, fenêtre, rollover) puis
+ * envoie l'OACK, ou directement les premiers blocs si aucune option n'est acceptée.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ */
+void start_read_transfer(ClientInfo *client) {
+    negotiate_options(client, 1);
+
+    int window = client->window_size;
+    client->window = malloc(window * sizeof(WindowBlock));
+    client->window_data = malloc((size_t) window * client->block_size);
+    if (client->window == NULL || client->window_data == NULL) {
+        send_error_packet(client->sockfd,&client->addr,NotDefined,get_error_message(NotDefined),NULL);
+        delete_client(client->sockfd);
+        return;
+    }
+    for (int i = 0; i < window; ++i) {
+        client->window[i].data = client->window_data + (size_t) i * client->block_size;
+    }
+    cc_init(&client->cc, window);
+    client->admit_bytes = (long) window * client->block_size;
+    admit_acquire(0, client->admit_bytes, 0);
+
+    if (client->num_oack > 0) {
+        client->oack_pending = 1;
+        send_session_oack(client);
+        return;
+    }
+    send_next_block(client);
+}
+
+
+
+
+
+/**
+ * Négocie les options de la requête (RFC 2347) : blksize (RFC 2348), windowsize (RFC 7440,
+ * lecture seulement) et rollover. Les options acceptées sont préparées pour l'OACK ; une
+ * valeur invalide fait ignorer l'option.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ * @param allow_window 1 si l'option windowsize est prise en charge (RRQ), 0 sinon.
+ */
+void negotiate_options(ClientInfo *client, int allow_window) {
+    const char *value = get_request_option(&client->request, "blksize");
+    if (value != NULL && atoi(value) >= TFTP_MIN_BLKSIZE) {
+        // Valeur trop grande : la plus grande taille possible est proposée à la place
+        client->block_size = atoi(value) < TFTP_MAX_BLKSIZE ? atoi(value) : TFTP_MAX_BLKSIZE;
+        accept_option(client, "blksize", client->block_size);
+    }
+
+    value = get_request_option(&client->request, "windowsize");
+    if (allow_window && value != NULL && atoi(value) >= 1) {
+        client->window_size = atoi(value) < TFTP_MAX_WINDOW ? atoi(value) : TFTP_MAX_WINDOW;
+        accept_option(client, "windowsize", client->window_size);
+        // Rafales GSO : chaque segment doit tenir dans la MTU du chemin
+        client->max_datagram = client->window_size > 1 ? sockaddr_max_datagram(&client->addr) : 0;
+    }
+
+    value = get_request_option(&client->request, "rollover");
+    if (value != NULL && (strcmp(value, "0") == 0 || strcmp(value, "1") == 0)) {
+        client->rollover = atoi(value);
+        accept_option(client, "rollover", client->rollover);
+    }
+}
+
+
+
+
+
+/**
+ * Ajoute une option acceptée à l'OACK de la session.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ * @param name Le nom de l'option.
+ * @param value La valeur retenue.
+ */
+void accept_option(ClientInfo *client, const char *name, int value) {
+    TFTP_Option *option = &client->oack[client->num_oack++];
+
+    strcpy(option->name, name);
+    snprintf(option->value, sizeof(option->value), "%d", value);
+}
+
+
+
+
+
+/**
+ * Lit les blocs suivants du fichier jusqu'à remplir la fenêtre (blocs lus et non acquittés).
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ */
+void fill_window(ClientInfo *client) {
+    while (!client->eof && client->read_seq - client->acked_seq < (unsigned long) client->window_size) {
+        WindowBlock *slot = &client->window[(client->read_seq + 1) % client->window_size];
+        slot->size = read_next_block(client, slot->data);
+        slot->sent_time = 0;
+        slot->retransmitted = 0;
+        client->read_seq++;
+        if (slot->size < client->block_size) {
+            client->eof = 1;
+        }
+    }
+}
+
+
+
+
+
+/**
+ * Retourne le nombre de blocs lus qui n'ont pas encore été envoyés.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ * @return Le nombre de blocs en attente d'envoi.
+ */
+unsigned long unsent_blocks(ClientInfo *client) {
+    if (client->oack_pending || client->next_seq > client->read_seq) {
+        return 0;
+    }
+    return client->read_seq + 1 - client->next_seq;
+}
+
+
+
+
+
+/**
+ * Traite l'ACK d'un bloc de données : avance la fenêtre et informe le contrôle de congestion.
+ * 
+ * Un ACK du dernier bloc envoyé acquitte toute la fenêtre ; un ACK antérieur signale
+ * que le client a perdu les blocs suivants, qui seront renvoyés.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ * @param block_number Le numéro de bloc acquitté (sur 16 bits, voir l'option rollover).
+ * @return 1 si l'ACK porte sur un bloc envoyé et non encore acquitté, 0 sinon.
+ */
+int handle_data_ack(ClientInfo *client, uint16_t block_number) {
+    unsigned long advance = tftp_block_advance(block_number, client->acked_seq, client->rollover);
+    unsigned long sent = client->next_seq - 1 - client->acked_seq;
+
+    if (advance == 0 || advance > sent) {
+        return 0;
+    }
+
+    unsigned long seq = client->acked_seq + advance;
+    WindowBlock *slot = &client->window[seq % client->window_size];
+    client->acked_seq = seq;
+    client->retries = 0;
+
+    if (client->window_size > 1) {
+        if (seq == client->next_seq - 1) {
+            // Algorithme de Karn : pas de mesure sur un bloc renvoyé
+            long rtt_us = slot->retransmitted ? 0 : (long) ((clock_now() - slot->sent_time) / CLOCK_NS_PER_US);
+            cc_on_ack(&client->cc, (int) advance, rtt_us);
+        } else {
+            cc_on_loss(&client->cc);
+            client->next_seq = seq + 1;
+        }
+    }
+    return 1;
+}
+
+
+
+
+
+/**
+ * Traite un ACK répétant le dernier bloc acquitté : renvoie la fenêtre depuis le bloc suivant.
+ * 
+ * Les blocs envoyés après une perte provoquent chacun un ACK répété ; seul le premier
+ * déclenche le renvoi, les suivants arrivant moins d'un RTT après lui sont ignorés.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ */
+void handle_repeated_ack(ClientInfo *client) {
+    WindowBlock *slot = &client->window[(client->acked_seq + 1) % client->window_size];
+
+    if (client->next_seq == client->acked_seq + 1) {
+        return; // renvoi déjà prévu
+    }
+    if (clock_now() - slot->sent_time < client->cc.srtt_us * CLOCK_NS_PER_US) {
+        return; // renvoi déjà en route
+    }
+    cc_on_loss(&client->cc);
+    client->next_seq = client->acked_seq + 1;
+    PROBE4(retransmit, client->id, tftp_block_number(client->next_seq, client->rollover), client->retries, PROBE_RETRANSMIT_REPEATED_ACK);
+    send_next_block(client);
+}
+
+
+
+
+
+/**
+ * Lit les prochains blocs du fichier et les envoie au client, dans la limite de la fenêtre.
+ * 
+ * Si d'autres sessions attendent déjà leur tour, ou si la régulation de débit ou le contrôle
+ * de congestion ne le permettent pas encore, les blocs restent en attente et seront envoyés
+ * par send_scheduled_blocks().
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ */
+void send_next_block(ClientInfo *client) {
+    fill_window(client);
+    if (!client->blocked && sched_queued() == 0) {
+        send_pending_blocks(client, clock_now(), TFTP_MAX_WINDOW);
+    }
+    if (!client->blocked && unsent_blocks(client) > 0) {
+        sched_enqueue(client->sockfd, client->block_size + TFTP_HEADER_SIZE);
+    }
+}
+
+
+
+
+
+/**
+ * Envoie l'ACK d'un bloc reçu (WRQ) ; si le socket est plein, l'ACK part dès qu'il redevient inscriptible.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ * @param block_number Le numéro du bloc acquitté.
+ */
+void send_ack(ClientInfo *client, uint16_t block_number) {
+    client->ack_block = block_number;
     client->last_action_type = ACK_PACKET;
-    gettimeofday(&(client->last_sent_time), NULL);
-    client->block_number = 1;
+    client->last_sent_time = clock_now();
+    flight_record(&client->flight, FLIGHT_SEND_ACK, block_number, 0);
+    int64_t start = prof_begin();
+    int result = send_ack_packet(client->sockfd, &client->addr, block_number);
+    prof_end(PROF_SEND, start);
+    if (result != 0 && send_would_block()) {
+        defer_session(client);
+    }
+}
+
+
+
+
+
+/**
+ * Envoie l'OACK des options acceptées ; si le socket est plein, l'OACK part dès qu'il redevient inscriptible.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ */
+void send_session_oack(ClientInfo *client) {
+    client->last_action_type = OACK_PACKET;
+    client->last_sent_time = clock_now();
+    flight_record(&client->flight, FLIGHT_OACK, (uint32_t) client->block_size, (uint32_t) client->window_size);
+    int64_t start = prof_begin();
+    int result = send_oack_packet(client->sockfd, &client->addr, client->oack, client->num_oack);
+    prof_end(PROF_SEND, start);
+    if (result != 0 && send_would_block()) {
+        defer_session(client);
+    }
+}
+
+
+
+
+
+/**
+ * Met une session en attente de place dans son socket (EAGAIN ou ENOBUFS au dernier envoi).
+ * 
+ * La session quitte l'ordonnanceur : ses blocs non envoyés restent dans la fenêtre et
+ * partiront avec flush_session() quand select signalera le socket inscriptible. Sans
+ * IP_RECVERR, Linux ne remonte pas ENOBUFS sur UDP : seul EAGAIN se produit en pratique.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ */
+void defer_session(ClientInfo *client) {
+    deferred_sends++;
+    if (client->blocked) {
+        return;
+    }
+    client->blocked = 1;
+    FD_SET(client->sockfd, &writefds);
+    sched_dequeue(client->sockfd);
+}
+
+
+
+
+
+/**
+ * Envoie ce qui a été différé par defer_session() : l'ACK ou l'OACK en attente, sinon les blocs de la fenêtre.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ */
+void flush_session(ClientInfo *client) {
+    flight_record(&client->flight, FLIGHT_FLUSH, 0, 0);
+    client->blocked = 0;
+    FD_CLR(client->sockfd, &writefds);
+    if (client->last_action_type == ACK_PACKET) {
+        send_ack(client, client->ack_block);
+    } else if (client->last_action_type == OACK_PACKET && client->oack_pending) {
+        send_session_oack(client);
+    } else {
+        send_next_block(client);
+    }
+}
+
+
+
+
+
+/**
+ * Ajoute aux statistiques les datagrammes perdus en réception depuis la dernière lecture du compteur d'un socket.
+ * 
+ * @param seen La dernière valeur lue du compteur cumulé du socket (mise à jour).
+ * @param drops La valeur courante du compteur (SO_RXQ_OVFL).
+ */
+void count_rx_drops(uint32_t *seen, uint32_t drops) {
+    rx_dropped += (uint32_t) (drops - *seen);
+    *seen = drops;
+}
+
+
+
+
+
+/**
+ * Envoie les blocs en attente du client que le contrôle de congestion et les jetons
+ * (de la session et du serveur) autorisent.
+ * 
+ * Plusieurs blocs autorisés ensemble partent en un seul appel système (send_data_burst) ;
+ * si la segmentation UDP n'est pas disponible, ou si un paquet ne tient pas dans la MTU du
+ * chemin (grande taille de bloc), ils sont envoyés un par un.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ * @param now La date courante (ns, voir clock_now).
+ * @param max_blocks Le nombre maximal de blocs à envoyer.
+ * @return Le nombre de blocs envoyés ; si des blocs restent en attente, client->send_at
+ *         indique quand réessayer.
+ */
+int send_pending_blocks(ClientInfo *client, int64_t now, int max_blocks) {
+    uint16_t blocks[TFTP_MAX_WINDOW];
+    char *data[TFTP_MAX_WINDOW];
+    size_t sizes[TFTP_MAX_WINDOW];
+    int max_burst = TFTP_MAX_BURST_BYTES / (client->block_size + TFTP_HEADER_SIZE);
+    int count = 0;
+    int sent;
+
+    // Les grands blocs partent en rafales plus courtes (au moins un bloc)
+    if (max_burst < 1) {
+        max_burst = 1;
+    }
+    if (max_burst < max_blocks) {
+        max_blocks = max_burst;
+    }
+    client->send_at = 0;
+    while (count < max_blocks && count < TFTP_MAX_WINDOW && (unsigned long) count < unsent_blocks(client)) {
+        WindowBlock *slot = &client->window[(client->next_seq + count) % client->window_size];
+        int64_t wait = client->window_size > 1 ? cc_send_delay(&client->cc, now) : 0;
+
+        if (wait <= 0) {
+            wait = pace_consume(&client->pacer, slot->size + TFTP_HEADER_SIZE, now);
+        }
+        if (wait > 0) {
+            client->send_at = now + wait;
+            break;
+        }
+
+        if (client->window_size > 1) {
+            cc_on_send(&client->cc);
+        }
+        blocks[count] = tftp_block_number(client->next_seq + count, client->rollover);
+        data[count] = slot->data;
+        sizes[count] = slot->size;
+        count++;
+        if (slot->size < client->block_size) {
+            break; // un bloc incomplet doit être le dernier segment de la rafale
+        }
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    // Socket plein : les blocs non envoyés restent dans la fenêtre (une erreur d'une autre
+    // nature perd le paquet, comme le réseau, et la retransmission s'en charge)
+    int64_t start = prof_begin();
+    sent = count;
+    int burst = count > 1 && client->block_size + TFTP_HEADER_SIZE <= client->max_datagram;
+    if (burst && send_data_burst(client->sockfd, &client->addr, blocks, data, sizes, count) == 0) {
+        // rafale envoyée en un appel
+    } else if (burst && send_would_block()) {
+        sent = 0;
+    } else {
+        for (sent = 0; sent < count; ++sent) {
+            if (send_data_packet(client->sockfd, &client->addr, blocks[sent], data[sent], sizes[sent]) != 0
+                && send_would_block()) {
+                break;
+            }
+        }
+    }
+    prof_end(PROF_SEND, start);
+    if (sent > 0) {
+        flight_record(&client->flight, FLIGHT_DATA, (uint32_t) client->next_seq, (uint32_t) sent);
+    }
+
+    for (int i = 0; i < sent; ++i) {
+        WindowBlock *slot = &client->window[client->next_seq % client->window_size];
+        PROBE4(data_send, client->id, blocks[i], slot->size, slot->sent_time != 0);
+        if (slot->sent_time != 0) {
+            slot->retransmitted = 1;
+        }
+        slot->sent_time = now;
+        client->next_seq++;
+    }
+    if (sent < count) {
+        if (client->window_size > 1) {
+            client->cc.credits += count - sent; // crédits rendus pour les blocs non envoyés
+        }
+        flight_record(&client->flight, FLIGHT_DEFER, (uint32_t) (count - sent), 0);
+        defer_session(client);
+    }
+    if (sent == 0) {
+        return 0;
+    }
+    client->last_action_type = DATA_PACKET;
+    client->last_sent_time = now;
+    return sent;
+}
+
+
+
+
+
+/**
+ * Envoie les blocs en attente, dans l'ordre choisi par l'ordonnanceur (deficit round robin).
+ * 
+ * Chaque session est servie à hauteur du budget que lui donne son poids ; une session dont
+ * l'envoi est retardé par la régulation ou le contrôle de congestion cède son tour. On
+ * s'arrête lorsque aucune session en attente ne peut plus envoyer.
+ * 
+ * @return Le délai en nanosecondes jusqu'à la prochaine échéance, ou -1 si aucun bloc n'attend.
+ */
+int64_t send_scheduled_blocks(void) {
+    int64_t now = clock_now();
+    int64_t next = -1;
+    int blocked = 0;
+
+    while (sched_queued() > 0 && blocked < sched_queued()) {
+        int fd = sched_next();
+        ClientInfo *client = clients[fd];
+        int sent = client->send_at <= now && send_pending_blocks(client, now, 1) > 0;
+
+        if (unsent_blocks(client) == 0 || client->blocked) {
+            sched_dequeue(fd);
+            blocked = 0;
+        } else if (!sent) {
+            sched_skip(fd);
+            blocked++;
+        } else {
+            blocked = 0;
+        }
+    }
+
+    for (int i = server_sockfd + 1; i <= maxfd; ++i) {
+        if (clients[i] != NULL && !clients[i]->blocked && unsent_blocks(clients[i]) > 0) {
+            int64_t wait = clients[i]->send_at - now;
+            if (wait < 0) {
+                wait = 0;
+            }
+            if (next < 0 || wait < next) {
+                next = wait;
+            }
+        }
+    }
+    return next;
+}
+
+
+
+
+
+/**
+ * Calcule la prochaine échéance de la boucle principale : retransmission d'un client,
+ * envoi retardé d'un bloc, retransmission multicast ou expiration d'une requête en file.
+ * 
+ * @param next_send Le délai avant le prochain envoi retardé (ns), ou -1 s'il n'y en a pas.
+ * @param next_mcast La prochaine échéance multicast (ns), ou 0 s'il n'y en a pas.
+ * @return L'échéance la plus proche (ns, horloge monotone), ou 0 s'il n'y en a aucune.
+ */
+int64_t next_timer_deadline(int64_t next_send, int64_t next_mcast) {
+    int64_t now = clock_now();
+    int64_t next = next_mcast;
+    int64_t queue_expiry = admit_deadline();
+
+    if (next_send >= 0 && (next == 0 || now + next_send < next)) {
+        next = now + next_send;
+    }
+    if (queue_expiry != 0 && (next == 0 || queue_expiry < next)) {
+        next = queue_expiry;
+    }
+    for (int i = server_sockfd + 1; i <= maxfd; ++i) {
+        // Les blocs pas encore envoyés sont couverts par next_send (sauf socket plein)
+        if (clients[i] != NULL && (unsent_blocks(clients[i]) == 0 || clients[i]->blocked)) {
+            int64_t deadline = clients[i]->last_sent_time + TIMEOUT_SEC * CLOCK_NS_PER_SEC;
+            if (next == 0 || deadline < next) {
+                next = deadline;
+            }
+        }
+    }
+    return next;
+}
+
+
+
+
+
+/**
+ * Écrit un bloc de données reçu du client dans le fichier temporaire.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ * @param data Les données reçues.
+ * @param size La taille des données.
+ * @return 0 en cas de succès, -1 en cas d'erreur d'écriture.
+ */
+int write_block(ClientInfo *client, const char *data, size_t size) {
+    char decoded[TFTP_MAX_BLKSIZE + 1];
+    int64_t start = prof_begin();
+
+    if (client->netascii) {
+        size = netascii_decode(&client->decoder, data, size, decoded);
+        data = decoded;
+    }
+    if (fwrite(data, 1, size, client->file_fd) < size) {
+        return -1;
+    }
+    digest_update(&client->digest, data, size);
+    client->bytes_transferred += size;
+    prof_end(PROF_WRITE, start);
+    return 0;
+}
+
+
+
+
+
+/**
+ * Termine l'écriture du fichier temporaire (CR netascii en attente).
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client.
+ * @return 0 en cas de succès, -1 en cas d'erreur d'écriture.
+ */
+int finish_write(ClientInfo *client) {
+    char tail[1];
+
+    if (client->netascii && netascii_decode_flush(&client->decoder, tail) > 0) {
+        if (fwrite(tail, 1, 1, client->file_fd) < 1) {
+            return -1;
+        }
+        digest_update(&client->digest, tail, 1);
+        client->bytes_transferred++;
+    }
+    return fflush(client->file_fd) == 0 ? 0 : -1;
+}
+
+
+
+
+
+/**
+ * Termine le calcul des empreintes d'un fichier reçu, les journalise et dépose le fichier dans le dépôt.
+ * 
+ * Les empreintes sont calculées pendant la réception : le fichier n'est pas relu.
+ * 
+ * @param client Le pointeur vers la structure ClientInfo du client (fichier déjà publié).
+ */
+void publish_digest(ClientInfo *client) {
+    unsigned char sha256[DIGEST_SHA256_LENGTH];
+    char hex[DIGEST_HEX_LENGTH];
+
+    uint32_t crc = digest_final(&client->digest, sha256);
+    digest_hex(sha256, hex);
+    int stored = store_commit(client->request.filename, sha256, client->bytes_transferred);
+    printf("Client[%d] : sha256 %s crc32c %08x%s\n", client->sockfd, hex, (unsigned) crc,
+           stored == STORE_DEDUP ? " (dédupliqué)" : (stored == STORE_NEW ? " (ajouté au dépôt)" : ""));
 }
 
 
@@ -577,9 +2332,8 @@ void initialize_Client(ClientInfo* client) {
     client->sockfd = -1; // Initialize sockfd to -1 (invalid value)
     client->len = sizeof(client->addr); // Initialize len to the size of addr
     client->file_fd = NULL; // Initialize file_fd to NULL (no file open)
-    client->buffer_size = 0; // Initialize buffer_size to 0
-    client->block_number = 0; // Initialize block_number to 0
-    // Clear memory for sockaddr_in
+    client->upload = UPLOAD_NONE;
+    // Clear memory for sockaddr_storage
     memset(&client->addr, 0, sizeof(client->addr));
     // Clear memory for TFTP_Request
     memset(&client->request, 0, sizeof(client->request));
@@ -587,9 +2341,46 @@ void initialize_Client(ClientInfo* client) {
     client->request.opcode = 0; // Set opcode to 0
     strcpy(client->request.filename, ""); // Set filename to an empty string
     strcpy(client->request.mode, ""); // Set mode to an empty string
-    gettimeofday(&(client->last_sent_time), NULL);
+    client->last_sent_time = clock_now();
     client->retries = 0;
     client->last_action_type = (PacketType) NULL;
+    client->bytes_transferred = 0;
+    client->netascii = 0;
+    netascii_encoder_init(&client->encoder);
+    netascii_decoder_init(&client->decoder);
+    digest_init(&client->digest);
+    client->cache_entry = NULL;
+    client->mem_data = NULL;
+    client->mem_len = 0;
+    client->mem_offset = 0;
+    client->mem_translate = 0;
+    client->file_session = 0;
+    client->file_mode = READ_MODE;
+    client->fanout = NULL;
+    client->zst = NULL;
+    client->file_offset = 0;
+    client->send_at = 0;
+    client->window_size = 1;
+    client->window = NULL;
+    client->window_data = NULL;
+    client->block_size = MAX_DATA_SIZE;
+    client->max_datagram = 0;
+    client->rollover = default_rollover;
+    client->num_oack = 0;
+    client->read_seq = 0;
+    client->next_seq = 1;
+    client->acked_seq = 0;
+    client->eof = 0;
+    client->oack_pending = 0;
+    client->ack_block = 0;
+    client->blocked = 0;
+    client->rx_drops = 0;
+    client->admit_bytes = 0;
+    client->admit_files = 0;
+    cc_init(&client->cc, 1);
+    client->id = 0;
+    client->started = clock_now();
+    flight_init(&client->flight);
 
 }
 
@@ -606,35 +2397,47 @@ void initialize_Client(ClientInfo* client) {
  * Cette fonction est appelée périodiquement pour gérer les retransmissions en cas de délais d'attente expirés.
  */
 void check_timeouts_and_retransmit() {
-    struct timeval now;
-    gettimeofday(&now, NULL);
+    int64_t now = clock_now();
 
     for (int i = 0; i <= maxfd; ++i) {
-        if (clients[i] != NULL) {
-            double elapsed = elapsed_time(&(clients[i]->last_sent_time), &now);
-            if (elapsed >= TIMEOUT_SEC) {
+        // Des blocs retardés par la régulation n'ont pas encore été envoyés : rien à retransmettre
+        // (un socket resté plein depuis le dernier envoi expire comme une perte)
+        if (clients[i] != NULL && (unsent_blocks(clients[i]) == 0 || clients[i]->blocked)) {
+            if (now - clients[i]->last_sent_time >= TIMEOUT_SEC * CLOCK_NS_PER_SEC) {
+                prof_add(PROF_STALL, now - clients[i]->last_sent_time);
+                flight_record(&clients[i]->flight, FLIGHT_TIMEOUT, (uint32_t) clients[i]->retries + 1, (uint32_t) clients[i]->acked_seq);
                 // Retransmettre le dernier paquet envoyé
                 if (clients[i]->last_action_type == DATA_PACKET) {
-                    // Si le dernier paquet envoyé était un paquet de données, retransmettre ce paquet
-                    send_data_packet(clients[i]->sockfd, &(clients[i]->addr), clients[i]->block_number, clients[i]->buffer, clients[i]->buffer_size);
-                    printf("Client[%d] : Time Out ! retransmission DATA[%d]\n",i,clients[i]->block_number);
+                    // Si le dernier paquet envoyé était un paquet de données, retransmettre la fenêtre
+                    // depuis le premier bloc non acquitté
+                    if (clients[i]->window_size > 1) {
+                        cc_on_timeout(&clients[i]->cc);
+                    }
+                    clients[i]->next_seq = clients[i]->acked_seq + 1;
+                    PROBE4(retransmit, clients[i]->id, tftp_block_number(clients[i]->next_seq, clients[i]->rollover),
+                           clients[i]->retries + 1, PROBE_RETRANSMIT_TIMEOUT);
+                    printf("Client[%d] : Time Out ! retransmission DATA[%d]\n",i,tftp_block_number(clients[i]->next_seq, clients[i]->rollover));
+                    send_next_block(clients[i]);
+                } else if (clients[i]->last_action_type == OACK_PACKET) {
+                    PROBE4(retransmit, clients[i]->id, 0, clients[i]->retries + 1, PROBE_RETRANSMIT_TIMEOUT);
+                    send_session_oack(clients[i]);
+                    printf("Client[%d] : Time Out ! retransmission OACK\n",i);
                 } else if (clients[i]->last_action_type == ACK_PACKET) {
                     // Si le dernier paquet envoyé était un paquet d'acquittement, retransmettre ce paquet
-                    send_ack_packet(clients[i]->sockfd, &(clients[i]->addr), clients[i]->block_number);
-                    printf("Client[%d] : Time Out !  retransmission ACK[%d]\n",i,clients[i]->block_number);
+                    PROBE4(retransmit, clients[i]->id, clients[i]->ack_block, clients[i]->retries + 1, PROBE_RETRANSMIT_TIMEOUT);
+                    send_ack_packet(clients[i]->sockfd, &(clients[i]->addr), clients[i]->ack_block);
+                    printf("Client[%d] : Time Out !  retransmission ACK[%d]\n",i,clients[i]->ack_block);
                 }
             
-                gettimeofday(&(clients[i]->last_sent_time), NULL); // Mettre à jour le temps du dernier envoi
+                clients[i]->last_sent_time = now; // Mettre à jour le temps du dernier envoi
                 clients[i]->retries++; // Incrémenter le nombre de tentatives de retransmission
                 // Vérifier si le nombre de tentatives de retransmission a dépassé la limite
                 if (clients[i]->retries >= MAX_RETRIES) {
                     printf("Client[%d] Nombre maximum de tentatives atteint\n",i);
+                    PROBE3(timeout_abort, clients[i]->id, clients[i]->retries, (long long) clients[i]->bytes_transferred);
 
-                    if (clients[i]->last_action_type == DATA_PACKET) {
-                        stop_file_session(clients[i]->request.filename,READ_MODE,&fileArray);
-                    } else if (clients[i]->last_action_type == ACK_PACKET) {
-                        remove_tempfile(clients[i]->request.filename);
-                        stop_file_session(clients[i]->request.filename,WRITE_MODE,&fileArray);
+                    if (ntohs(clients[i]->request.opcode) == TFTP_OPCODE_WRQ) {
+                        upload_abort(clients[i]->request.filename, clients[i]->upload);
                     }
 
                     delete_client(clients[i]->sockfd); // Supprimer le client s'il a dépassé la limite de retransmissions
@@ -644,17 +2447,3 @@ void check_timeouts_and_retransmit() {
         }
     }
 }
-
-
-
-
-/**
- * Calcul du temps écoulé en secondes entre deux instants donnés.
- * 
- * @param start Pointeur vers la structure timeval représentant le début du laps de temps.
- * @param end Pointeur vers la structure timeval représentant la fin du laps de temps.
- * @return Le temps écoulé en secondes sous forme de double.
- */
-double elapsed_time(struct timeval *start, struct timeval *end) {
-    return (end->tv_sec - start->tv_sec) + (end->tv_usec - start->tv_usec) / 1000000.0;
-}
\ No newline at end of file
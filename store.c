@@ -0,0 +1,164 @@
+#include "store.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+
+
+// Répertoire du dépôt (vide : dépôt désactivé)
+static char root[STORE_MAX_PATH - DIGEST_HEX_LENGTH - 8];
+static StoreStats stats;
+
+
+
+/**
+ * \brief Configure le répertoire du dépôt (créé si nécessaire).
+ *
+ * \param dir Le répertoire.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int store_init(const char* dir) {
+    if (strlen(dir) >= sizeof(root)) {
+        printf("Dépôt : chemin %s trop long\n", dir);
+        return -1;
+    }
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        perror("Erreur lors de la création du dépôt");
+        return -1;
+    }
+    strcpy(root, dir);
+    printf("Dépôt : %s (empreintes %s)\n", root, digest_engine());
+    return 0;
+}
+
+
+
+/**
+ * \brief Crée dest avec le contenu de source, sans copie des données.
+ *
+ * Lien physique si possible ; sinon (autre système de fichiers) clone par FICLONE.
+ *
+ * \param source Le fichier existant.
+ * \param dest Le chemin à créer (ne doit pas exister).
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+static int share_file(const char* source, const char* dest) {
+    if (link(source, dest) == 0) {
+        return 0;
+    }
+    if (errno != EXDEV) {
+        return -1;
+    }
+
+    int in = open(source, O_RDONLY);
+    if (in < 0) {
+        return -1;
+    }
+    int out = open(dest, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    int result = out >= 0 ? ioctl(out, FICLONE, in) : -1;
+    if (out >= 0) {
+        close(out);
+    }
+    close(in);
+    if (result != 0 && out >= 0) {
+        unlink(dest);
+    }
+    return result != 0 ? -1 : 0;
+}
+
+
+
+/**
+ * \brief Remplace atomiquement target par un fichier partageant le contenu de source.
+ *
+ * \param source Le fichier dont le contenu est partagé.
+ * \param target Le chemin à remplacer.
+ * \return 0 en cas de succès, -1 en cas d'erreur (target intact).
+ */
+static int replace_with_shared(const char* source, const char* target) {
+    char staging[STORE_MAX_PATH + 8];
+
+    if (snprintf(staging, sizeof(staging), "%s.cas", target) >= (int) sizeof(staging)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    unlink(staging);
+    if (share_file(source, staging) != 0) {
+        return -1;
+    }
+    if (rename(staging, target) != 0) {
+        unlink(staging);
+        return -1;
+    }
+    return 0;
+}
+
+
+
+/**
+ * \brief Dépose un fichier reçu dans le dépôt, ou le remplace par l'objet existant de même contenu.
+ *
+ * \param path Le fichier reçu, déjà publié sous son nom définitif.
+ * \param sha256 L'empreinte SHA-256 de son contenu.
+ * \param size Sa taille.
+ * \return STORE_DISABLED, STORE_NEW ou STORE_DEDUP, ou -1 en cas d'erreur (le fichier reste intact).
+ */
+int store_commit(const char* path, const unsigned char sha256[DIGEST_SHA256_LENGTH], off_t size) {
+    char hex[DIGEST_HEX_LENGTH];
+    char object[STORE_MAX_PATH];
+    struct stat object_st;
+    struct stat path_st;
+
+    stats.hashed++;
+    stats.bytes_hashed += size;
+    if (root[0] == '\0' || size == 0) {
+        return STORE_DISABLED;
+    }
+
+    // Objets répartis en 256 sous-répertoires selon le premier octet de l'empreinte
+    digest_hex(sha256, hex);
+    snprintf(object, sizeof(object), "%s/%.2s", root, hex);
+    if (mkdir(object, 0755) != 0 && errno != EEXIST) {
+        perror("Erreur lors de la création d'un répertoire du dépôt");
+        stats.errors++;
+        return -1;
+    }
+    snprintf(object, sizeof(object), "%s/%.2s/%s", root, hex, hex);
+
+    if (stat(object, &object_st) == 0 && object_st.st_size == size) {
+        if (stat(path, &path_st) == 0 && path_st.st_dev == object_st.st_dev && path_st.st_ino == object_st.st_ino) {
+            return STORE_DEDUP;
+        }
+        if (replace_with_shared(object, path) != 0) {
+            perror("Erreur lors de la déduplication");
+            stats.errors++;
+            return -1;
+        }
+        stats.deduplicated++;
+        stats.bytes_saved += size;
+        return STORE_DEDUP;
+    }
+
+    // Contenu inédit (ou objet tronqué) : le fichier reçu devient l'objet du dépôt
+    if (replace_with_shared(path, object) != 0) {
+        perror("Erreur lors de l'ajout au dépôt");
+        stats.errors++;
+        return -1;
+    }
+    stats.stored++;
+    return STORE_NEW;
+}
+
+
+
+/**
+ * \brief Retourne les compteurs du dépôt.
+ *
+ * \return Les compteurs.
+ */
+StoreStats store_get_stats(void) {
+    return stats;
+}
@@ -0,0 +1,71 @@
+/*
+   Dépôt adressé par contenu des fichiers reçus (déduplication) - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "digest.h"
+
+#ifndef STORE
+#define STORE
+
+
+#define STORE_MAX_PATH 512 // Longueur maximale du chemin d'un objet du dépôt
+
+// Résultat de store_commit
+#define STORE_DISABLED 0 // Aucun dépôt configuré : le fichier est seulement haché
+#define STORE_NEW 1 // Contenu inédit, ajouté au dépôt
+#define STORE_DEDUP 2 // Contenu déjà présent : le fichier partage désormais l'objet du dépôt
+
+
+// Compteurs du dépôt
+typedef struct {
+    unsigned long hashed; // Fichiers reçus hachés
+    unsigned long long bytes_hashed; // Octets hachés
+    unsigned long stored; // Objets ajoutés au dépôt
+    unsigned long deduplicated; // Fichiers remplacés par un objet existant
+    unsigned long long bytes_saved; // Octets non dupliqués sur disque
+    unsigned long errors; // Fichiers non déposés (erreur d'entrée/sortie)
+} StoreStats;
+
+
+
+/**
+ * \brief Configure le répertoire du dépôt (créé si nécessaire).
+ *
+ * \param dir Le répertoire.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int store_init(const char* dir);
+
+
+
+/**
+ * \brief Dépose un fichier reçu dans le dépôt, ou le remplace par l'objet existant de même contenu.
+ *
+ * Les objets sont nommés par leur empreinte SHA-256 (dépôt/ab/abcdef...). Le fichier et
+ * l'objet partagent le même inode (lien physique), ou les mêmes extents (reflink) si le
+ * dépôt est sur un autre système de fichiers. Le serveur remplace toujours un fichier par
+ * renommage, jamais en place : un objet partagé n'est donc jamais modifié.
+ *
+ * \param path Le fichier reçu, déjà publié sous son nom définitif.
+ * \param sha256 L'empreinte SHA-256 de son contenu.
+ * \param size Sa taille.
+ * \return STORE_DISABLED, STORE_NEW ou STORE_DEDUP, ou -1 en cas d'erreur (le fichier reste intact).
+ */
+int store_commit(const char* path, const unsigned char sha256[DIGEST_SHA256_LENGTH], off_t size);
+
+
+
+/**
+ * \brief Retourne les compteurs du dépôt.
+ *
+ * \return Les compteurs.
+ */
+StoreStats store_get_stats(void);
+
+#endif
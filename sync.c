@@ -1,4 +1,5 @@
 #include "sync.h"
+#include "probe.h"
 #define SYNC
 
 
@@ -161,6 +162,7 @@ int start_file_session(const char* filename, int mode, ServerFileArray* serverFi
         if (serverFile->num_lecteur == 0){
             if (pthread_mutex_trylock(&(serverFile->mutex)) != 0) {
                 // Si le verrouillage du mutex échoue, retourner -1 (erreur)
+                PROBE3(file_contention, filename, mode, serverFile->num_lecteur);
                 return -1;
             }
         }
@@ -172,7 +174,7 @@ int start_file_session(const char* filename, int mode, ServerFileArray* serverFi
         // Si le mode est écriture, tenter de verrouiller le mutex
         if (serverFile->num_lecteur > 0 || pthread_mutex_trylock(&(serverFile->mutex)) != 0) {
             // Si le verrouillage du mutex échoue, retourner -1 (erreur)
-            // printf("verro echec");
+            PROBE3(file_contention, filename, mode, serverFile->num_lecteur);
             return -1;
         } else {
             return 0; // Succès
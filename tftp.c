@@ -1,6 +1,10 @@
 #include "tftp.h"
 // #define TFTP_TYPES
 
+#include <errno.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+
 
 // Tableau de messages d'erreur correspondant aux codes d'erreur TFTP
 const char* TFTPErrorMessages[NUM_TFTP_ERRORS] = {
@@ -28,17 +32,114 @@ const char* TFTPErrorMessages[NUM_TFTP_ERRORS] = {
  * \param block_number Le numéro de bloc du paquet de données.
  * \param data Les données à inclure dans le paquet.
  * \param data_size La taille des données.
+ * \return 0 en cas de succès, -1 en cas d'échec (voir send_would_block).
  */
-void send_data_packet(int sockfd, struct sockaddr_in* client_addr, uint16_t block_number, char *data, size_t data_size) {
-    TFTP_DataPacket packet;
-    packet.opcode = htons(TFTP_OPCODE_DATA); // Opcode 3 pour un paquet de données
-    packet.block_number = htons(block_number); // Numéro de bloc (convertis en réseau)
-    memcpy(packet.data, data, data_size); // Copier les données dans le paquet
-    ssize_t bytes_sent = sendto(sockfd, &packet, data_size + TFTP_HEADER_SIZE, 0, (struct sockaddr *)client_addr, sizeof(*client_addr));
+int send_data_packet(int sockfd, struct sockaddr_storage* client_addr, uint16_t block_number, char *data, size_t data_size) {
+    uint16_t header[2] = { htons(TFTP_OPCODE_DATA), htons(block_number) };
+    struct iovec iov[2] = { { header, TFTP_HEADER_SIZE }, { data, data_size } };
+    struct msghdr msg;
+
+    // En-tête et données envoyés sans copie, quelle que soit la taille de bloc négociée
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = client_addr;
+    msg.msg_namelen = sockaddr_length(client_addr);
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    ssize_t bytes_sent = sendmsg(sockfd, &msg, 0);
     if (bytes_sent == -1) {
-        perror("Erreur lors de l'envoi du paquet de données");
-        exit(EXIT_FAILURE);
+        if (!send_would_block()) {
+            perror("Erreur lors de l'envoi du paquet de données");
+        }
+        return -1;
     }
+    return 0;
+}
+
+
+
+/**
+ * \brief Envoie plusieurs paquets de données consécutifs en un seul appel système.
+ * 
+ * Les paquets sont placés bout à bout dans un tampon envoyé avec UDP_SEGMENT (GSO) :
+ * le noyau les découpe en datagrammes de la taille du premier. Tous les blocs doivent
+ * donc être complets, sauf le dernier, et tenir ensemble dans TFTP_MAX_BURST_BYTES.
+ * 
+ * \param sockfd Le descripteur de socket.
+ * \param client_addr L'adresse du client.
+ * \param blocks Les numéros des blocs.
+ * \param data Les données des blocs.
+ * \param sizes Les tailles des blocs.
+ * \param count Le nombre de blocs (au plus TFTP_MAX_WINDOW).
+ * \return 0 si les paquets ont été envoyés, -1 sinon : file d'émission pleine (voir
+ *         send_would_block), ou segmentation indisponible (les paquets doivent alors être
+ *         envoyés un par un).
+ */
+int send_data_burst(int sockfd, struct sockaddr_storage* client_addr, const uint16_t* blocks, char** data, const size_t* sizes, int count) {
+#ifdef UDP_SEGMENT
+    static int gso_disabled = 0;
+    static char buffer[TFTP_MAX_BURST_BYTES];
+    size_t offset = 0;
+
+    if (gso_disabled || count > TFTP_MAX_WINDOW || count * (sizes[0] + TFTP_HEADER_SIZE) > sizeof(buffer)) {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    for (int i = 0; i < count; ++i) {
+        uint16_t header[2] = { htons(TFTP_OPCODE_DATA), htons(blocks[i]) };
+        memcpy(buffer + offset, header, TFTP_HEADER_SIZE);
+        memcpy(buffer + offset + TFTP_HEADER_SIZE, data[i], sizes[i]);
+        offset += TFTP_HEADER_SIZE + sizes[i];
+    }
+
+    uint16_t segment_size = (uint16_t) (sizes[0] + TFTP_HEADER_SIZE);
+    char control[CMSG_SPACE(sizeof(uint16_t))];
+    struct iovec iov = { buffer, offset };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    memset(control, 0, sizeof(control));
+    msg.msg_name = client_addr;
+    msg.msg_namelen = sockaddr_length(client_addr);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_UDP;
+    cmsg->cmsg_type = UDP_SEGMENT;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(uint16_t));
+
+    if (sendmsg(sockfd, &msg, 0) >= 0) {
+        return 0;
+    }
+    if (errno == EINVAL) {
+        // Rafale refusée pour cette destination seulement (segment plus grand que la MTU...) :
+        // ces paquets partent un par un, la segmentation reste active pour les autres sessions
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    if (errno == EIO || errno == ENOPROTOOPT || errno == EOPNOTSUPP) {
+        // Noyau ou interface sans segmentation UDP : envoi paquet par paquet désormais
+        printf("GSO indisponible (%s), envoi paquet par paquet\n", strerror(errno));
+        gso_disabled = 1;
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    if (!send_would_block()) {
+        perror("Erreur lors de l'envoi des paquets de données");
+    }
+    return -1;
+#else
+    (void) sockfd;
+    (void) client_addr;
+    (void) blocks;
+    (void) data;
+    (void) sizes;
+    (void) count;
+    errno = EOPNOTSUPP;
+    return -1;
+#endif
 }
 
 
@@ -52,17 +153,21 @@ void send_data_packet(int sockfd, struct sockaddr_in* client_addr, uint16_t bloc
  * \param sockfd Le descripteur de socket.
  * \param client_addr L'adresse du client.
  * \param block_number Le numéro de bloc du paquet ACK.
+ * \return 0 en cas de succès, -1 en cas d'échec (voir send_would_block).
  */
-void send_ack_packet(int sockfd, struct sockaddr_in *client_addr, uint16_t block_number) {
+int send_ack_packet(int sockfd, struct sockaddr_storage *client_addr, uint16_t block_number) {
     TFTP_AckPacket ack_packet;
     ack_packet.opcode = htons(TFTP_OPCODE_ACK); // Opcode 4 pour un paquet ACK
     ack_packet.block_number = htons(block_number); // Numéro de bloc (converti en réseau)
 
-    ssize_t bytes_sent = sendto(sockfd, &ack_packet, sizeof(ack_packet), 0, (struct sockaddr *)client_addr, sizeof(*client_addr));
+    ssize_t bytes_sent = sendto(sockfd, &ack_packet, sizeof(ack_packet), 0, (struct sockaddr *)client_addr, sockaddr_length(client_addr));
     if (bytes_sent == -1) {
-        perror("Erreur lors de l'envoi du paquet ACK");
-        exit(EXIT_FAILURE);
+        if (!send_would_block()) {
+            perror("Erreur lors de l'envoi du paquet ACK");
+        }
+        return -1;
     }
+    return 0;
 }
 
 
@@ -81,7 +186,7 @@ void send_ack_packet(int sockfd, struct sockaddr_in *client_addr, uint16_t block
  * \param error_message Le message d'erreur.
  * \param additional_message Message supplémentaire optionnel.
  */
-void send_error_packet(int sockfd, struct sockaddr_in* client_addr, uint16_t errorCode, const char* error_message, const char* additional_message) {
+void send_error_packet(int sockfd, struct sockaddr_storage* client_addr, uint16_t errorCode, const char* error_message, const char* additional_message) {
     TFTP_ErrorPacket errPacket;
     errPacket.opcode = htons(TFTP_OPCODE_ERR);
     errPacket.err_code = htons(errorCode);
@@ -96,12 +201,247 @@ void send_error_packet(int sockfd, struct sockaddr_in* client_addr, uint16_t err
     }
 
     // Envoyer le paquet d'erreur
-    sendto(sockfd, &errPacket, sizeof(errPacket), 0, (struct sockaddr*)client_addr, sizeof(*client_addr));
+    sendto(sockfd, &errPacket, sizeof(errPacket), 0, (struct sockaddr*)client_addr, sockaddr_length(client_addr));
+}
+
+
+
+
+/**
+ * \brief Envoie un paquet OACK (acquittement d'options) au client.
+ * 
+ * \param sockfd Le descripteur de socket.
+ * \param client_addr L'adresse du client.
+ * \param options Les options acceptées et leurs valeurs.
+ * \param num_options Le nombre d'options.
+ * \return 0 en cas de succès, -1 en cas d'échec (voir send_would_block).
+ */
+int send_oack_packet(int sockfd, struct sockaddr_storage *client_addr, const TFTP_Option *options, int num_options) {
+    char packet[MAX_PACKET_SIZE];
+    uint16_t opcode = htons(TFTP_OPCODE_OACK);
+    size_t offset = sizeof(opcode);
+
+    memcpy(packet, &opcode, sizeof(opcode));
+    for (int i = 0; i < num_options; ++i) {
+        size_t name_len = strlen(options[i].name) + 1;
+        size_t value_len = strlen(options[i].value) + 1;
+        if (offset + name_len + value_len > sizeof(packet)) {
+            break;
+        }
+        memcpy(packet + offset, options[i].name, name_len);
+        offset += name_len;
+        memcpy(packet + offset, options[i].value, value_len);
+        offset += value_len;
+    }
+
+    if (sendto(sockfd, packet, offset, 0, (struct sockaddr *)client_addr, sockaddr_length(client_addr)) == -1) {
+        if (!send_would_block()) {
+            perror("Erreur lors de l'envoi du paquet OACK");
+        }
+        return -1;
+    }
+    return 0;
 }
 
 
 
 
+/**
+ * \brief Indique si le dernier envoi a échoué faute de place (file d'émission du socket ou de l'interface pleine).
+ * 
+ * \return 1 si errno vaut EAGAIN, EWOULDBLOCK ou ENOBUFS, 0 sinon.
+ */
+int send_would_block(void) {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS;
+}
+
+
+
+
+/**
+ * \brief Reçoit un datagramme et le compteur de pertes du socket (SO_RXQ_OVFL).
+ * 
+ * \param sockfd Le descripteur de socket.
+ * \param buffer Le tampon de réception.
+ * \param size La taille du tampon.
+ * \param addr Reçoit l'adresse de l'émetteur.
+ * \param addr_len Taille de addr en entrée, de l'adresse reçue en sortie.
+ * \param drops Reçoit le nombre cumulé de datagrammes rejetés faute de place dans la file de réception.
+ * \return Le nombre d'octets reçus, ou -1 en cas d'erreur (EAGAIN si aucun datagramme n'attend).
+ */
+ssize_t recv_packet(int sockfd, char *buffer, size_t size, struct sockaddr_storage *addr, socklen_t *addr_len, uint32_t *drops) {
+    char control[CMSG_SPACE(sizeof(uint32_t))];
+    struct iovec iov = { buffer, size };
+    struct msghdr msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name = addr;
+    msg.msg_namelen = *addr_len;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t received = recvmsg(sockfd, &msg, 0);
+    if (received < 0) {
+        return -1;
+    }
+    *addr_len = msg.msg_namelen;
+#ifdef SO_RXQ_OVFL
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+            memcpy(drops, CMSG_DATA(cmsg), sizeof(uint32_t));
+        }
+    }
+#else
+    (void) drops;
+#endif
+    return received;
+}
+
+
+
+
+/**
+ * \brief Extrait les options d'une requête RRQ/WRQ.
+ * 
+ * \param buffer Le paquet reçu.
+ * \param length La taille du paquet.
+ * \param offset La position du premier octet suivant le mode.
+ * \param request La requête à compléter.
+ * \return Le nombre d'options extraites.
+ */
+int parse_request_options(const char *buffer, size_t length, size_t offset, TFTP_Request *request) {
+    request->num_options = 0;
+
+    while (offset < length && request->num_options < MAX_OPTIONS) {
+        const char *name = buffer + offset;
+        const char *name_end = memchr(name, '\0', length - offset);
+        if (name_end == NULL) {
+            break;
+        }
+        const char *value = name_end + 1;
+        if ((size_t)(value - buffer) >= length) {
+            break;
+        }
+        const char *value_end = memchr(value, '\0', length - (value - buffer));
+        if (value_end == NULL) {
+            break;
+        }
+
+        // Ignorer les options trop longues ou sans nom
+        if (name_end > name && name_end - name < MAX_OPTION_LENGTH && value_end - value < MAX_OPTION_LENGTH) {
+            TFTP_Option *option = &request->options[request->num_options++];
+            strcpy(option->name, name);
+            strcpy(option->value, value);
+        }
+        offset = (value_end - buffer) + 1;
+    }
+    return request->num_options;
+}
+
+
+
+
+/**
+ * \brief Recherche une option dans une requête (sans tenir compte de la casse).
+ * 
+ * \param request La requête.
+ * \param name Le nom de l'option.
+ * \return La valeur de l'option, ou NULL si elle est absente.
+ */
+const char* get_request_option(const TFTP_Request *request, const char *name) {
+    for (int i = 0; i < request->num_options; ++i) {
+        if (strcasecmp(request->options[i].name, name) == 0) {
+            return request->options[i].value;
+        }
+    }
+    return NULL;
+}
+
+
+
+/**
+ * \brief Normalise le chemin demandé par un client (relatif au répertoire servi).
+ *
+ * \param path Le chemin reçu.
+ * \param out Reçoit le chemin normalisé (vide si path ne désigne que la racine).
+ * \param size La taille de out.
+ * \return 0 en cas de succès, -1 si le chemin est absolu, contient un segment ".." ou
+ *         dépasse size.
+ */
+int tftp_normalize_path(const char *path, char *out, size_t size) {
+    size_t len = 0;
+
+    if (path[0] == '/' || size == 0) {
+        return -1;
+    }
+    while (*path != '\0') {
+        size_t segment = strcspn(path, "/");
+
+        if (segment == 2 && path[0] == '.' && path[1] == '.') {
+            return -1;
+        }
+        if (segment > 0 && !(segment == 1 && path[0] == '.')) {
+            if (len + (len > 0) + segment >= size) {
+                return -1;
+            }
+            if (len > 0) {
+                out[len++] = '/';
+            }
+            memcpy(out + len, path, segment);
+            len += segment;
+        }
+        path += segment;
+        while (*path == '/') {
+            path++;
+        }
+    }
+    out[len] = '\0';
+    return 0;
+}
+
+
+
+
+/**
+ * \brief Retourne le numéro de bloc transmis pour un bloc de rang donné.
+ * 
+ * \param seq Le rang du bloc (0 : ACK de la requête ou de l'OACK).
+ * \param rollover TFTP_ROLLOVER_ZERO ou TFTP_ROLLOVER_ONE.
+ * \return Le numéro de bloc sur 16 bits.
+ */
+uint16_t tftp_block_number(unsigned long seq, int rollover) {
+    if (rollover == TFTP_ROLLOVER_ZERO || seq == 0) {
+        return (uint16_t) seq; // période de 65536 : 65535, 0, 1...
+    }
+    return (uint16_t) ((seq - 1) % 65535 + 1); // période de 65535 : 65535, 1, 2...
+}
+
+
+
+/**
+ * \brief Retourne l'écart entre un numéro de bloc reçu et le bloc de rang base.
+ * 
+ * \param block Le numéro de bloc reçu (16 bits).
+ * \param base Le rang du bloc de référence (dernier bloc acquitté).
+ * \param rollover TFTP_ROLLOVER_ZERO ou TFTP_ROLLOVER_ONE.
+ * \return Le nombre de blocs séparant base du bloc reçu, modulo la période de numérotation.
+ */
+unsigned long tftp_block_advance(uint16_t block, unsigned long base, int rollover) {
+    uint16_t from = tftp_block_number(base, rollover);
+
+    if (rollover == TFTP_ROLLOVER_ZERO || base == 0) {
+        return (uint16_t) (block - from);
+    }
+    if (block == 0) {
+        return 65535; // n'apparaît plus après le premier bloc : hors de toute fenêtre
+    }
+    return ((unsigned long) block + 65535 - from) % 65535;
+}
+
+
+
 /**
  * \brief Obtient le message d'erreur correspondant à un code d'erreur TFTP.
  * 
@@ -131,29 +471,60 @@ const char* get_error_message(int error_code) {
  * \return Le descripteur de socket, ou -1 en cas d'erreur.
  */
 int createUDPSocket(const char *ip, int port) {
-    int sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);// Création du socket UDP
-    if (sockfd < 0) {
-        perror("Erreur lors de la création du socket");
-        return -1;
-    }
+    struct sockaddr_storage server_addr;
+    struct sockaddr_in *addr4 = (struct sockaddr_in *) &server_addr;
+    struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *) &server_addr;
+    int sockfd = -1;
 
     // Configuration de l'adresse IP et du port
-    struct sockaddr_in server_addr;
     memset(&server_addr, 0, sizeof(server_addr));
+    if (ip == NULL || inet_pton(AF_INET6, ip, &addr6->sin6_addr) == 1) {
+        addr6->sin6_family = AF_INET6;
+        addr6->sin6_port = htons(port);
+        if (ip == NULL) {
+            addr6->sin6_addr = in6addr_any;
+        }
+        sockfd = socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);// Création du socket UDP
 
+        // Double pile : les clients IPv4 arrivent sur le même socket
+        int v6only = 0;
+        if (sockfd >= 0 && setsockopt(sockfd, IPPROTO_IPV6, IPV6_V6ONLY, &v6only, sizeof(v6only)) < 0) {
+            close(sockfd);
+            sockfd = -1;
+        }
+        if (sockfd < 0 && ip != NULL) {
+            perror("Erreur lors de la création du socket");
+            return -1;
+        }
+    }
 
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(port);
-    
-    if (ip == NULL) {
-        server_addr.sin_addr.s_addr = htonl(INADDR_ANY); 
-        // printf("any\n");
-    } else {
-        inet_pton(AF_INET, ip, &server_addr.sin_addr);
+    if (sockfd < 0) {
+        // Adresse IPv4, ou IPv6 indisponible sur cet hôte
+        memset(&server_addr, 0, sizeof(server_addr));
+        addr4->sin_family = AF_INET;
+        addr4->sin_port = htons(port);
+        if (ip == NULL) {
+            addr4->sin_addr.s_addr = htonl(INADDR_ANY); 
+            // printf("any\n");
+        } else if (inet_pton(AF_INET, ip, &addr4->sin_addr) != 1) {
+            printf("Adresse IP invalide : %s\n", ip);
+            return -1;
+        }
+        sockfd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, IPPROTO_UDP);
+        if (sockfd < 0) {
+            perror("Erreur lors de la création du socket");
+            return -1;
+        }
     }
 
+    tune_socket(sockfd, TFTP_SOCKET_BUFFER, TFTP_SOCKET_BUFFER);
+#ifdef SO_RXQ_OVFL
+    int overflow = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_RXQ_OVFL, &overflow, sizeof(overflow));
+#endif
+
     // Liaison du socket à l'adresse et au port spécifiés
-    if (bind(sockfd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+    if (bind(sockfd, (struct sockaddr *)&server_addr, sockaddr_length(&server_addr)) < 0) {
         perror("Erreur lors de la liaison du socket à l'adresse");
         close(sockfd);
         return -1;
@@ -165,43 +536,254 @@ int createUDPSocket(const char *ip, int port) {
 
 
 /**
- * Cette fonction génère un nom de fichier temporaire en ajoutant l'extension ".tmp" au nom du fichier original.
- * @param nom_fichier Le nom du fichier original.
- * @return Un pointeur vers une nouvelle chaîne de caractères contenant le nom du fichier temporaire.
- *         Il est de la responsabilité de l'appelant de libérer la mémoire allouée après usage.
+ * \brief Règle la taille des tampons d'émission et de réception d'un socket.
+ * 
+ * \param sockfd Le descripteur de socket.
+ * \param sndbuf La taille du tampon d'émission (octets).
+ * \param rcvbuf La taille du tampon de réception (octets).
  */
+void tune_socket(int sockfd, int sndbuf, int rcvbuf) {
+    if (setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)) < 0
+        || setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf)) < 0) {
+        perror("Erreur lors du réglage des tampons du socket");
+    }
+}
+
 
 
-char* get_temp_file_name(const char* nom_fichier) {
-    char* nouveau_nom = malloc(strlen(nom_fichier) + 5); // +5 pour ".tmp\0"
+/**
+ * \brief Retourne la taille de l'adresse à passer à sendto selon sa famille.
+ * 
+ * \param addr L'adresse.
+ * \return La taille de la structure sockaddr_in ou sockaddr_in6.
+ */
+socklen_t sockaddr_length(const struct sockaddr_storage* addr) {
+    return addr->ss_family == AF_INET6 ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+}
+
 
-    // Vérifier si l'allocation de mémoire a réussi
-    if (nouveau_nom == NULL) {
-        perror("Erreur lors de l'allocation de mémoire");
-        return NULL;
+
+/**
+ * \brief Compare deux adresses de transport (famille, adresse et port).
+ * 
+ * \param a Première adresse.
+ * \param b Seconde adresse.
+ * \return 1 si les adresses sont identiques, 0 sinon.
+ */
+int sockaddr_equal(const struct sockaddr_storage* a, const struct sockaddr_storage* b) {
+    if (a->ss_family != b->ss_family) {
+        return 0;
+    }
+    if (a->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *a6 = (const struct sockaddr_in6 *) a;
+        const struct sockaddr_in6 *b6 = (const struct sockaddr_in6 *) b;
+        return a6->sin6_port == b6->sin6_port && memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(struct in6_addr)) == 0;
+    }
+    const struct sockaddr_in *a4 = (const struct sockaddr_in *) a;
+    const struct sockaddr_in *b4 = (const struct sockaddr_in *) b;
+    return a4->sin_port == b4->sin_port && a4->sin_addr.s_addr == b4->sin_addr.s_addr;
+}
+
+
+
+/**
+ * \brief Écrit l'adresse IP sous forme de texte (une adresse IPv4 mappée est écrite en IPv4).
+ * 
+ * \param addr L'adresse.
+ * \param ip Le tampon de sortie.
+ * \param len La taille du tampon (INET6_ADDRSTRLEN au moins).
+ */
+void sockaddr_format(const struct sockaddr_storage* addr, char* ip, size_t len) {
+    struct sockaddr_storage copy = *addr;
+
+    sockaddr_unmap(&copy);
+    if (copy.ss_family == AF_INET6) {
+        inet_ntop(AF_INET6, &((struct sockaddr_in6 *) &copy)->sin6_addr, ip, len);
+    } else {
+        inet_ntop(AF_INET, &((struct sockaddr_in *) &copy)->sin_addr, ip, len);
     }
-    // Copier le nom du fichier original dans le nouveau nom
-    strcpy(nouveau_nom, nom_fichier);
-    strcat(nouveau_nom, ".tmp");// Ajouter l'extension ".tmp"
-    return nouveau_nom;
+}
+
 
+
+/**
+ * \brief Retourne le port d'une adresse.
+ * 
+ * \param addr L'adresse.
+ * \return Le port (ordre hôte).
+ */
+int sockaddr_port(const struct sockaddr_storage* addr) {
+    if (addr->ss_family == AF_INET6) {
+        return ntohs(((const struct sockaddr_in6 *) addr)->sin6_port);
+    }
+    return ntohs(((const struct sockaddr_in *) addr)->sin_port);
 }
 
 
+
 /**
- * Cette fonction supprime fichier temporaire d'un fichier original.
- * @param nom_fichier Le nom du fichier original.
- * @return 0 sucess        -1 failed
+ * \brief Retourne l'adresse IP sur 128 bits (une adresse IPv4 devient ::ffff:a.b.c.d).
+ * 
+ * \param addr L'adresse.
+ * \param out Reçoit l'adresse normalisée.
  */
-int remove_tempfile(const char* nom_fichier) {
-    char* temp_filename = get_temp_file_name(nom_fichier);
-        if (access(temp_filename, F_OK) != -1) {
-            // printf("Le fichier existe.\n");
-            if (remove(temp_filename) != 0) {
-                perror("Erreur lors de la suppression de l'ancien fichier");
-                return -1;
-            }
+void sockaddr_to_in6(const struct sockaddr_storage* addr, struct in6_addr* out) {
+    if (addr->ss_family == AF_INET6) {
+        *out = ((const struct sockaddr_in6 *) addr)->sin6_addr;
+        return;
+    }
+    memset(out, 0, sizeof(struct in6_addr));
+    out->s6_addr[10] = 0xff;
+    out->s6_addr[11] = 0xff;
+    memcpy(&out->s6_addr[12], &((const struct sockaddr_in *) addr)->sin_addr, 4);
+}
+
+
+
+/**
+ * \brief Convertit une adresse IPv4 mappée (::ffff:a.b.c.d) en adresse IPv4.
+ * 
+ * \param addr L'adresse, modifiée sur place (inchangée si elle n'est pas mappée).
+ * \return 1 si l'adresse est (désormais) une adresse IPv4, 0 sinon.
+ */
+int sockaddr_unmap(struct sockaddr_storage* addr) {
+    if (addr->ss_family == AF_INET) {
+        return 1;
+    }
+    struct sockaddr_in6 *addr6 = (struct sockaddr_in6 *) addr;
+    if (addr->ss_family != AF_INET6 || !IN6_IS_ADDR_V4MAPPED(&addr6->sin6_addr)) {
+        return 0;
+    }
+
+    struct sockaddr_in addr4;
+    memset(&addr4, 0, sizeof(addr4));
+    addr4.sin_family = AF_INET;
+    addr4.sin_port = addr6->sin6_port;
+    memcpy(&addr4.sin_addr, &addr6->sin6_addr.s6_addr[12], 4);
+    memset(addr, 0, sizeof(*addr));
+    memcpy(addr, &addr4, sizeof(addr4));
+    return 1;
+}
+
+
+
+/**
+ * \brief Retourne la taille maximale d'un datagramme UDP vers une adresse sans fragmentation.
+ * 
+ * \param addr L'adresse du destinataire.
+ * \return La taille maximale des données d'un datagramme (MTU moins les en-têtes IP et UDP).
+ */
+int sockaddr_max_datagram(const struct sockaddr_storage* addr) {
+    struct sockaddr_storage dest = *addr;
+    int mtu = TFTP_DEFAULT_MTU;
+    socklen_t len = sizeof(mtu);
+
+    sockaddr_unmap(&dest);
+    int ipv6 = dest.ss_family == AF_INET6;
+    int fd = socket(dest.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0) {
+        // Pas de paquet envoyé : connect choisit seulement la route, dont la MTU est lue
+        if (connect(fd, (struct sockaddr *) &dest, sockaddr_length(&dest)) != 0
+            || getsockopt(fd, ipv6 ? IPPROTO_IPV6 : IPPROTO_IP, ipv6 ? IPV6_MTU : IP_MTU, &mtu, &len) != 0) {
+            mtu = TFTP_DEFAULT_MTU;
         }
-        free(temp_filename);
+        close(fd);
+    }
+    return mtu - (ipv6 ? 40 : 20) - 8;
+}
+
+
+
+/**
+ * \brief Calcule l'empreinte de l'adresse IP (sans le port), identique pour les deux familles.
+ * 
+ * \param addr L'adresse.
+ * \return L'empreinte.
+ */
+unsigned long sockaddr_hash(const struct sockaddr_storage* addr) {
+    struct in6_addr ip;
+    unsigned long hash = 2166136261u;
+
+    sockaddr_to_in6(addr, &ip);
+    for (int i = 0; i < 16; ++i) {
+        hash = (hash ^ ip.s6_addr[i]) * 16777619u;
+    }
+    return hash;
+}
+
+
+
+/**
+ * \brief Lit un sous-réseau "adresse/préfixe" IPv4 ou IPv6 (une adresse seule vaut /32 ou /128).
+ * 
+ * Un réseau IPv4 est converti en réseau IPv4 mappé (::ffff:a.b.c.d, préfixe + 96), pour
+ * être comparé aux adresses normalisées par sockaddr_to_in6.
+ * 
+ * \param text Le texte à lire.
+ * \param network Reçoit l'adresse du réseau sur 128 bits.
+ * \param prefix_len Reçoit la longueur du préfixe sur 128 bits.
+ * \return 0 en cas de succès, -1 si le sous-réseau est invalide.
+ */
+int sockaddr_parse_prefix(const char* text, struct in6_addr* network, int* prefix_len) {
+    char address[INET6_ADDRSTRLEN];
+    struct sockaddr_storage parsed;
+    int len = -1;
+
+    // Sous-réseau adresse/préfixe
+    const char* slash = strchr(text, '/');
+    size_t address_len = slash != NULL ? (size_t) (slash - text) : strlen(text);
+    if (address_len >= sizeof(address)) {
+        return -1;
+    }
+    memcpy(address, text, address_len);
+    address[address_len] = '\0';
+    if (slash != NULL) {
+        char* end;
+        len = (int) strtol(slash + 1, &end, 10);
+        if (end == slash + 1 || *end != '\0' || len < 0) {
+            return -1;
+        }
+    }
+
+    memset(&parsed, 0, sizeof(parsed));
+    if (inet_pton(AF_INET6, address, &((struct sockaddr_in6 *) &parsed)->sin6_addr) == 1) {
+        parsed.ss_family = AF_INET6;
+        len = len < 0 ? 128 : len;
+    } else if (inet_pton(AF_INET, address, &((struct sockaddr_in *) &parsed)->sin_addr) == 1) {
+        parsed.ss_family = AF_INET;
+        len = len < 0 ? 32 : len;
+        len = len <= 32 ? len + 96 : -1;
+    } else {
+        return -1;
+    }
+    if (len < 0 || len > 128) {
+        return -1;
+    }
+    sockaddr_to_in6(&parsed, network);
+    *prefix_len = len;
+    return 0;
+}
+
+
+
+/**
+ * \brief Indique si une adresse appartient à un réseau (adresses normalisées par sockaddr_to_in6).
+ * 
+ * \param addr L'adresse.
+ * \param network Le réseau.
+ * \param prefix_len La longueur du préfixe (bits).
+ * \return 1 si les prefix_len premiers bits sont égaux, 0 sinon.
+ */
+int sockaddr_prefix_match(const struct in6_addr* addr, const struct in6_addr* network, int prefix_len) {
+    int bytes = prefix_len / 8;
+    int bits = prefix_len % 8;
+
+    if (memcmp(addr->s6_addr, network->s6_addr, bytes) != 0) {
         return 0;
-}
\ No newline at end of file
+    }
+    if (bits == 0) {
+        return 1;
+    }
+    unsigned char mask = (unsigned char) (0xFF << (8 - bits));
+    return (addr->s6_addr[bytes] & mask) == (network->s6_addr[bytes] & mask);
+}
@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <arpa/inet.h>
 #include <string.h>
+#include <strings.h>
 
 #ifndef TFTP_TYPES
 #define TFTP_TYPES
@@ -26,6 +27,7 @@
 #define TFTP_OPCODE_DATA 3
 #define TFTP_OPCODE_ACK 4
 #define TFTP_OPCODE_ERR 5
+#define TFTP_OPCODE_OACK 6
 
 
 // Paramètres de temporisation et de réessa
@@ -33,10 +35,44 @@
 #define MAX_RETRIES 3
 
 
+// Options de requête (RFC 2347)
+#define MAX_OPTIONS 8
+#define MAX_OPTION_LENGTH 64
+
+// Taille maximale de fenêtre acceptée pour l'option windowsize (RFC 7440)
+#define TFTP_MAX_WINDOW 64
+
+// Tailles de bloc acceptées pour l'option blksize (RFC 2348) ; MAX_DATA_SIZE sans l'option
+#define TFTP_MIN_BLKSIZE 8
+#define TFTP_MAX_BLKSIZE 65464
+#define TFTP_MAX_PACKET_SIZE (TFTP_MAX_BLKSIZE + TFTP_HEADER_SIZE)
+
+// Taille maximale d'une rafale segmentée par le noyau (datagramme UDP avant découpage)
+#define TFTP_MAX_BURST_BYTES 65000
+
+// MTU supposée lorsque celle du chemin vers le client ne peut pas être lue (Ethernet)
+#define TFTP_DEFAULT_MTU 1500
+
+// Bloc suivant le bloc 65535 (option rollover) : 0 par défaut, 1 pour certains clients
+#define TFTP_ROLLOVER_ZERO 0
+#define TFTP_ROLLOVER_ONE 1
+
+// Tampons des sockets (SO_SNDBUF, SO_RCVBUF) : une fenêtre complète par session, une rafale de requêtes sur le port principal
+#define TFTP_SOCKET_BUFFER (256 * 1024)
+#define TFTP_LISTEN_BUFFER (4 * 1024 * 1024)
+
+
+typedef struct {
+    char name[MAX_OPTION_LENGTH]; // Nom de l'option (ex: "multicast")
+    char value[MAX_OPTION_LENGTH]; // Valeur de l'option
+} TFTP_Option;
+
 typedef struct {
     uint16_t opcode;    // Code d'opération TFTP (RRQ ou WRQ)
     char filename[504]; // Nom du fichier à transférer
     char mode[10]; // Mode de transfert (octet, netascii)
+    int num_options; // Nombre d'options reçues
+    TFTP_Option options[MAX_OPTIONS]; // Options reçues après le mode
 } TFTP_Request;
 
 typedef struct {
@@ -83,7 +119,8 @@ typedef union {
 // Enumération pour indiquer le type de paquet (soit un paquet de données, soit un paquet d'acquittement)
 typedef enum {
     DATA_PACKET,
-    ACK_PACKET
+    ACK_PACKET,
+    OACK_PACKET
 } PacketType;
 
 
@@ -101,8 +138,31 @@ typedef enum {
  * \param block_number Le numéro de bloc du paquet de données.
  * \param data Les données à inclure dans le paquet.
  * \param data_size La taille des données.
+ * \return 0 en cas de succès, -1 en cas d'échec (voir send_would_block).
  */
-void send_data_packet(int sockfd, struct sockaddr_in* client_addr, uint16_t block_number, char *data, size_t data_size);
+int send_data_packet(int sockfd, struct sockaddr_storage* client_addr, uint16_t block_number, char *data, size_t data_size);
+
+
+
+/**
+ * \brief Envoie plusieurs paquets de données consécutifs en un seul appel système.
+ * 
+ * Les paquets sont placés bout à bout dans un tampon envoyé avec UDP_SEGMENT (GSO) :
+ * le noyau les découpe en datagrammes de la taille du premier. Tous les blocs doivent
+ * donc être complets, sauf le dernier, et tenir ensemble dans TFTP_MAX_BURST_BYTES ; un
+ * datagramme doit tenir dans la MTU du chemin (voir sockaddr_max_datagram).
+ * 
+ * \param sockfd Le descripteur de socket.
+ * \param client_addr L'adresse du client.
+ * \param blocks Les numéros des blocs (le numéro suivant 65535 dépend de l'option rollover).
+ * \param data Les données des blocs.
+ * \param sizes Les tailles des blocs.
+ * \param count Le nombre de blocs (au plus TFTP_MAX_WINDOW).
+ * \return 0 si les paquets ont été envoyés, -1 sinon : file d'émission pleine (voir
+ *         send_would_block), ou segmentation indisponible (les paquets doivent alors être
+ *         envoyés un par un).
+ */
+int send_data_burst(int sockfd, struct sockaddr_storage* client_addr, const uint16_t* blocks, char** data, const size_t* sizes, int count);
 
 
 
@@ -116,8 +176,9 @@ void send_data_packet(int sockfd, struct sockaddr_in* client_addr, uint16_t bloc
  * \param sockfd Le descripteur de socket.
  * \param client_addr L'adresse du client.
  * \param block_number Le numéro de bloc du paquet ACK.
+ * \return 0 en cas de succès, -1 en cas d'échec (voir send_would_block).
  */
-void send_ack_packet(int sockfd, struct sockaddr_in *client_addr, uint16_t block_number);
+int send_ack_packet(int sockfd, struct sockaddr_storage *client_addr, uint16_t block_number);
 
 
 
@@ -134,7 +195,118 @@ void send_ack_packet(int sockfd, struct sockaddr_in *client_addr, uint16_t block
  * \param error_message Le message d'erreur.
  * \param additional_message Message supplémentaire optionnel.
  */
-void send_error_packet(int sockfd, struct sockaddr_in* client_addr, uint16_t errorCode, const char* error_message, const char* additional_message);
+void send_error_packet(int sockfd, struct sockaddr_storage* client_addr, uint16_t errorCode, const char* error_message, const char* additional_message);
+
+
+/**
+ * \brief Envoie un paquet OACK (acquittement d'options) au client.
+ * 
+ * \param sockfd Le descripteur de socket.
+ * \param client_addr L'adresse du client.
+ * \param options Les options acceptées et leurs valeurs.
+ * \param num_options Le nombre d'options.
+ * \return 0 en cas de succès, -1 en cas d'échec (voir send_would_block).
+ */
+int send_oack_packet(int sockfd, struct sockaddr_storage *client_addr, const TFTP_Option *options, int num_options);
+
+
+
+/**
+ * \brief Indique si le dernier envoi a échoué faute de place (file d'émission du socket ou de l'interface pleine).
+ * 
+ * Les sockets sont non bloquants : un tel échec est passager, le paquet doit être renvoyé
+ * plus tard. Les autres échecs (ICMP, route absente...) sont journalisés par la fonction d'envoi.
+ * 
+ * \return 1 si errno vaut EAGAIN, EWOULDBLOCK ou ENOBUFS, 0 sinon.
+ */
+int send_would_block(void);
+
+
+
+/**
+ * \brief Reçoit un datagramme et le compteur de pertes du socket (SO_RXQ_OVFL).
+ * 
+ * \param sockfd Le descripteur de socket.
+ * \param buffer Le tampon de réception.
+ * \param size La taille du tampon.
+ * \param addr Reçoit l'adresse de l'émetteur.
+ * \param addr_len Taille de addr en entrée, de l'adresse reçue en sortie.
+ * \param drops Reçoit le nombre cumulé de datagrammes rejetés par le noyau faute de place
+ *        dans la file de réception (inchangé si le noyau ne le fournit pas).
+ * \return Le nombre d'octets reçus, ou -1 en cas d'erreur (EAGAIN si aucun datagramme n'attend).
+ */
+ssize_t recv_packet(int sockfd, char *buffer, size_t size, struct sockaddr_storage *addr, socklen_t *addr_len, uint32_t *drops);
+
+
+
+/**
+ * \brief Extrait les options d'une requête RRQ/WRQ.
+ * 
+ * Lit les paires nom/valeur terminées par '\0' qui suivent le mode de transfert.
+ * Les options mal formées ou en surnombre sont ignorées.
+ * 
+ * \param buffer Le paquet reçu.
+ * \param length La taille du paquet.
+ * \param offset La position du premier octet suivant le mode.
+ * \param request La requête à compléter.
+ * \return Le nombre d'options extraites.
+ */
+int parse_request_options(const char *buffer, size_t length, size_t offset, TFTP_Request *request);
+
+
+
+/**
+ * \brief Recherche une option dans une requête (sans tenir compte de la casse).
+ * 
+ * \param request La requête.
+ * \param name Le nom de l'option.
+ * \return La valeur de l'option, ou NULL si elle est absente.
+ */
+const char* get_request_option(const TFTP_Request *request, const char *name);
+
+
+
+/**
+ * \brief Normalise le chemin demandé par un client (relatif au répertoire servi).
+ *
+ * Les segments "." et vides sont supprimés : "./a//b/" devient "a/b". Le résultat est
+ * l'unique écriture du chemin, utilisée pour le contrôle d'accès, les caches et l'ouverture.
+ *
+ * \param path Le chemin reçu.
+ * \param out Reçoit le chemin normalisé (vide si path ne désigne que la racine).
+ * \param size La taille de out.
+ * \return 0 en cas de succès, -1 si le chemin est absolu, contient un segment ".." ou
+ *         dépasse size.
+ */
+int tftp_normalize_path(const char *path, char *out, size_t size);
+
+
+
+/**
+ * \brief Retourne le numéro de bloc transmis pour un bloc de rang donné.
+ * 
+ * Le rang n'est pas tronqué (le premier bloc de données a le rang 1). Après le bloc 65535,
+ * la numérotation reprend à 0 (TFTP_ROLLOVER_ZERO) ou à 1 (TFTP_ROLLOVER_ONE).
+ * 
+ * \param seq Le rang du bloc (0 : ACK de la requête ou de l'OACK).
+ * \param rollover TFTP_ROLLOVER_ZERO ou TFTP_ROLLOVER_ONE.
+ * \return Le numéro de bloc sur 16 bits.
+ */
+uint16_t tftp_block_number(unsigned long seq, int rollover);
+
+
+
+/**
+ * \brief Retourne l'écart entre un numéro de bloc reçu et le bloc de rang base.
+ * 
+ * \param block Le numéro de bloc reçu (16 bits).
+ * \param base Le rang du bloc de référence (dernier bloc acquitté).
+ * \param rollover TFTP_ROLLOVER_ZERO ou TFTP_ROLLOVER_ONE.
+ * \return Le nombre de blocs séparant base du bloc reçu, modulo la période de numérotation
+ *         (0 : même bloc ; une valeur proche de la période : bloc antérieur).
+ */
+unsigned long tftp_block_advance(uint16_t block, unsigned long base, int rollover);
+
 
 
 /**
@@ -152,7 +324,12 @@ const char* get_error_message(int error_code);
 /**
  * \brief Crée un socket UDP et l'associe à une adresse IP et un port.
  * 
- * Crée un socket UDP et l'associe à une adresse IP et un port spécifiés.
+ * Sans adresse, le socket est un socket IPv6 double pile (IPV6_V6ONLY=0) qui reçoit
+ * aussi les clients IPv4 (adresses ::ffff:a.b.c.d) ; si IPv6 est indisponible, un
+ * socket IPv4 est créé. Une adresse IPv4 ou IPv6 donne un socket de la famille correspondante.
+ * 
+ * Le socket est non bloquant, ses tampons valent TFTP_SOCKET_BUFFER et il signale les
+ * datagrammes perdus en réception (SO_RXQ_OVFL, voir recv_packet).
  * 
  * \param ip L'adresse IP à utiliser (NULL pour utiliser l'adresse "any").
  * \param port Le numéro de port à utiliser.
@@ -162,23 +339,128 @@ int createUDPSocket(const char *ip, int port);
 
 
 
+/**
+ * \brief Règle la taille des tampons d'émission et de réception d'un socket.
+ * 
+ * Le noyau plafonne les valeurs (net.core.wmem_max, net.core.rmem_max) ; un échec n'est pas fatal.
+ * 
+ * \param sockfd Le descripteur de socket.
+ * \param sndbuf La taille du tampon d'émission (octets).
+ * \param rcvbuf La taille du tampon de réception (octets).
+ */
+void tune_socket(int sockfd, int sndbuf, int rcvbuf);
+
+
+
+/**
+ * \brief Retourne la taille de l'adresse à passer à sendto selon sa famille.
+ * 
+ * \param addr L'adresse.
+ * \return La taille de la structure sockaddr_in ou sockaddr_in6.
+ */
+socklen_t sockaddr_length(const struct sockaddr_storage* addr);
+
+
+
+/**
+ * \brief Compare deux adresses de transport (famille, adresse et port).
+ * 
+ * \param a Première adresse.
+ * \param b Seconde adresse.
+ * \return 1 si les adresses sont identiques, 0 sinon.
+ */
+int sockaddr_equal(const struct sockaddr_storage* a, const struct sockaddr_storage* b);
+
+
+
+/**
+ * \brief Écrit l'adresse IP sous forme de texte (une adresse IPv4 mappée est écrite en IPv4).
+ * 
+ * \param addr L'adresse.
+ * \param ip Le tampon de sortie.
+ * \param len La taille du tampon (INET6_ADDRSTRLEN au moins).
+ */
+void sockaddr_format(const struct sockaddr_storage* addr, char* ip, size_t len);
+
+
+
+/**
+ * \brief Retourne le port d'une adresse.
+ * 
+ * \param addr L'adresse.
+ * \return Le port (ordre hôte).
+ */
+int sockaddr_port(const struct sockaddr_storage* addr);
+
+
 
 /**
- * Cette fonction génère un nom de fichier temporaire en ajoutant l'extension ".tmp" au nom du fichier original.
- * @param nom_fichier Le nom du fichier original.
- * @return Un pointeur vers une nouvelle chaîne de caractères contenant le nom du fichier temporaire.
- *         Il est de la responsabilité de l'appelant de libérer la mémoire allouée après usage.
+ * \brief Retourne l'adresse IP sur 128 bits (une adresse IPv4 devient ::ffff:a.b.c.d).
+ * 
+ * \param addr L'adresse.
+ * \param out Reçoit l'adresse normalisée.
  */
-char* get_temp_file_name(const char* nom_fichier);
+void sockaddr_to_in6(const struct sockaddr_storage* addr, struct in6_addr* out);
 
 
 
 /**
- * Cette fonction supprime fichier temporaire d'un fichier original.
- * @param nom_fichier Le nom du fichier original.
- * @return 0 sucess        -1 failed
+ * \brief Convertit une adresse IPv4 mappée (::ffff:a.b.c.d) en adresse IPv4.
+ * 
+ * \param addr L'adresse, modifiée sur place (inchangée si elle n'est pas mappée).
+ * \return 1 si l'adresse est (désormais) une adresse IPv4, 0 sinon.
+ */
+int sockaddr_unmap(struct sockaddr_storage* addr);
+
+
+
+/**
+ * \brief Retourne la taille maximale d'un datagramme UDP vers une adresse sans fragmentation.
+ * 
+ * La MTU du chemin (IP_MTU ou IPV6_MTU) est lue sur un socket temporaire connecté à
+ * l'adresse ; TFTP_DEFAULT_MTU est supposée si elle est illisible.
+ * 
+ * \param addr L'adresse du destinataire.
+ * \return La taille maximale des données d'un datagramme (MTU moins les en-têtes IP et UDP).
+ */
+int sockaddr_max_datagram(const struct sockaddr_storage* addr);
+
+
+
+/**
+ * \brief Calcule l'empreinte de l'adresse IP (sans le port), identique pour les deux familles.
+ * 
+ * \param addr L'adresse.
+ * \return L'empreinte.
+ */
+unsigned long sockaddr_hash(const struct sockaddr_storage* addr);
+
+
+
+/**
+ * \brief Lit un sous-réseau "adresse/préfixe" IPv4 ou IPv6 (une adresse seule vaut /32 ou /128).
+ * 
+ * Un réseau IPv4 est converti en réseau IPv4 mappé (::ffff:a.b.c.d, préfixe + 96), pour
+ * être comparé aux adresses normalisées par sockaddr_to_in6.
+ * 
+ * \param text Le texte à lire.
+ * \param network Reçoit l'adresse du réseau sur 128 bits.
+ * \param prefix_len Reçoit la longueur du préfixe sur 128 bits.
+ * \return 0 en cas de succès, -1 si le sous-réseau est invalide.
+ */
+int sockaddr_parse_prefix(const char* text, struct in6_addr* network, int* prefix_len);
+
+
+
+/**
+ * \brief Indique si une adresse appartient à un réseau (adresses normalisées par sockaddr_to_in6).
+ * 
+ * \param addr L'adresse.
+ * \param network Le réseau (voir sockaddr_parse_prefix).
+ * \param prefix_len La longueur du préfixe (bits).
+ * \return 1 si les prefix_len premiers bits sont égaux, 0 sinon.
  */
-int remove_tempfile(const char* nom_fichier);
+int sockaddr_prefix_match(const struct in6_addr* addr, const struct in6_addr* network, int prefix_len);
 
 #endif
 
@@ -0,0 +1,149 @@
+#include "upload.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+
+/**
+ * \brief Extrait le répertoire d'un chemin.
+ *
+ * \param path Le chemin (moins de UPLOAD_MAX_PATH octets).
+ * \param dir Reçoit le répertoire (UPLOAD_MAX_PATH octets), "." si le chemin n'en contient pas.
+ */
+static void directory_of(const char* path, char* dir) {
+    const char* slash = strrchr(path, '/');
+
+    if (slash == NULL) {
+        strcpy(dir, ".");
+    } else if (slash == path) {
+        strcpy(dir, "/");
+    } else {
+        memcpy(dir, path, slash - path);
+        dir[slash - path] = '\0';
+    }
+}
+
+
+
+/**
+ * \brief Donne un nom à un fichier anonyme.
+ *
+ * \param fd Le descripteur du fichier anonyme.
+ * \param path Le nom à créer (ne doit pas exister).
+ * \return 0 en cas de succès, -1 en cas d'erreur (errno positionné).
+ */
+static int link_anonymous(int fd, const char* path) {
+    char proc_path[64];
+
+    // Directement par le descripteur (CAP_DAC_READ_SEARCH requis), sinon par /proc
+    if (linkat(fd, "", AT_FDCWD, path, AT_EMPTY_PATH) == 0) {
+        return 0;
+    }
+    if (errno != ENOENT && errno != EPERM) {
+        return -1;
+    }
+    snprintf(proc_path, sizeof(proc_path), "/proc/self/fd/%d", fd);
+    return linkat(AT_FDCWD, proc_path, AT_FDCWD, path, AT_SYMLINK_FOLLOW);
+}
+
+
+
+/**
+ * \brief Ouvre le fichier recevant les données d'un fichier envoyé par un client.
+ *
+ * \param path Le chemin de destination.
+ * \param kind Reçoit UPLOAD_ANONYMOUS ou UPLOAD_NAMED.
+ * \return Le fichier ouvert en écriture, ou NULL en cas d'erreur.
+ */
+FILE* upload_open(const char* path, int* kind) {
+    char dir[UPLOAD_MAX_PATH];
+    char temp[UPLOAD_MAX_PATH + sizeof(UPLOAD_TEMP_SUFFIX)];
+
+    if (strlen(path) >= UPLOAD_MAX_PATH) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+
+    directory_of(path, dir);
+    int fd = open(dir, O_TMPFILE | O_WRONLY | O_CLOEXEC, 0666);
+    if (fd >= 0) {
+        FILE* file = fdopen(fd, "wb");
+        if (file == NULL) {
+            close(fd);
+        }
+        *kind = UPLOAD_ANONYMOUS;
+        return file;
+    }
+    // Système de fichiers sans O_TMPFILE : repli sur un fichier temporaire nommé
+    if (errno != EOPNOTSUPP && errno != EISDIR && errno != EINVAL) {
+        return NULL;
+    }
+    snprintf(temp, sizeof(temp), "%s%s", path, UPLOAD_TEMP_SUFFIX);
+    *kind = UPLOAD_NAMED;
+    return fopen(temp, "wb");
+}
+
+
+
+/**
+ * \brief Publie atomiquement un fichier reçu sous son nom de destination.
+ *
+ * \param file Le fichier reçu.
+ * \param path Le chemin de destination.
+ * \param kind La nature du fichier (voir upload_open).
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int upload_commit(FILE* file, const char* path, int kind) {
+    char temp[UPLOAD_MAX_PATH + 32];
+
+    if (fflush(file) != 0) {
+        return -1;
+    }
+    if (kind == UPLOAD_NAMED) {
+        snprintf(temp, sizeof(temp), "%s%s", path, UPLOAD_TEMP_SUFFIX);
+        return rename(temp, path);
+    }
+
+    // Cas courant (nouveau fichier) : un seul appel système
+    if (link_anonymous(fileno(file), path) == 0) {
+        return 0;
+    }
+    if (errno != EEXIST) {
+        return -1;
+    }
+
+    // Le nom existe : liaison sous un nom propre à cette réception, puis renommage par-dessus
+    snprintf(temp, sizeof(temp), "%s.%ld.%d%s", path, (long) getpid(), fileno(file), UPLOAD_TEMP_SUFFIX);
+    if (link_anonymous(fileno(file), temp) != 0) {
+        return -1;
+    }
+    if (rename(temp, path) != 0) {
+        int saved = errno;
+        unlink(temp);
+        errno = saved;
+        return -1;
+    }
+    return 0;
+}
+
+
+
+/**
+ * \brief Abandonne une réception : supprime le fichier temporaire nommé s'il y en a un.
+ *
+ * \param path Le chemin de destination.
+ * \param kind La nature du fichier (voir upload_open).
+ */
+void upload_abort(const char* path, int kind) {
+    char temp[UPLOAD_MAX_PATH + sizeof(UPLOAD_TEMP_SUFFIX)];
+
+    if (kind != UPLOAD_NAMED) {
+        return;
+    }
+    snprintf(temp, sizeof(temp), "%s%s", path, UPLOAD_TEMP_SUFFIX);
+    if (unlink(temp) != 0 && errno != ENOENT) {
+        perror("Erreur lors de la suppression du fichier temporaire");
+    }
+}
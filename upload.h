@@ -0,0 +1,64 @@
+/*
+   Fichiers reçus : écriture dans un fichier anonyme et publication atomique - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef UPLOAD
+#define UPLOAD
+
+
+#define UPLOAD_MAX_PATH 512 // Longueur maximale d'un chemin de fichier reçu
+#define UPLOAD_TEMP_SUFFIX ".tmp" // Suffixe du fichier temporaire nommé (repli sans O_TMPFILE)
+
+// Nature du fichier en cours d'écriture
+#define UPLOAD_NONE 0 // Aucune réception
+#define UPLOAD_ANONYMOUS 1 // Fichier anonyme (O_TMPFILE) : rien à nettoyer en cas d'abandon
+#define UPLOAD_NAMED 2 // Fichier temporaire nommé (nom + UPLOAD_TEMP_SUFFIX)
+
+
+
+/**
+ * \brief Ouvre le fichier recevant les données d'un fichier envoyé par un client.
+ *
+ * Le fichier est créé sans nom (O_TMPFILE) dans le répertoire de destination ; si le
+ * système de fichiers ne le permet pas, il est créé sous le nom de destination suivi de
+ * UPLOAD_TEMP_SUFFIX.
+ *
+ * \param path Le chemin de destination.
+ * \param kind Reçoit UPLOAD_ANONYMOUS ou UPLOAD_NAMED.
+ * \return Le fichier ouvert en écriture, ou NULL en cas d'erreur.
+ */
+FILE* upload_open(const char* path, int* kind);
+
+
+
+/**
+ * \brief Publie atomiquement un fichier reçu sous son nom de destination.
+ *
+ * Un fichier anonyme est lié dans le répertoire par linkat ; un fichier de même nom est
+ * remplacé par renommage, sans instant où le nom n'existe pas. Le fichier reste ouvert.
+ *
+ * \param file Le fichier reçu.
+ * \param path Le chemin de destination.
+ * \param kind La nature du fichier (voir upload_open).
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+int upload_commit(FILE* file, const char* path, int kind);
+
+
+
+/**
+ * \brief Abandonne une réception : supprime le fichier temporaire nommé s'il y en a un.
+ *
+ * Un fichier anonyme disparaît à sa fermeture, sans nettoyage.
+ *
+ * \param path Le chemin de destination.
+ * \param kind La nature du fichier (voir upload_open).
+ */
+void upload_abort(const char* path, int kind);
+
+#endif
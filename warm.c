@@ -0,0 +1,232 @@
+#include "warm.h"
+#include "cache.h"
+#include "notify.h"
+#include "tftp.h"
+
+#include <glob.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/stat.h>
+
+
+// Travail de préchargement en cours (un seul par processus)
+static WarmJob job;
+
+
+
+/**
+ * \brief Retourne l'heure monotone en secondes.
+ *
+ * \return L'heure en secondes.
+ */
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+
+
+/**
+ * \brief Construit la clé de cache du contenu brut (mode octet) d'un fichier.
+ *
+ * \param key Le tampon de sortie (CACHE_KEY_LENGTH octets).
+ * \param filename Le nom du fichier.
+ */
+void warm_cache_key(char* key, const char* filename) {
+    snprintf(key, CACHE_KEY_LENGTH, "octet:%s", filename);
+}
+
+
+
+/**
+ * \brief Ajoute un fichier à la liste du travail.
+ *
+ * \param path Le chemin du fichier.
+ * \return 0 en cas de succès, -1 en cas d'erreur d'allocation.
+ */
+static int add_file(const char* path) {
+    char** files = realloc(job.files, (job.count + 1) * sizeof(char*));
+    if (files == NULL) {
+        return -1;
+    }
+    job.files = files;
+    job.files[job.count] = strdup(path);
+    if (job.files[job.count] == NULL) {
+        return -1;
+    }
+    job.count++;
+    return 0;
+}
+
+
+
+/**
+ * \brief Lit un fichier complet et l'insère dans le cache.
+ *
+ * \param filename Le nom du fichier.
+ * \return Le nombre d'octets chargés, ou -1 en cas d'échec.
+ */
+static long load_file(const char* filename) {
+    struct stat st;
+    char key[CACHE_KEY_LENGTH];
+
+    // Fichier plus grand que le cache : refusé par cache_insert, ni alloué ni lu
+    if (stat(filename, &st) != 0 || !S_ISREG(st.st_mode) || (uintmax_t) st.st_size > cache_get_limit()) {
+        return -1;
+    }
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL) {
+        return -1;
+    }
+    char* data = malloc(st.st_size > 0 ? st.st_size : 1);
+    size_t len = data != NULL ? fread(data, 1, st.st_size, file) : 0;
+    fclose(file);
+    if (data == NULL || len != (size_t) st.st_size) {
+        free(data);
+        return -1;
+    }
+
+    warm_cache_key(key, filename);
+    CacheEntry* entry = cache_insert(key, &st, data, len);
+    if (entry == NULL) {
+        return -1;
+    }
+    cache_release(entry); // l'entrée reste en cache sans référence
+    return (long) len;
+}
+
+
+
+/**
+ * \brief Termine le préchargement (exécuté par la boucle principale, threads terminés).
+ *
+ * \param arg Inutilisé.
+ */
+static void warm_complete(void* arg) {
+    (void) arg;
+
+    printf("Warm : terminé, %zu/%zu fichiers en cache (%ld Ko)\n", job.loaded, job.count, job.bytes / 1024);
+    for (size_t i = 0; i < job.count; ++i) {
+        free(job.files[i]);
+    }
+    free(job.files);
+    job.files = NULL;
+}
+
+
+
+/**
+ * \brief Thread de préchargement : traite les fichiers du travail jusqu'au dernier.
+ *
+ * \param arg Inutilisé.
+ * \return NULL.
+ */
+static void* warm_worker(void* arg) {
+    (void) arg;
+
+    while (1) {
+        pthread_mutex_lock(&job.mutex);
+        if (job.next >= job.count) {
+            pthread_mutex_unlock(&job.mutex);
+            break;
+        }
+        const char* filename = job.files[job.next++];
+        pthread_mutex_unlock(&job.mutex);
+
+        long bytes = load_file(filename);
+
+        pthread_mutex_lock(&job.mutex);
+        if (bytes < 0) {
+            printf("Warm : impossible de précharger %s\n", filename);
+        } else {
+            job.loaded++;
+            job.bytes += bytes;
+        }
+        job.done++;
+        // Afficher la progression tous les 10 % et à la fin
+        if (job.done == job.count || (job.done * 10 / job.count) != ((job.done - 1) * 10 / job.count)) {
+            printf("Warm : %zu/%zu fichiers, %ld Ko chargés en %.2f s\n",
+                   job.done, job.count, job.bytes / 1024, now_seconds() - job.start);
+        }
+        int finished = job.done == job.count;
+        pthread_mutex_unlock(&job.mutex);
+
+        // Le dernier fichier traité : la boucle principale libère la liste
+        if (finished) {
+            notify_post(warm_complete, NULL);
+        }
+    }
+    return NULL;
+}
+
+
+
+/**
+ * \brief Démarre le préchargement en arrière-plan des fichiers listés dans un manifeste.
+ *
+ * \param manifest Le chemin du manifeste.
+ * \param num_threads Le nombre de threads de lecture.
+ * \return 0 en cas de succès, -1 si le manifeste ne peut pas être lu.
+ */
+int warm_start(const char* manifest, int num_threads) {
+    char line[1024];
+    char path[sizeof(((TFTP_Request*)0)->filename)];
+
+    // Un seul travail à la fois : la liste est libérée par la boucle principale à la fin
+    if (job.files != NULL) {
+        printf("Warm : préchargement précédent en cours, manifeste %s ignoré\n", manifest);
+        return 0;
+    }
+
+    FILE* file = fopen(manifest, "r");
+    if (file == NULL) {
+        perror("Erreur lors de l'ouverture du manifeste");
+        return -1;
+    }
+
+    memset(&job, 0, sizeof(job));
+    pthread_mutex_init(&job.mutex, NULL);
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+
+        glob_t matches;
+        if (glob(line, 0, NULL, &matches) != 0) {
+            printf("Warm : aucun fichier pour '%s'\n", line);
+            continue;
+        }
+        for (size_t i = 0; i < matches.gl_pathc; ++i) {
+            // Clé sous la forme normalisée des noms demandés par les clients ("./f" : "f")
+            if (tftp_normalize_path(matches.gl_pathv[i], path, sizeof(path)) != 0) {
+                printf("Warm : %s ignoré (chemin absolu ou hors de la racine servie)\n", matches.gl_pathv[i]);
+                continue;
+            }
+            add_file(path);
+        }
+        globfree(&matches);
+    }
+    fclose(file);
+
+    if (job.count == 0) {
+        return 0;
+    }
+    if (num_threads < 1) {
+        num_threads = 1;
+    } else if (num_threads > WARM_MAX_THREADS) {
+        num_threads = WARM_MAX_THREADS;
+    }
+
+    printf("Warm : préchargement de %zu fichiers avec %d threads\n", job.count, num_threads);
+    job.start = now_seconds();
+    for (int i = 0; i < num_threads; ++i) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, warm_worker, NULL) == 0) {
+            pthread_detach(thread);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+/*
+   Préchargement du cache au démarrage à partir d'un manifeste - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#ifndef WARM
+#define WARM
+
+
+#define WARM_DEFAULT_THREADS 4
+#define WARM_MAX_THREADS 32
+
+
+// Liste des fichiers à précharger, partagée par les threads
+typedef struct {
+    char** files; // Chemins des fichiers
+    size_t count; // Nombre de fichiers
+    size_t next; // Prochain fichier à traiter
+    size_t done; // Nombre de fichiers traités
+    size_t loaded; // Nombre de fichiers chargés dans le cache
+    long bytes; // Octets chargés
+    double start; // Date de début (secondes)
+    pthread_mutex_t mutex; // Protège next, done, loaded et bytes
+} WarmJob;
+
+
+
+/**
+ * \brief Construit la clé de cache du contenu brut (mode octet) d'un fichier.
+ *
+ * \param key Le tampon de sortie (CACHE_KEY_LENGTH octets).
+ * \param filename Le nom du fichier.
+ */
+void warm_cache_key(char* key, const char* filename);
+
+
+
+/**
+ * \brief Démarre le préchargement en arrière-plan des fichiers listés dans un manifeste.
+ *
+ * Le manifeste contient un chemin ou un motif glob par ligne ; les lignes vides et
+ * celles commençant par '#' sont ignorées. Les chemins trouvés sont normalisés comme
+ * les noms demandés par les clients ; un chemin absolu ou sortant de la racine servie
+ * est ignoré. Les fichiers sont lus par num_threads threads
+ * et insérés dans le cache de contenu ; la progression est affichée. La fonction rend la
+ * main immédiatement, les fichiers non encore chargés étant servis depuis le disque.
+ * Un nouvel appel (rechargement) est ignoré tant que le préchargement précédent n'est
+ * pas terminé.
+ *
+ * \param manifest Le chemin du manifeste.
+ * \param num_threads Le nombre de threads de lecture.
+ * \return 0 en cas de succès, -1 si le manifeste ne peut pas être lu.
+ */
+int warm_start(const char* manifest, int num_threads);
+
+#endif
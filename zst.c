@@ -0,0 +1,567 @@
+#include "zst.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+
+// Tampons d'entrée et de sortie de ZSTD_decompressStream (même disposition que zstd.h)
+typedef struct {
+    const void* src;
+    size_t size;
+    size_t pos;
+} ZstdInBuffer;
+
+typedef struct {
+    void* dst;
+    size_t size;
+    size_t pos;
+} ZstdOutBuffer;
+
+// Constantes de zstd.h
+#define ZSTD_CONTENTSIZE_UNKNOWN (0ULL - 1)
+#define ZSTD_CONTENTSIZE_ERROR (0ULL - 2)
+#define ZSTD_RESET_SESSION_ONLY 1
+
+// Format « seekable » de zstd : table des trames dans une trame ignorable en fin de fichier
+#define ZST_SKIPPABLE_MAGIC 0x184D2A50u
+#define ZST_SKIPPABLE_MASK 0xFFFFFFF0u
+#define ZST_SEEKTABLE_MAGIC 0x184D2A5Eu
+#define ZST_SEEKABLE_MAGIC 0x8F92EAB1u
+#define ZST_SEEKTABLE_FOOTER 9
+#define ZST_SEEKTABLE_CHECKSUM 0x80
+
+// Fonctions de libzstd, chargée par dlopen : le serveur fonctionne (sans .zst) si elle est absente
+static struct {
+    void* (*create_dctx)(void);
+    size_t (*free_dctx)(void* dctx);
+    size_t (*decompress_dctx)(void* dctx, void* dst, size_t capacity, const void* src, size_t size);
+    size_t (*decompress_stream)(void* dctx, ZstdOutBuffer* output, ZstdInBuffer* input);
+    size_t (*reset_dctx)(void* dctx, int reset);
+    unsigned (*is_error)(size_t code);
+    const char* (*error_name)(size_t code);
+    size_t (*frame_compressed_size)(const void* src, size_t size);
+    unsigned long long (*frame_content_size)(const void* src, size_t size);
+} zstd;
+static int library_state = 0; // 0 : pas encore chargée, 1 : chargée, -1 : indisponible
+static void* shared_dctx; // Contexte des décompressions de trames entières
+static ZstStats stats;
+
+
+
+/**
+ * \brief Charge libzstd au premier fichier compressé.
+ *
+ * \return 0 si la bibliothèque est disponible, -1 sinon.
+ */
+static int load_library(void) {
+    static const char* names[] = {
+        "ZSTD_createDCtx", "ZSTD_freeDCtx", "ZSTD_decompressDCtx", "ZSTD_decompressStream", "ZSTD_DCtx_reset",
+        "ZSTD_isError", "ZSTD_getErrorName", "ZSTD_findFrameCompressedSize", "ZSTD_getFrameContentSize"
+    };
+    void** slots[] = {
+        (void**) &zstd.create_dctx, (void**) &zstd.free_dctx, (void**) &zstd.decompress_dctx,
+        (void**) &zstd.decompress_stream, (void**) &zstd.reset_dctx, (void**) &zstd.is_error,
+        (void**) &zstd.error_name, (void**) &zstd.frame_compressed_size, (void**) &zstd.frame_content_size
+    };
+
+    if (library_state != 0) {
+        return library_state > 0 ? 0 : -1;
+    }
+    library_state = -1;
+
+    void* handle = dlopen(ZST_LIBRARY, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+        printf("Zstd : %s\n", dlerror());
+        return -1;
+    }
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        // Conversion void* -> pointeur de fonction, autorisée par POSIX pour dlsym
+        *slots[i] = dlsym(handle, names[i]);
+        if (*slots[i] == NULL) {
+            printf("Zstd : symbole %s absent de %s\n", names[i], ZST_LIBRARY);
+            dlclose(handle);
+            return -1;
+        }
+    }
+    shared_dctx = zstd.create_dctx();
+    if (shared_dctx == NULL) {
+        dlclose(handle);
+        return -1;
+    }
+    library_state = 1;
+    return 0;
+}
+
+
+
+/**
+ * \brief Lit un entier de 32 bits petit-boutiste.
+ *
+ * \param p Les 4 octets.
+ * \return La valeur.
+ */
+static uint32_t read_le32(const char* p) {
+    const unsigned char* u = (const unsigned char*) p;
+    return (uint32_t) u[0] | ((uint32_t) u[1] << 8) | ((uint32_t) u[2] << 16) | ((uint32_t) u[3] << 24);
+}
+
+
+
+/**
+ * \brief Ajoute une trame à l'index en cours de construction.
+ *
+ * \param frames L'index (réalloué si nécessaire).
+ * \param count Le nombre de trames, incrémenté.
+ * \param capacity La capacité de l'index.
+ * \param frame La trame à ajouter.
+ * \return 0 en cas de succès, -1 si la mémoire manque.
+ */
+static int append_frame(ZstFrame** frames, int* count, int* capacity, const ZstFrame* frame) {
+    if (*count == *capacity) {
+        int grown = *capacity > 0 ? *capacity * 2 : 16;
+        ZstFrame* larger = realloc(*frames, grown * sizeof(ZstFrame));
+        if (larger == NULL) {
+            return -1;
+        }
+        *frames = larger;
+        *capacity = grown;
+    }
+    (*frames)[(*count)++] = *frame;
+    return 0;
+}
+
+
+
+/**
+ * \brief Construit l'index depuis la table des trames du format seekable.
+ *
+ * \param map Le fichier compressé.
+ * \param len Sa taille.
+ * \param frames Reçoit l'index alloué.
+ * \param count Reçoit le nombre de trames.
+ * \return 0 en cas de succès, -1 si le fichier n'a pas de table valide.
+ */
+static int read_seek_table(const char* map, size_t len, ZstFrame** frames, int* count) {
+    if (len < ZST_SEEKTABLE_FOOTER + 8 || read_le32(map + len - 4) != ZST_SEEKABLE_MAGIC) {
+        return -1;
+    }
+
+    size_t num_entries = read_le32(map + len - ZST_SEEKTABLE_FOOTER);
+    size_t entry_size = (map[len - 5] & ZST_SEEKTABLE_CHECKSUM) ? 12 : 8;
+    if (num_entries > (len - ZST_SEEKTABLE_FOOTER - 8) / entry_size) {
+        return -1;
+    }
+    size_t table_size = num_entries * entry_size + ZST_SEEKTABLE_FOOTER;
+    const char* header = map + len - table_size - 8;
+    if (read_le32(header) != ZST_SEEKTABLE_MAGIC || read_le32(header + 4) != table_size) {
+        return -1;
+    }
+
+    int capacity = 0;
+    ZstFrame frame = {0, 0, 0, 0};
+    *frames = NULL;
+    *count = 0;
+    for (size_t i = 0; i < num_entries; ++i) {
+        frame.compressed_size = read_le32(header + 8 + i * entry_size);
+        frame.size = read_le32(header + 12 + i * entry_size);
+        if (frame.offset + frame.compressed_size > (size_t) (header - map)) {
+            free(*frames);
+            return -1;
+        }
+        if (frame.size > 0 && append_frame(frames, count, &capacity, &frame) != 0) {
+            free(*frames);
+            return -1;
+        }
+        frame.offset += frame.compressed_size;
+        frame.start += frame.size;
+    }
+    return 0;
+}
+
+
+
+/**
+ * \brief Mesure la taille décompressée d'une trame qui ne l'indique pas dans son en-tête.
+ *
+ * \param src La trame.
+ * \param len Sa taille compressée.
+ * \return La taille décompressée, ou ZSTD_CONTENTSIZE_ERROR si la trame est invalide.
+ */
+static unsigned long long measure_frame(const char* src, size_t len) {
+    static char scratch[ZST_STREAM_BUFFER];
+    ZstdInBuffer in = {src, len, 0};
+    unsigned long long total = 0;
+    size_t ret = 1;
+
+    zstd.reset_dctx(shared_dctx, ZSTD_RESET_SESSION_ONLY);
+    while (ret != 0) {
+        ZstdOutBuffer out = {scratch, sizeof(scratch), 0};
+        ret = zstd.decompress_stream(shared_dctx, &out, &in);
+        if (zstd.is_error(ret) || (out.pos == 0 && in.pos == in.size && ret != 0)) {
+            return ZSTD_CONTENTSIZE_ERROR;
+        }
+        total += out.pos;
+    }
+    stats.bytes_decoded += total;
+    return total;
+}
+
+
+
+/**
+ * \brief Construit l'index en parcourant les en-têtes de trames.
+ *
+ * \param map Le fichier compressé.
+ * \param len Sa taille.
+ * \param frames Reçoit l'index alloué.
+ * \param count Reçoit le nombre de trames.
+ * \return 0 en cas de succès, -1 si le fichier est invalide.
+ */
+static int walk_frames(const char* map, size_t len, ZstFrame** frames, int* count) {
+    int capacity = 0;
+    ZstFrame frame = {0, 0, 0, 0};
+
+    *frames = NULL;
+    *count = 0;
+    while (frame.offset < len) {
+        const char* src = map + frame.offset;
+        frame.compressed_size = zstd.frame_compressed_size(src, len - frame.offset);
+        if (zstd.is_error(frame.compressed_size)) {
+            printf("Zstd : %s\n", zstd.error_name(frame.compressed_size));
+            free(*frames);
+            return -1;
+        }
+
+        frame.size = 0;
+        if (len - frame.offset < 4 || (read_le32(src) & ZST_SKIPPABLE_MASK) != ZST_SKIPPABLE_MAGIC) {
+            frame.size = zstd.frame_content_size(src, frame.compressed_size);
+            if (frame.size == ZSTD_CONTENTSIZE_UNKNOWN) {
+                frame.size = measure_frame(src, frame.compressed_size);
+            }
+            if (frame.size == ZSTD_CONTENTSIZE_ERROR) {
+                free(*frames);
+                return -1;
+            }
+        }
+        if (frame.size > 0 && append_frame(frames, count, &capacity, &frame) != 0) {
+            free(*frames);
+            return -1;
+        }
+        frame.offset += frame.compressed_size;
+        frame.start += frame.size;
+    }
+    return 0;
+}
+
+
+
+/**
+ * \brief Construit l'index des trames d'un fichier compressé et le met en cache.
+ *
+ * \param reader Le lecteur (fichier projeté).
+ * \param key La clé de l'index dans le cache.
+ * \return 0 en cas de succès, -1 si le fichier est invalide.
+ */
+static int build_index(ZstReader* reader, const char* key) {
+    ZstFrame* frames;
+    int count;
+
+    if (read_seek_table(reader->map, reader->map_len, &frames, &count) != 0
+        && walk_frames(reader->map, reader->map_len, &frames, &count) != 0) {
+        return -1;
+    }
+    reader->num_frames = count;
+
+    // Le cache libère le tampon s'il est plein : l'index lui est confié sous forme de copie
+    char* copy = malloc(count * sizeof(ZstFrame) + 1);
+    if (copy != NULL) {
+        memcpy(copy, frames, count * sizeof(ZstFrame));
+        reader->index = cache_insert(key, &reader->st, copy, count * sizeof(ZstFrame));
+    }
+    if (reader->index != NULL) {
+        free(frames);
+        reader->frames = (const ZstFrame*) reader->index->data;
+    } else {
+        reader->own_frames = frames;
+        reader->frames = frames;
+    }
+    return 0;
+}
+
+
+
+/**
+ * \brief Ouvre la version compressée d'un fichier (nom suivi de ZST_SUFFIX).
+ *
+ * L'index des trames est lu dans la table du format seekable si elle est présente, sinon
+ * construit en parcourant les en-têtes ; il est gardé en cache tant que le fichier
+ * compressé ne change pas.
+ *
+ * \param path Le chemin du fichier compressé.
+ * \param st Les métadonnées du fichier compressé.
+ * \return Le lecteur, ou NULL si le fichier est invalide ou si libzstd est indisponible.
+ */
+ZstReader* zst_open(const char* path, const struct stat* st) {
+    if (load_library() != 0 || st->st_size == 0) {
+        return NULL;
+    }
+
+    ZstReader* reader = calloc(1, sizeof(ZstReader));
+    if (reader == NULL) {
+        return NULL;
+    }
+    reader->st = *st;
+    snprintf(reader->name, sizeof(reader->name), "%s", path);
+    reader->frame = -1;
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror("Erreur lors de l'ouverture du fichier compressé");
+        free(reader);
+        return NULL;
+    }
+    reader->map_len = st->st_size;
+    reader->map = mmap(NULL, reader->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (reader->map == MAP_FAILED) {
+        perror("Erreur lors de la projection du fichier compressé");
+        free(reader);
+        return NULL;
+    }
+
+    char key[CACHE_KEY_LENGTH];
+    snprintf(key, sizeof(key), "zst-index:%s", path);
+    reader->index = cache_lookup(key, st);
+    if (reader->index != NULL) {
+        reader->frames = (const ZstFrame*) reader->index->data;
+        reader->num_frames = reader->index->len / sizeof(ZstFrame);
+    } else if (build_index(reader, key) != 0) {
+        printf("Zstd : fichier %s invalide\n", path);
+        zst_close(reader);
+        return NULL;
+    }
+    if (reader->num_frames > 0) {
+        const ZstFrame* last = &reader->frames[reader->num_frames - 1];
+        reader->size = last->start + last->size;
+    }
+    stats.opened++;
+    return reader;
+}
+
+
+
+/**
+ * \brief Recherche la trame contenant une position du contenu décompressé.
+ *
+ * \param reader Le lecteur.
+ * \param offset La position (inférieure à la taille totale).
+ * \return L'indice de la trame.
+ */
+static int find_frame(const ZstReader* reader, unsigned long long offset) {
+    int low = 0;
+    int high = reader->num_frames - 1;
+
+    // Lecture séquentielle : la trame courante ou la suivante, sans recherche
+    if (reader->frame >= 0 && offset >= reader->frames[reader->frame].start) {
+        low = reader->frame;
+    }
+    while (low < high) {
+        int middle = (low + high + 1) / 2;
+        if (reader->frames[middle].start <= offset) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+
+
+/**
+ * \brief Reprend la décompression en flux au début de la trame courante.
+ *
+ * \param reader Le lecteur.
+ */
+static void rewind_stream(ZstReader* reader) {
+    if (reader->dctx != NULL) {
+        zstd.reset_dctx(reader->dctx, ZSTD_RESET_SESSION_ONLY);
+    }
+    reader->stream_in = 0;
+    reader->stream_start = reader->frames[reader->frame].start;
+    reader->stream_len = 0;
+}
+
+
+
+/**
+ * \brief Passe à une autre trame, depuis le cache si possible.
+ *
+ * Une trame d'au plus ZST_CACHE_MAX_FRAME octets est décompressée en entier et mise en
+ * cache ; sinon (ou si le cache est plein) elle est décompressée en flux.
+ *
+ * \param reader Le lecteur.
+ * \param index L'indice de la trame.
+ * \return 0 en cas de succès, -1 en cas d'erreur.
+ */
+static int select_frame(ZstReader* reader, int index) {
+    const ZstFrame* frame = &reader->frames[index];
+
+    cache_release(reader->entry);
+    reader->entry = NULL;
+    reader->frame = index;
+    rewind_stream(reader);
+
+    if (frame->size <= ZST_CACHE_MAX_FRAME) {
+        char key[CACHE_KEY_LENGTH];
+        snprintf(key, sizeof(key), "zst:%d:%s", index, reader->name);
+        reader->entry = cache_lookup(key, &reader->st);
+        if (reader->entry != NULL) {
+            stats.frame_hits++;
+            return 0;
+        }
+
+        char* data = malloc(frame->size);
+        if (data == NULL) {
+            return -1;
+        }
+        size_t ret = zstd.decompress_dctx(shared_dctx, data, frame->size, reader->map + frame->offset, frame->compressed_size);
+        if (zstd.is_error(ret) || ret != frame->size) {
+            printf("Zstd : trame %d de %s invalide\n", index, reader->name);
+            free(data);
+            return -1;
+        }
+        stats.frame_decoded++;
+        stats.bytes_decoded += frame->size;
+        reader->entry = cache_insert(key, &reader->st, data, frame->size);
+        if (reader->entry != NULL) {
+            return 0;
+        }
+    }
+
+    // Décompression en flux dans le tampon de la session
+    if (reader->dctx == NULL) {
+        reader->dctx = zstd.create_dctx();
+    }
+    if (reader->stream == NULL) {
+        reader->stream = malloc(ZST_STREAM_BUFFER);
+    }
+    return reader->dctx != NULL && reader->stream != NULL ? 0 : -1;
+}
+
+
+
+/**
+ * \brief Décompresse la suite de la trame courante dans le tampon de la session.
+ *
+ * \param reader Le lecteur.
+ * \return 0 en cas de succès, -1 si la trame est invalide ou tronquée.
+ */
+static int stream_next(ZstReader* reader) {
+    const ZstFrame* frame = &reader->frames[reader->frame];
+    ZstdInBuffer in = {reader->map + frame->offset, frame->compressed_size, reader->stream_in};
+    ZstdOutBuffer out = {reader->stream, ZST_STREAM_BUFFER, 0};
+
+    reader->stream_start += reader->stream_len;
+    reader->stream_len = 0;
+    while (out.pos == 0) {
+        size_t ret = zstd.decompress_stream(reader->dctx, &out, &in);
+        if (zstd.is_error(ret) || (out.pos == 0 && (ret == 0 || in.pos == in.size))) {
+            printf("Zstd : trame %d de %s invalide\n", reader->frame, reader->name);
+            return -1;
+        }
+    }
+    reader->stream_in = in.pos;
+    reader->stream_len = out.pos;
+    stats.streamed++;
+    stats.bytes_decoded += out.pos;
+    return 0;
+}
+
+
+
+/**
+ * \brief Lit le contenu décompressé à une position donnée.
+ *
+ * Une lecture en arrière dans une trame non mise en cache reprend la décompression
+ * au début de la trame.
+ *
+ * \param reader Le lecteur.
+ * \param offset La position dans le contenu décompressé.
+ * \param out Le tampon de destination.
+ * \param size La taille maximale à lire.
+ * \return Le nombre d'octets lus (0 à la fin du fichier), ou -1 en cas d'erreur.
+ */
+long zst_read(ZstReader* reader, unsigned long long offset, char* out, size_t size) {
+    size_t done = 0;
+
+    while (done < size && offset < reader->size) {
+        int index = find_frame(reader, offset);
+        if (index != reader->frame && select_frame(reader, index) != 0) {
+            return -1;
+        }
+
+        const ZstFrame* frame = &reader->frames[index];
+        const char* src;
+        size_t available;
+        if (reader->entry != NULL) {
+            src = reader->entry->data + (offset - frame->start);
+            available = frame->start + frame->size - offset;
+        } else {
+            if (offset < reader->stream_start) {
+                rewind_stream(reader);
+            }
+            while (offset >= reader->stream_start + reader->stream_len) {
+                if (stream_next(reader) != 0) {
+                    return -1;
+                }
+            }
+            src = reader->stream + (offset - reader->stream_start);
+            available = reader->stream_start + reader->stream_len - offset;
+        }
+
+        size_t n = size - done < available ? size - done : available;
+        memcpy(out + done, src, n);
+        done += n;
+        offset += n;
+    }
+    return (long) done;
+}
+
+
+
+/**
+ * \brief Ferme un lecteur et libère ses références sur le cache.
+ *
+ * \param reader Le lecteur (NULL accepté).
+ */
+void zst_close(ZstReader* reader) {
+    if (reader == NULL) {
+        return;
+    }
+    cache_release(reader->entry);
+    cache_release(reader->index);
+    free(reader->own_frames);
+    if (reader->dctx != NULL) {
+        zstd.free_dctx(reader->dctx);
+    }
+    free(reader->stream);
+    if (reader->map != MAP_FAILED && reader->map != NULL) {
+        munmap((void*) reader->map, reader->map_len);
+    }
+    free(reader);
+}
+
+
+
+/**
+ * \brief Retourne les compteurs de la décompression.
+ *
+ * \return Les compteurs.
+ */
+ZstStats zst_get_stats(void) {
+    return stats;
+}
@@ -0,0 +1,112 @@
+/*
+   Fichiers compressés (zstd) servis décompressés à la volée - Définitions et structures de données
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+
+#ifndef ZST
+#define ZST
+
+
+#define ZST_SUFFIX ".zst" // Suffixe cherché lorsque le fichier demandé est absent
+#define ZST_LIBRARY "libzstd.so.1" // Bibliothèque chargée au premier fichier compressé
+#define ZST_CACHE_MAX_FRAME (4L * 1024 * 1024) // Taille décompressée maximale d'une trame mise en cache
+#define ZST_STREAM_BUFFER (128 * 1024) // Tampon de décompression des trames non mises en cache
+
+
+// Trame zstd du fichier compressé
+typedef struct {
+    size_t offset; // Position de la trame dans le fichier compressé
+    size_t compressed_size; // Taille compressée
+    unsigned long long start; // Position du contenu de la trame dans le fichier décompressé
+    unsigned long long size; // Taille décompressée
+} ZstFrame;
+
+
+// Lecture d'un fichier compressé par une session
+//
+// L'index des trames est partagé par le cache. Une trame assez petite est décompressée
+// en entier et mise en cache : les lecteurs suivants ne la décompressent pas. Une trame
+// plus grande est décompressée en flux dans un tampon propre à la session.
+typedef struct {
+    struct stat st; // Métadonnées du fichier compressé (validité des entrées du cache)
+    char name[CACHE_KEY_LENGTH - 16]; // Chemin du fichier compressé (place laissée au préfixe des clés du cache)
+    const char* map; // Projection mémoire du fichier compressé
+    size_t map_len; // Taille de la projection
+    CacheEntry* index; // Index des trames en cache (tableau de ZstFrame)
+    ZstFrame* own_frames; // Index propre au lecteur si le cache est plein
+    const ZstFrame* frames; // Trames, dans l'ordre du fichier
+    int num_frames; // Nombre de trames
+    unsigned long long size; // Taille décompressée totale
+    int frame; // Trame courante (-1 : aucune)
+    CacheEntry* entry; // Trame courante en cache (NULL : décompression en flux)
+    void* dctx; // Contexte de décompression en flux (créé à la demande)
+    char* stream; // Tampon de décompression en flux
+    size_t stream_in; // Octets compressés de la trame courante déjà consommés
+    unsigned long long stream_start; // Position décompressée du début du tampon
+    size_t stream_len; // Octets valides dans le tampon
+} ZstReader;
+
+
+// Compteurs de la décompression
+typedef struct {
+    unsigned long opened; // Fichiers compressés servis
+    unsigned long frame_hits; // Trames servies depuis le cache
+    unsigned long frame_decoded; // Trames décompressées en entier et mises en cache
+    unsigned long streamed; // Tampons décompressés en flux
+    unsigned long long bytes_decoded; // Octets produits par la décompression
+} ZstStats;
+
+
+
+/**
+ * \brief Ouvre la version compressée d'un fichier (nom suivi de ZST_SUFFIX).
+ *
+ * \param path Le chemin du fichier compressé.
+ * \param st Les métadonnées du fichier compressé.
+ * \return Le lecteur, ou NULL si le fichier est invalide ou si libzstd est indisponible.
+ */
+ZstReader* zst_open(const char* path, const struct stat* st);
+
+
+
+/**
+ * \brief Lit le contenu décompressé à une position donnée.
+ *
+ * Une lecture en arrière dans une trame non mise en cache reprend la décompression
+ * au début de la trame.
+ *
+ * \param reader Le lecteur.
+ * \param offset La position dans le contenu décompressé.
+ * \param out Le tampon de destination.
+ * \param size La taille maximale à lire.
+ * \return Le nombre d'octets lus (0 à la fin du fichier), ou -1 en cas d'erreur.
+ */
+long zst_read(ZstReader* reader, unsigned long long offset, char* out, size_t size);
+
+
+
+/**
+ * \brief Ferme un lecteur et libère ses références sur le cache.
+ *
+ * \param reader Le lecteur (NULL accepté).
+ */
+void zst_close(ZstReader* reader);
+
+
+
+/**
+ * \brief Retourne les compteurs de la décompression.
+ *
+ * \return Les compteurs.
+ */
+ZstStats zst_get_stats(void);
+
+#endif